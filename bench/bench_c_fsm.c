@@ -0,0 +1,868 @@
+/* MIT License
+ *
+ * Copyright (C) 2024  Haju Schulz <haju@schulznorbert.de>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+/*******************************************************************************
+    DESCRIPTION
+*******************************************************************************/
+/**
+ * @brief  CFSM benchmarks
+ *
+ * Micro benchmarks for CFSM operations. Build in Release mode to get
+ * meaningful numbers:
+ *
+ *     cmake -B build -DCMAKE_BUILD_TYPE=Release
+ *     cmake --build build
+ *     build/bench/bench_c_fsm
+ *
+ * @addtogroup bench
+ *
+ * @{
+ */
+
+/******************************************************************************
+ * Includes
+ *****************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "c_fsm.h"
+#include "c_fsm_fleet.h"
+#include "c_fsm_compact.h"
+#include "c_fsm_latency.h"
+
+#if defined(CFSM_ENABLE_PROFILE)
+#include "c_fsm_profile.h"
+#endif
+
+/******************************************************************************
+ * Macros
+ *****************************************************************************/
+
+#define FAILOVER_INSTANCES  1000000u  /**< Fleet size for failover bench    */
+#define FAILOVER_ROUNDS     10u       /**< Failover repetitions             */
+#define EVENT_BATCH_SIZE    32u       /**< Events per batch                 */
+#define EVENT_ROUNDS        1000000u  /**< Event batch repetitions          */
+#define INGEST_INSTANCES    1000000u  /**< Fleet size for ingest bench      */
+#define INGEST_EVENTS       4000000u  /**< Events per ingest batch          */
+#define DISPATCH_INSTANCES  4096u     /**< Mixed states for dispatch bench  */
+#define DISPATCH_ROUNDS     10000u    /**< Dispatch repetitions             */
+#define COMPACT_INSTANCES   4000000u  /**< Fleet size for compact bench     */
+#define COMPACT_ROUNDS      10u       /**< Compact process repetitions      */
+#define COLUMN_INSTANCES    1000000u  /**< Fleet size for column bench      */
+#define COLUMN_ROUNDS       20u       /**< Timeout check repetitions        */
+#define COLUMN_TIMEOUT      1000u     /**< Timeout of column bench instances*/
+#define TIMEOUT_INSTANCES   1000000u  /**< Fleet size for timeout bench     */
+#define TIMEOUT_ROUNDS      20u       /**< Timeout check repetitions        */
+#define SLEEPER_MAX         1000000u  /**< Largest sleeper count            */
+#define SLEEPER_RUNNABLE    16u       /**< Runnable instances among them    */
+#define SLEEPER_TICKS       100000u   /**< Process cycles per sleeper count */
+
+#if defined(CFSM_ENABLE_PROFILE)
+#define BENCH_HANDLER_MODE "profiled" /**< CFSM configuration */
+#elif defined(CFSM_CONFIG_NOOP_HANDLERS)
+#define BENCH_HANDLER_MODE "no-op handlers" /**< CFSM configuration */
+#else
+#define BENCH_HANDLER_MODE "NULL handlers"  /**< CFSM configuration */
+#endif
+
+#if defined(CFSM_HEADER_ONLY)
+#define BENCH_LINKAGE "inline"   /**< CFSM core linkage */
+#else
+#define BENCH_LINKAGE "library"  /**< CFSM core linkage */
+#endif
+
+/******************************************************************************
+ * Types and Classes
+ *****************************************************************************/
+
+/** Instance data of the column bench as struct per instance */
+typedef struct BenchInstance_
+{
+    cfsm_Time onTime;        /**< Time of last state change */
+    unsigned char other[60]; /**< Fields not used by timeout check */
+} BenchInstance;
+
+/******************************************************************************
+ * Prototypes
+ *****************************************************************************/
+
+static void bench_report(const char * name, clock_t start, size_t operations);
+static void bench_failover(size_t stride, const char * const names[3]);
+static void bench_eventBatch(void);
+static void bench_ingest(void);
+static void bench_dispatch(void);
+static void bench_compact(void);
+static void bench_columns(void);
+static void bench_timeouts(void);
+static void bench_sleepers(void);
+static void bench_latency(void);
+static uint32_t Bench_clock(void);
+static void Counter_onEnter(cfsm_Ctx * fsm);
+static void Counter_onEvent(cfsm_Ctx * fsm, int eventId);
+
+static void Primary_onEnter(cfsm_Ctx * fsm);
+static void Standby_onEnter(cfsm_Ctx * fsm);
+static void Recovery_onEnter(cfsm_Ctx * fsm);
+static void Primary_onLeave(cfsm_Ctx * fsm);
+static void Primary_onEvent(cfsm_Ctx * fsm, int eventId);
+static void Recovery_onEvent(cfsm_Ctx * fsm, int eventId);
+static void Ticking_onEnter(cfsm_Ctx * fsm);
+static void Ticking_onProcess(cfsm_Ctx * fsm);
+static void Polling_onEnter(cfsm_Ctx * fsm);
+static void Polling_onProcess(cfsm_Ctx * fsm);
+static void Armed_onEnter(cfsm_Ctx * fsm);
+static void Armed_onEvent(cfsm_Ctx * fsm, int eventId);
+static void Dozing_onEnter(cfsm_Ctx * fsm);
+
+/******************************************************************************
+ * Variables
+ *****************************************************************************/
+
+static volatile unsigned long benchSink; /**< keeps handler work alive */
+static cfsm_Time benchNow;               /**< time seen by handlers    */
+static cfsm_Fleet * benchFleet;          /**< fleet of timeout bench   */
+static uint32_t benchTicks;              /**< latency bench clock      */
+
+#if defined(CFSM_ENABLE_PROFILE)
+static cfsm_Profile benchProfile;         /**< profile of all benches   */
+static cfsm_ProfileState benchStates[32]; /**< profiled states          */
+#endif
+
+/******************************************************************************
+ * External functions
+ *****************************************************************************/
+
+int main(void)
+{
+#if defined(CFSM_ENABLE_PROFILE)
+    cfsm_profile_init(&benchProfile, benchStates, 32u, NULL);
+    cfsm_profile_attach(&benchProfile);
+#endif
+
+    {
+        static const char * const quarter[3] = {
+            "failover 1M, 25%: application loop",
+            "failover 1M, 25%: transitionAll scan",
+            "failover 1M, 25%: transitionAll lists"
+        };
+        static const char * const percent[3] = {
+            "failover 1M, 1%: application loop",
+            "failover 1M, 1%: transitionAll scan",
+            "failover 1M, 1%: transitionAll lists"
+        };
+
+        bench_failover(4u, quarter);
+        bench_failover(100u, percent);
+    }
+    bench_eventBatch();
+    bench_ingest();
+    bench_dispatch();
+    bench_compact();
+    bench_columns();
+    bench_timeouts();
+    bench_sleepers();
+    bench_latency();
+
+#if defined(CFSM_ENABLE_PROFILE)
+    printf("\n");
+    cfsm_profile_report(&benchProfile, stdout);
+#endif
+
+    return 0;
+}
+
+/******************************************************************************
+ * Local functions
+ *****************************************************************************/
+
+static void bench_report(const char * name, clock_t start, size_t operations)
+{
+    double seconds = (double)(clock() - start) / CLOCKS_PER_SEC;
+
+    printf("%-40s %10.2f ns/op  (%lu ops, %s, %s)\n",
+        name,
+        (seconds * 1e9) / (double)operations,
+        (unsigned long)operations,
+        BENCH_HANDLER_MODE,
+        BENCH_LINKAGE);
+}
+
+/**
+ * @brief Move every stride-th of 1M instances from primary to recovery.
+ *
+ * Compares cfsm_fleet_transitionAll() against an application loop
+ * that tests handler pointers and calls cfsm_transition(), with and
+ * without per state lists.
+ *
+ * @param stride Distance of primary instances.
+ * @param names Report names of the three variants.
+ */
+static void bench_failover(size_t stride, const char * const names[3])
+{
+    cfsm_FleetEntry * entries = malloc(FAILOVER_INSTANCES * sizeof(*entries));
+    cfsm_Ctx * contexts = malloc(FAILOVER_INSTANCES * sizeof(*contexts));
+    cfsm_FleetMember * members = malloc(FAILOVER_INSTANCES * sizeof(*members));
+    cfsm_FleetStateList lists[2];
+    cfsm_Fleet fleet;
+    clock_t start;
+    size_t moved = 0u;
+
+    if ((NULL == entries) || (NULL == contexts) || (NULL == members))
+    {
+        puts("bench_failover: out of memory");
+        free(entries);
+        free(contexts);
+        free(members);
+        return;
+    }
+
+    cfsm_fleet_init(&fleet, entries, FAILOVER_INSTANCES);
+    for (size_t i = 0u; i < FAILOVER_INSTANCES; ++i)
+    {
+        cfsm_TransitionFunction first =
+            (0u == (i % stride)) ? Primary_onEnter : Standby_onEnter;
+
+        cfsm_transition(cfsm_fleet_add(&fleet, NULL), first);
+
+        cfsm_init(&contexts[i], NULL);
+        cfsm_transition(&contexts[i], first);
+    }
+
+    start = clock();
+    for (unsigned int round = 0u; round < FAILOVER_ROUNDS; ++round)
+    {
+        for (size_t i = 0u; i < FAILOVER_INSTANCES; ++i)
+        {
+            if (Primary_onEvent == contexts[i].onEvent)
+            {
+                cfsm_transition(&contexts[i], Recovery_onEnter);
+                ++moved;
+            }
+        }
+        for (size_t i = 0u; i < FAILOVER_INSTANCES; ++i)
+        {
+            if (Recovery_onEvent == contexts[i].onEvent)
+            {
+                cfsm_transition(&contexts[i], Primary_onEnter);
+            }
+        }
+    }
+    bench_report(names[0], start, moved);
+
+    moved = 0u;
+    start = clock();
+    for (unsigned int round = 0u; round < FAILOVER_ROUNDS; ++round)
+    {
+        moved += cfsm_fleet_transitionAll(&fleet, Primary_onEnter, Recovery_onEnter);
+        (void)cfsm_fleet_transitionAll(&fleet, Recovery_onEnter, Primary_onEnter);
+    }
+    bench_report(names[1], start, moved);
+
+    lists[0].state = Primary_onEnter;
+    lists[1].state = Recovery_onEnter;
+    cfsm_fleet_attachStates(&fleet, lists, 2u, members);
+
+    moved = 0u;
+    start = clock();
+    for (unsigned int round = 0u; round < FAILOVER_ROUNDS; ++round)
+    {
+        moved += cfsm_fleet_transitionAll(&fleet, Primary_onEnter, Recovery_onEnter);
+        (void)cfsm_fleet_transitionAll(&fleet, Recovery_onEnter, Primary_onEnter);
+    }
+    bench_report(names[2], start, moved);
+
+    free(entries);
+    free(contexts);
+    free(members);
+}
+
+/**
+ * @brief Deliver events one by one versus as batch to one context.
+ */
+static void bench_eventBatch(void)
+{
+    int events[EVENT_BATCH_SIZE];
+    cfsm_Ctx fsm;
+    clock_t start;
+
+    for (unsigned int i = 0u; i < EVENT_BATCH_SIZE; ++i)
+    {
+        events[i] = (int)i;
+    }
+
+    cfsm_init(&fsm, NULL);
+    cfsm_transition(&fsm, Primary_onEnter);
+
+    start = clock();
+    for (unsigned int round = 0u; round < EVENT_ROUNDS; ++round)
+    {
+        for (unsigned int i = 0u; i < EVENT_BATCH_SIZE; ++i)
+        {
+            cfsm_event(&fsm, events[i]);
+        }
+    }
+    bench_report("event: cfsm_event", start, EVENT_ROUNDS * EVENT_BATCH_SIZE);
+
+    start = clock();
+    for (unsigned int round = 0u; round < EVENT_ROUNDS; ++round)
+    {
+        cfsm_eventBatch(&fsm, events, EVENT_BATCH_SIZE);
+    }
+    bench_report("event: cfsm_eventBatch (32)", start, EVENT_ROUNDS * EVENT_BATCH_SIZE);
+}
+
+/**
+ * @brief Deliver 4M events to random instances of a 1M instance fleet.
+ *
+ * Compares posting in arrival order against cfsm_fleet_ingest() with
+ * partitioning by entry index.
+ */
+static void bench_ingest(void)
+{
+    cfsm_FleetEntry * entries = malloc(INGEST_INSTANCES * sizeof(*entries));
+    cfsm_Handle * handles = malloc(INGEST_INSTANCES * sizeof(*handles));
+    cfsm_Handle * targets = malloc(2u * INGEST_EVENTS * sizeof(*targets));
+    int * events = malloc(2u * INGEST_EVENTS * sizeof(*events));
+    cfsm_Fleet fleet;
+    clock_t start;
+    size_t delivered = 0u;
+    unsigned long random = 1u;
+
+    if ((NULL == entries) || (NULL == handles) || (NULL == targets) || (NULL == events))
+    {
+        puts("bench_ingest: out of memory");
+        free(entries);
+        free(handles);
+        free(targets);
+        free(events);
+        return;
+    }
+
+    cfsm_fleet_init(&fleet, entries, INGEST_INSTANCES);
+    for (size_t i = 0u; i < INGEST_INSTANCES; ++i)
+    {
+        cfsm_Ctx * fsm = cfsm_fleet_add(&fleet, NULL);
+
+        cfsm_transition(fsm, Counter_onEnter);
+        handles[i] = cfsm_fleet_handleOf(&fleet, fsm);
+    }
+
+    for (size_t i = 0u; i < INGEST_EVENTS; ++i)
+    {
+        random = random * 1103515245u + 12345u;
+        targets[i] = handles[(random >> 8) % INGEST_INSTANCES];
+        events[i] = (int)(i & 0xFFu);
+    }
+
+    start = clock();
+    for (size_t i = 0u; i < INGEST_EVENTS; ++i)
+    {
+        delivered += (size_t)cfsm_fleet_post(&fleet, targets[i], events[i]);
+    }
+    bench_report("ingest 4M: cfsm_fleet_post loop", start, delivered);
+
+    start = clock();
+    delivered = cfsm_fleet_ingest(
+        &fleet, targets, events, INGEST_EVENTS,
+        &targets[INGEST_EVENTS], &events[INGEST_EVENTS]);
+    bench_report("ingest 4M: cfsm_fleet_ingest", start, delivered);
+
+    free(entries);
+    free(handles);
+    free(targets);
+    free(events);
+}
+
+/**
+ * @brief Dispatch to instances in randomly mixed idle and busy states.
+ *
+ * Half of the states lack process and event handlers. With NULL
+ * handlers the dispatch branch depends on the state and mispredicts,
+ * with no-op handlers the call is unconditional. Build bench_c_fsm
+ * and bench_c_fsm_noop to compare.
+ */
+static void bench_dispatch(void)
+{
+    static cfsm_Ctx contexts[DISPATCH_INSTANCES];
+    unsigned long seed = 0x2545F491ul;
+    clock_t start;
+
+    for (unsigned int i = 0u; i < DISPATCH_INSTANCES; ++i)
+    {
+        /* xorshift, keeps the state pattern unpredictable */
+        seed ^= seed << 13;
+        seed ^= seed >> 7;
+        seed ^= seed << 17;
+        seed &= 0xFFFFFFFFul;
+
+        cfsm_init(&contexts[i], NULL);
+        cfsm_transition(
+            &contexts[i],
+            (0ul != (seed & 0x100ul)) ? Ticking_onEnter : Standby_onEnter);
+    }
+
+    start = clock();
+    for (unsigned int round = 0u; round < DISPATCH_ROUNDS; ++round)
+    {
+        for (unsigned int i = 0u; i < DISPATCH_INSTANCES; ++i)
+        {
+            cfsm_process(&contexts[i]);
+        }
+    }
+    bench_report("dispatch mixed: cfsm_process", start,
+        DISPATCH_ROUNDS * DISPATCH_INSTANCES);
+
+    start = clock();
+    for (unsigned int round = 0u; round < DISPATCH_ROUNDS; ++round)
+    {
+        for (unsigned int i = 0u; i < DISPATCH_INSTANCES; ++i)
+        {
+            cfsm_event(&contexts[i], (int)round);
+        }
+    }
+    bench_report("dispatch mixed: cfsm_event", start,
+        DISPATCH_ROUNDS * DISPATCH_INSTANCES);
+}
+
+/**
+ * @brief Process 4M instances with every 8th in a state with process operation.
+ *
+ * Compares an array of cfsm_Ctx against a compact fleet with 8 byte
+ * instances.
+ */
+static void bench_compact(void)
+{
+    cfsm_Ctx * contexts = malloc(COMPACT_INSTANCES * sizeof(cfsm_Ctx));
+    cfsm_CompactCtx * compacts = malloc(COMPACT_INSTANCES * sizeof(cfsm_CompactCtx));
+    cfsm_CompactState states[2];
+    cfsm_CompactFleet fleet;
+    clock_t start;
+
+    if (((cfsm_Ctx *)0 == contexts) || ((cfsm_CompactCtx *)0 == compacts))
+    {
+        puts("bench_compact: out of memory");
+        free(contexts);
+        free(compacts);
+        return;
+    }
+
+    states[0].enter = Standby_onEnter;
+    states[1].enter = Ticking_onEnter;
+    cfsm_compact_init(&fleet, compacts, COMPACT_INSTANCES, states, 2u, NULL, 0u);
+
+    for (size_t i = 0u; i < COMPACT_INSTANCES; ++i)
+    {
+        cfsm_TransitionFunction state =
+            (0u == (i % 8u)) ? Ticking_onEnter : Standby_onEnter;
+
+        cfsm_init(&contexts[i], NULL);
+        cfsm_transition(&contexts[i], state);
+        cfsm_compact_transition(&fleet, i, state);
+    }
+
+    printf("compact: %lu bytes per cfsm_Ctx, %lu per cfsm_CompactCtx\n",
+        (unsigned long)sizeof(cfsm_Ctx),
+        (unsigned long)sizeof(cfsm_CompactCtx));
+
+    start = clock();
+    for (unsigned int round = 0u; round < COMPACT_ROUNDS; ++round)
+    {
+        for (size_t i = 0u; i < COMPACT_INSTANCES; ++i)
+        {
+            cfsm_process(&contexts[i]);
+        }
+    }
+    bench_report("compact 4M: cfsm_process loop", start,
+        COMPACT_ROUNDS * COMPACT_INSTANCES);
+
+    start = clock();
+    for (unsigned int round = 0u; round < COMPACT_ROUNDS; ++round)
+    {
+        cfsm_compact_processAll(&fleet);
+    }
+    bench_report("compact 4M: cfsm_compact_processAll", start,
+        COMPACT_ROUNDS * COMPACT_INSTANCES);
+
+    free(contexts);
+    free(compacts);
+}
+
+/**
+ * @brief Timeout check over 1M fleet instances, 1% of them expired.
+ *
+ * Compares instance data reached through ctxPtr of separately allocated
+ * structs against a column indexed by cfsm_fleet_indexOf().
+ */
+static void bench_columns(void)
+{
+    cfsm_FleetEntry * entries = malloc(COLUMN_INSTANCES * sizeof(*entries));
+    cfsm_Time * onTime = malloc(COLUMN_INSTANCES * sizeof(*onTime));
+    cfsm_Fleet fleet;
+    const cfsm_Time now = 5000u;
+    clock_t start;
+    size_t expired = 0u;
+
+    if ((NULL == entries) || (NULL == onTime))
+    {
+        puts("bench_columns: out of memory");
+        free(entries);
+        free(onTime);
+        return;
+    }
+
+    cfsm_fleet_init(&fleet, entries, COLUMN_INSTANCES);
+    for (size_t i = 0u; i < COLUMN_INSTANCES; ++i)
+    {
+        BenchInstance * instance = calloc(1u, sizeof(*instance));
+        cfsm_Ctx * fsm = cfsm_fleet_add(&fleet, instance);
+        cfsm_Time started = (0u == (i % 100u)) ? 0u : now;
+
+        if (NULL != instance)
+        {
+            instance->onTime = started;
+        }
+        CFSM_FLEET_COLUMN(&fleet, onTime, fsm) = started;
+        cfsm_transition(fsm, Primary_onEnter);
+    }
+
+    start = clock();
+    for (unsigned int round = 0u; round < COLUMN_ROUNDS; ++round)
+    {
+        for (size_t i = 0u; i < fleet.count; ++i)
+        {
+            cfsm_Ctx * fsm = cfsm_fleet_at(&fleet, i);
+            const BenchInstance * instance = (const BenchInstance *)fsm->ctxPtr;
+
+            if ((now - instance->onTime) >= COLUMN_TIMEOUT)
+            {
+                cfsm_fleet_event(&fleet, fsm, 1);
+                expired++;
+            }
+        }
+    }
+    bench_report("columns 1M: struct per instance", start,
+        COLUMN_ROUNDS * COLUMN_INSTANCES);
+
+    start = clock();
+    for (unsigned int round = 0u; round < COLUMN_ROUNDS; ++round)
+    {
+        for (size_t i = 0u; i < fleet.count; ++i)
+        {
+            if ((now - onTime[i]) >= COLUMN_TIMEOUT)
+            {
+                cfsm_fleet_event(&fleet, cfsm_fleet_at(&fleet, i), 1);
+                expired--;
+            }
+        }
+    }
+    bench_report("columns 1M: cfsm_fleet_indexOf column", start,
+        COLUMN_ROUNDS * COLUMN_INSTANCES);
+
+    if (0u != expired)
+    {
+        puts("bench_columns: results differ");
+    }
+
+    for (size_t i = 0u; i < fleet.count; ++i)
+    {
+        free(entries[i].fsm.ctxPtr);
+    }
+    free(entries);
+    free(onTime);
+}
+
+/**
+ * @brief Timeouts of 1M fleet instances, 1% of them expired.
+ *
+ * Compares process operations that poll "now - start" in every cycle,
+ * like the UnoBlink OnState, against cfsm_fleet_expire() signaling
+ * timeout events to instances that sleep until an event.
+ */
+static void bench_timeouts(void)
+{
+    cfsm_FleetEntry * entries = malloc(TIMEOUT_INSTANCES * sizeof(*entries));
+    cfsm_Time * starts = malloc(TIMEOUT_INSTANCES * sizeof(*starts));
+    cfsm_Time * deadlines = malloc(TIMEOUT_INSTANCES * sizeof(*deadlines));
+    uint32_t * armed = malloc(CFSM_FLEET_ARMED_WORDS(TIMEOUT_INSTANCES) * sizeof(*armed));
+    cfsm_Fleet fleet;
+    clock_t start;
+    unsigned long polled;
+
+    if ((NULL == entries) || (NULL == starts) || (NULL == deadlines) || (NULL == armed))
+    {
+        puts("bench_timeouts: out of memory");
+        free(entries);
+        free(starts);
+        free(deadlines);
+        free(armed);
+        return;
+    }
+
+    benchNow = 5000u;
+    benchFleet = &fleet;
+
+    /* Polling */
+    cfsm_fleet_init(&fleet, entries, TIMEOUT_INSTANCES);
+    for (size_t i = 0u; i < TIMEOUT_INSTANCES; ++i)
+    {
+        starts[i] = (0u == (i % 100u)) ? 0u : benchNow;
+        cfsm_transition(cfsm_fleet_add(&fleet, &starts[i]), Polling_onEnter);
+    }
+
+    benchSink = 0u;
+    start = clock();
+    for (unsigned int round = 0u; round < TIMEOUT_ROUNDS; ++round)
+    {
+        cfsm_fleet_process(&fleet, benchNow);
+    }
+    bench_report("timeouts 1M: polling process", start,
+        TIMEOUT_ROUNDS * TIMEOUT_INSTANCES);
+    polled = benchSink;
+
+    /* Deadline column */
+    cfsm_fleet_init(&fleet, entries, TIMEOUT_INSTANCES);
+    cfsm_fleet_attachDeadlines(&fleet, deadlines, armed);
+    for (size_t i = 0u; i < TIMEOUT_INSTANCES; ++i)
+    {
+        cfsm_Ctx * fsm = cfsm_fleet_add(&fleet, NULL);
+
+        cfsm_transition(fsm, Armed_onEnter);
+        cfsm_fleet_armTimeout(&fleet, fsm, starts[i] + COLUMN_TIMEOUT);
+    }
+    cfsm_fleet_process(&fleet, benchNow); /* settle sleep requests */
+
+    benchSink = 0u;
+    start = clock();
+    for (unsigned int round = 0u; round < TIMEOUT_ROUNDS; ++round)
+    {
+        (void)cfsm_fleet_expire(&fleet, benchNow, 1);
+    }
+    bench_report("timeouts 1M: cfsm_fleet_expire", start,
+        TIMEOUT_ROUNDS * TIMEOUT_INSTANCES);
+
+    if (polled != benchSink)
+    {
+        puts("bench_timeouts: results differ");
+    }
+
+    free(entries);
+    free(starts);
+    free(deadlines);
+    free(armed);
+}
+
+/**
+ * @brief Process cycles of a fleet with 1k, 100k and 1M sleepers.
+ *
+ * A few instances stay runnable, the others sleep beyond the measured
+ * cycles. The cost of a cycle must not grow with the number of sleepers.
+ */
+static void bench_sleepers(void)
+{
+    static const size_t sleepers[] = { 1000u, 100000u, SLEEPER_MAX };
+    static const char * const names[] = {
+        "sleepers 1k: process cycle",
+        "sleepers 100k: process cycle",
+        "sleepers 1M: process cycle"
+    };
+    cfsm_FleetEntry * entries = malloc((SLEEPER_MAX + SLEEPER_RUNNABLE) * sizeof(*entries));
+    cfsm_Fleet fleet;
+    clock_t start;
+
+    if (NULL == entries)
+    {
+        puts("bench_sleepers: out of memory");
+        return;
+    }
+
+    for (size_t run = 0u; run < (sizeof(sleepers) / sizeof(sleepers[0])); ++run)
+    {
+        cfsm_Time delay = 0u;
+
+        benchNow = 0u;
+        cfsm_fleet_init(&fleet, entries, sleepers[run] + SLEEPER_RUNNABLE);
+        for (size_t i = 0u; i < sleepers[run] + SLEEPER_RUNNABLE; ++i)
+        {
+            cfsm_transition(
+                cfsm_fleet_add(&fleet, NULL),
+                (i < SLEEPER_RUNNABLE) ? Ticking_onEnter : Dozing_onEnter);
+        }
+        cfsm_fleet_process(&fleet, benchNow); /* settle sleep requests */
+
+        start = clock();
+        for (cfsm_Time tick = 1u; tick <= SLEEPER_TICKS; ++tick)
+        {
+            cfsm_fleet_process(&fleet, tick);
+            (void)cfsm_fleet_nextProcess(&fleet, tick, &delay);
+        }
+        bench_report(names[run], start, SLEEPER_TICKS);
+    }
+
+    free(entries);
+}
+
+/**
+ * @brief Signal 32M events with and without latency recording.
+ *
+ * The clock is a counter, so the difference is the cost of recording
+ * without the cost of reading a real clock.
+ */
+static void bench_latency(void)
+{
+    static cfsm_Histogram histograms[CFSM_LATENCY_HISTOGRAMS(1u, EVENT_BATCH_SIZE)];
+    cfsm_Latency latency;
+    cfsm_Ctx fsm;
+    clock_t start;
+
+    cfsm_latency_init(&latency, histograms, 1u, EVENT_BATCH_SIZE, Bench_clock);
+    cfsm_init(&fsm, NULL);
+    cfsm_transition(&fsm, Counter_onEnter);
+
+    start = clock();
+    for (unsigned int round = 0u; round < EVENT_ROUNDS; ++round)
+    {
+        for (unsigned int i = 0u; i < EVENT_BATCH_SIZE; ++i)
+        {
+            cfsm_event(&fsm, (int)i);
+        }
+    }
+    bench_report("latency: cfsm_event", start, EVENT_ROUNDS * EVENT_BATCH_SIZE);
+
+    start = clock();
+    for (unsigned int round = 0u; round < EVENT_ROUNDS; ++round)
+    {
+        for (unsigned int i = 0u; i < EVENT_BATCH_SIZE; ++i)
+        {
+            cfsm_latency_event(&latency, 0u, &fsm, (int)i, benchTicks - (i & 0xFFu));
+        }
+    }
+    bench_report("latency: cfsm_latency_event", start, EVENT_ROUNDS * EVENT_BATCH_SIZE);
+
+    benchSink = (unsigned long)cfsm_histogram_percentile(
+        cfsm_latency_get(&latency, 0u, 0, CFSM_LATENCY_WAIT), 99.9);
+}
+
+static uint32_t Bench_clock(void)
+{
+    return ++benchTicks;
+}
+
+static void Counter_onEnter(cfsm_Ctx * fsm)
+{
+    fsm->onEvent = Counter_onEvent;
+}
+
+static void Counter_onEvent(cfsm_Ctx * fsm, int eventId)
+{
+    (void)eventId;
+    fsm->ctxPtr = (char *)fsm->ctxPtr + 1;
+}
+
+static void Primary_onEnter(cfsm_Ctx * fsm)
+{
+    fsm->onEvent = Primary_onEvent;
+    fsm->onLeave = Primary_onLeave;
+}
+
+static void Standby_onEnter(cfsm_Ctx * fsm)
+{
+    (void)fsm;
+}
+
+static void Recovery_onEnter(cfsm_Ctx * fsm)
+{
+    fsm->onEvent = Recovery_onEvent;
+    benchSink++;
+}
+
+static void Primary_onLeave(cfsm_Ctx * fsm)
+{
+    (void)fsm;
+    benchSink++;
+}
+
+static void Primary_onEvent(cfsm_Ctx * fsm, int eventId)
+{
+    (void)fsm;
+    benchSink += (unsigned long)eventId;
+}
+
+static void Recovery_onEvent(cfsm_Ctx * fsm, int eventId)
+{
+    (void)fsm;
+    benchSink += (unsigned long)eventId;
+}
+
+static void Ticking_onEnter(cfsm_Ctx * fsm)
+{
+    fsm->onProcess = Ticking_onProcess;
+    fsm->onEvent = Recovery_onEvent;
+}
+
+static void Ticking_onProcess(cfsm_Ctx * fsm)
+{
+    (void)fsm;
+    benchSink++;
+}
+
+static void Polling_onEnter(cfsm_Ctx * fsm)
+{
+    fsm->onProcess = Polling_onProcess;
+}
+
+static void Polling_onProcess(cfsm_Ctx * fsm)
+{
+    const cfsm_Time * started = (const cfsm_Time *)fsm->ctxPtr;
+
+    if ((benchNow - *started) >= COLUMN_TIMEOUT)
+    {
+        benchSink++;
+    }
+}
+
+static void Armed_onEnter(cfsm_Ctx * fsm)
+{
+    fsm->onEvent = Armed_onEvent;
+    cfsm_sleepUntilEvent(fsm);
+}
+
+static void Armed_onEvent(cfsm_Ctx * fsm, int eventId)
+{
+    (void)eventId;
+    benchSink++;
+
+    /* Rearm the expired deadline to get the same load every round. */
+    cfsm_fleet_armTimeout(benchFleet, fsm, benchNow - COLUMN_TIMEOUT);
+    cfsm_sleepUntilEvent(fsm);
+}
+
+static void Dozing_onEnter(cfsm_Ctx * fsm)
+{
+    fsm->onProcess = Ticking_onProcess;
+    cfsm_sleepUntil(fsm, benchNow + (2u * SLEEPER_TICKS));
+}
+
+/** @} */
@@ -0,0 +1,306 @@
+/* MIT License
+ *
+ * Copyright (C) 2024  Haju Schulz <haju@schulznorbert.de>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+/*******************************************************************************
+    DESCRIPTION
+*******************************************************************************/
+/**
+ * @brief  CFSM multi threaded benchmarks
+ *
+ * Measures false sharing between worker threads that own neighboring
+ * contexts or fleets, with plain and cache line padded types. Needs a
+ * host with several cores to show a difference:
+ *
+ *     build/bench/bench_threads [threads]
+ *
+ * @addtogroup bench
+ *
+ * @{
+ */
+
+/******************************************************************************
+ * Includes
+ *****************************************************************************/
+
+#define _POSIX_C_SOURCE 200112L
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "c_fsm.h"
+#include "c_fsm_fleet.h"
+
+/******************************************************************************
+ * Macros
+ *****************************************************************************/
+
+#define MAX_THREADS      16u        /**< Upper limit of worker threads     */
+#define CTX_PER_THREAD   8u         /**< Contexts owned by each worker     */
+#define CTX_ROUNDS       2000000u   /**< Transition rounds per worker      */
+#define FLEET_INSTANCES  4u         /**< Instances per worker fleet        */
+#define FLEET_ROUNDS     2000000u   /**< Process cycles per worker         */
+
+/******************************************************************************
+ * Types and Classes
+ *****************************************************************************/
+
+/** Work description of one worker thread */
+typedef struct Worker_ {
+    pthread_t        thread;    /**< Worker thread                        */
+    unsigned int     id;        /**< Worker number                        */
+    unsigned int     threads;   /**< Number of workers                    */
+    cfsm_Ctx *       contexts;  /**< Shared context array, interleaved    */
+    size_t           stride;    /**< Bytes between contexts               */
+    cfsm_Fleet *     fleet;     /**< Fleet owned by this worker           */
+    cfsm_FleetEntry * entries;  /**< Entry storage shared by all fleets   */
+    size_t           entrySize; /**< Size of entry storage in bytes       */
+} Worker;
+
+/******************************************************************************
+ * Prototypes
+ *****************************************************************************/
+
+static double bench_now(void);
+static void * bench_alloc(size_t size);
+static void * bench_alloc(size_t size)
+{
+    void * memory = NULL;
+
+    if (0 != posix_memalign(&memory, CFSM_CACHE_LINE, CFSM_CACHE_ROUND(size)))
+    {
+        return NULL;
+    }
+
+    return memory;
+}
+
+static void bench_run(const char * name, unsigned int threads, void * (*work)(void *), size_t operations);
+static void * bench_transitions(void * arg);
+static void * bench_fleets(void * arg);
+static void State_A_onEnter(cfsm_Ctx * fsm);
+static void State_B_onEnter(cfsm_Ctx * fsm);
+static void State_Tick_onEnter(cfsm_Ctx * fsm);
+static void State_Tick_onProcess(cfsm_Ctx * fsm);
+
+/******************************************************************************
+ * Variables
+ *****************************************************************************/
+
+static Worker workers[MAX_THREADS];     /**< worker descriptions */
+
+/******************************************************************************
+ * External functions
+ *****************************************************************************/
+
+int main(int argc, char * argv[])
+{
+    unsigned int threads = (argc > 1) ? (unsigned int)atoi(argv[1]) : 4u;
+    size_t contexts = (size_t)MAX_THREADS * CTX_PER_THREAD;
+    cfsm_Ctx * plainCtx;
+    cfsm_PaddedCtx * paddedCtx;
+    cfsm_Fleet * plainFleets;
+    cfsm_PaddedFleet * paddedFleets;
+    cfsm_FleetEntry * entries;
+
+    if ((threads < 1u) || (threads > MAX_THREADS))
+    {
+        threads = 4u;
+    }
+
+    plainCtx = bench_alloc(contexts * sizeof(cfsm_Ctx));
+    paddedCtx = bench_alloc(contexts * sizeof(cfsm_PaddedCtx));
+    plainFleets = bench_alloc(MAX_THREADS * sizeof(cfsm_Fleet));
+    paddedFleets = bench_alloc(MAX_THREADS * sizeof(cfsm_PaddedFleet));
+    entries = bench_alloc(MAX_THREADS * CFSM_CACHE_ROUND(FLEET_INSTANCES * sizeof(cfsm_FleetEntry)));
+
+    if ((NULL == plainCtx) || (NULL == paddedCtx) || (NULL == plainFleets) ||
+        (NULL == paddedFleets) || (NULL == entries))
+    {
+        puts("bench_threads: out of memory");
+        return 1;
+    }
+
+    printf("%u threads, cache line %u bytes\n", threads, (unsigned int)CFSM_CACHE_LINE);
+
+    /* Context i belongs to worker i % threads, so neighbors are owned
+     * by different threads.
+     */
+    for (unsigned int i = 0u; i < threads; ++i)
+    {
+        workers[i].contexts = plainCtx;
+        workers[i].stride = sizeof(cfsm_Ctx);
+    }
+    bench_run("transitions: cfsm_Ctx", threads, bench_transitions,
+        (size_t)threads * CTX_ROUNDS * CTX_PER_THREAD);
+
+    for (unsigned int i = 0u; i < threads; ++i)
+    {
+        workers[i].contexts = &paddedCtx[0].fsm;
+        workers[i].stride = sizeof(cfsm_PaddedCtx);
+    }
+    bench_run("transitions: cfsm_PaddedCtx", threads, bench_transitions,
+        (size_t)threads * CTX_ROUNDS * CTX_PER_THREAD);
+
+    /* One fleet per worker, the fleets are neighbors in an array. The
+     * entries are split by cfsm_fleet_initShard() in both cases.
+     */
+    for (unsigned int i = 0u; i < threads; ++i)
+    {
+        workers[i].fleet = &plainFleets[i];
+        workers[i].entries = entries;
+        workers[i].entrySize = threads * CFSM_CACHE_ROUND(FLEET_INSTANCES * sizeof(cfsm_FleetEntry));
+    }
+    bench_run("fleets: cfsm_Fleet", threads, bench_fleets,
+        (size_t)threads * FLEET_ROUNDS * FLEET_INSTANCES);
+
+    for (unsigned int i = 0u; i < threads; ++i)
+    {
+        workers[i].fleet = &paddedFleets[i].fleet;
+    }
+    bench_run("fleets: cfsm_PaddedFleet", threads, bench_fleets,
+        (size_t)threads * FLEET_ROUNDS * FLEET_INSTANCES);
+
+    free(plainCtx);
+    free(paddedCtx);
+    free(plainFleets);
+    free(paddedFleets);
+    free(entries);
+
+    return 0;
+}
+
+/******************************************************************************
+ * Local functions
+ *****************************************************************************/
+
+static double bench_now(void)
+{
+    struct timespec now;
+
+    (void)clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return (double)now.tv_sec + ((double)now.tv_nsec * 1e-9);
+}
+
+static void bench_run(const char * name, unsigned int threads, void * (*work)(void *), size_t operations)
+{
+    double start = bench_now();
+
+    for (unsigned int i = 0u; i < threads; ++i)
+    {
+        workers[i].id = i;
+        workers[i].threads = threads;
+        (void)pthread_create(&workers[i].thread, NULL, work, &workers[i]);
+    }
+
+    for (unsigned int i = 0u; i < threads; ++i)
+    {
+        (void)pthread_join(workers[i].thread, NULL);
+    }
+
+    printf("%-40s %10.2f ns/op  (%lu ops)\n",
+        name,
+        ((bench_now() - start) * 1e9) / (double)operations,
+        (unsigned long)operations);
+}
+
+/**
+ * @brief Transition the contexts of a worker back and forth.
+ */
+static void * bench_transitions(void * arg)
+{
+    Worker * worker = (Worker *)arg;
+    unsigned char * base = (unsigned char *)worker->contexts;
+
+    for (unsigned int i = 0u; i < CTX_PER_THREAD; ++i)
+    {
+        size_t index = ((size_t)i * worker->threads) + worker->id;
+
+        cfsm_init((cfsm_Ctx *)(base + (index * worker->stride)), NULL);
+    }
+
+    for (unsigned int round = 0u; round < CTX_ROUNDS; ++round)
+    {
+        cfsm_TransitionFunction next = (0u != (round & 1u)) ? State_A_onEnter : State_B_onEnter;
+
+        for (unsigned int i = 0u; i < CTX_PER_THREAD; ++i)
+        {
+            size_t index = ((size_t)i * worker->threads) + worker->id;
+
+            cfsm_transition((cfsm_Ctx *)(base + (index * worker->stride)), next);
+        }
+    }
+
+    return NULL;
+}
+
+/**
+ * @brief Run process cycles on the fleet of a worker.
+ */
+static void * bench_fleets(void * arg)
+{
+    Worker * worker = (Worker *)arg;
+
+    cfsm_fleet_initShard(
+        worker->fleet,
+        worker->entries,
+        worker->entrySize,
+        worker->id,
+        worker->threads);
+    for (unsigned int i = 0u; i < FLEET_INSTANCES; ++i)
+    {
+        cfsm_transition(cfsm_fleet_add(worker->fleet, NULL), State_Tick_onEnter);
+    }
+
+    for (cfsm_Time now = 0u; now < FLEET_ROUNDS; ++now)
+    {
+        cfsm_fleet_process(worker->fleet, now);
+    }
+
+    return NULL;
+}
+
+static void State_A_onEnter(cfsm_Ctx * fsm)
+{
+    fsm->onProcess = State_Tick_onProcess;
+}
+
+static void State_B_onEnter(cfsm_Ctx * fsm)
+{
+    (void)fsm;
+}
+
+static void State_Tick_onEnter(cfsm_Ctx * fsm)
+{
+    fsm->onProcess = State_Tick_onProcess;
+}
+
+static void State_Tick_onProcess(cfsm_Ctx * fsm)
+{
+    fsm->ctxPtr = (char *)fsm->ctxPtr + 1;
+}
+
+/** @} */
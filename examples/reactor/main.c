@@ -0,0 +1,280 @@
+/* MIT License
+ *
+ * Copyright (C) 2024  Haju Schulz <haju@schulznorbert.de>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+/*******************************************************************************
+    DESCRIPTION
+*******************************************************************************/
+/**
+ * @brief  CFSM Linux epoll reactor example
+ *
+ * Drives a fleet of connection FSMs from file descriptor readiness. Each
+ * instance owns the read end of a pipe, which stands in for a socket.
+ *
+ * - States register their interest in the descriptor on enter. The
+ *   busy state ignores readiness, the idle state waits for it.
+ * - The epoll registration of a descriptor carries the instance handle,
+ *   so readiness maps to the instance without a lookup table and events
+ *   for removed instances are dropped as stale.
+ * - All ready descriptors of one epoll_wait() call are delivered as one
+ *   batch through cfsm_fleet_ingest().
+ * - The epoll_wait() timeout comes from cfsm_fleet_nextProcess(), so
+ *   sleeping instances are woken in time without a timerfd per instance.
+ *
+ * Other threads can wake the loop by registering an eventfd the same way.
+ *
+ * @addtogroup ReactorExample
+ *
+ * @{
+ */
+
+/******************************************************************************
+ * Includes
+ *****************************************************************************/
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "c_fsm.h"
+#include "c_fsm_fleet.h"
+
+/******************************************************************************
+ * Macros
+ *****************************************************************************/
+
+#define CONNECTIONS     8       /**< Number of connection FSMs          */
+#define MAX_READY       16      /**< epoll events per wait              */
+#define BUSY_TIME_MS    50u     /**< Time a connection stays busy       */
+#define EV_READABLE     1       /**< Event: descriptor became readable  */
+
+/******************************************************************************
+ * Types and Classes
+ *****************************************************************************/
+
+/** Connection instance data */
+typedef struct Connection {
+    int readFd;         /**< Descriptor owned by the instance         */
+    int writeFd;        /**< Peer end, used by main to send requests  */
+    int id;             /**< Connection number for printing           */
+    int requests;       /**< Number of handled requests               */
+} Connection;
+
+/******************************************************************************
+ * Prototypes
+ *****************************************************************************/
+
+static cfsm_Time now_ms(void);
+static void watch(cfsm_Ctx * fsm, uint32_t events);
+
+static void Idle_onEnter(cfsm_Ctx * fsm);
+static void Idle_onEvent(cfsm_Ctx * fsm, int eventId);
+static void Busy_onEnter(cfsm_Ctx * fsm);
+static void Busy_onProcess(cfsm_Ctx * fsm);
+
+/******************************************************************************
+ * Variables
+ *****************************************************************************/
+
+static cfsm_FleetEntry entries[CONNECTIONS];    /**< fleet storage        */
+static cfsm_Fleet fleet;                        /**< connection fleet     */
+static Connection connections[CONNECTIONS];     /**< instance data        */
+static int epollFd;                             /**< reactor descriptor   */
+
+/******************************************************************************
+ * External functions
+ *****************************************************************************/
+
+int main(void)
+{
+    int handled = 0;
+    int sent = 0;
+
+    epollFd = epoll_create1(0);
+    if (epollFd < 0)
+    {
+        perror("epoll_create1");
+        return 1;
+    }
+
+    cfsm_fleet_init(&fleet, entries, CONNECTIONS);
+
+    for (int i = 0; i < CONNECTIONS; ++i)
+    {
+        Connection * conn = &connections[i];
+        struct epoll_event ev;
+        int fds[2];
+        cfsm_Ctx * fsm;
+
+        if (0 != pipe(fds))
+        {
+            perror("pipe");
+            return 1;
+        }
+        (void)fcntl(fds[0], F_SETFL, O_NONBLOCK);
+
+        conn->readFd = fds[0];
+        conn->writeFd = fds[1];
+        conn->id = i;
+        conn->requests = 0;
+
+        fsm = cfsm_fleet_add(&fleet, conn);
+
+        /* The handle is the epoll user data. */
+        memset(&ev, 0, sizeof(ev));
+        ev.data.u32 = cfsm_fleet_handleOf(&fleet, fsm);
+        (void)epoll_ctl(epollFd, EPOLL_CTL_ADD, conn->readFd, &ev);
+
+        cfsm_transition(fsm, Idle_onEnter);
+    }
+
+    while (handled < 3 * CONNECTIONS)
+    {
+        struct epoll_event ready[MAX_READY];
+        cfsm_Handle targets[MAX_READY];
+        int events[MAX_READY];
+        cfsm_Time delay;
+        int timeout = -1;
+        int count;
+
+        /* Simulate requests from peers: send to every third connection. */
+        if (sent < 3 * CONNECTIONS)
+        {
+            Connection * conn = &connections[(sent * 3) % CONNECTIONS];
+
+            (void)write(conn->writeFd, "request", 7u);
+            ++sent;
+        }
+
+        if (0 != cfsm_fleet_nextProcess(&fleet, now_ms(), &delay))
+        {
+            timeout = (int)delay;
+        }
+
+        count = epoll_wait(epollFd, ready, MAX_READY, timeout);
+        for (int i = 0; i < count; ++i)
+        {
+            targets[i] = ready[i].data.u32;
+            events[i] = EV_READABLE;
+        }
+        if (count > 0)
+        {
+            (void)cfsm_fleet_ingest(&fleet, targets, events, (size_t)count, NULL, NULL);
+        }
+
+        cfsm_fleet_process(&fleet, now_ms());
+
+        handled = 0;
+        for (int i = 0; i < CONNECTIONS; ++i)
+        {
+            handled += connections[i].requests;
+        }
+    }
+
+    printf("handled %d requests\n", handled);
+
+    for (int i = 0; i < CONNECTIONS; ++i)
+    {
+        (void)close(connections[i].readFd);
+        (void)close(connections[i].writeFd);
+    }
+    (void)close(epollFd);
+
+    return 0;
+}
+
+/******************************************************************************
+ * Local functions
+ *****************************************************************************/
+
+static cfsm_Time now_ms(void)
+{
+    struct timespec ts;
+
+    (void)clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (cfsm_Time)((ts.tv_sec * 1000) + (ts.tv_nsec / 1000000));
+}
+
+static void watch(cfsm_Ctx * fsm, uint32_t events)
+{
+    Connection * conn = (Connection *)fsm->ctxPtr;
+    struct epoll_event ev;
+
+    memset(&ev, 0, sizeof(ev));
+    ev.events = events;
+    ev.data.u32 = cfsm_fleet_handleOf(&fleet, fsm);
+    (void)epoll_ctl(epollFd, EPOLL_CTL_MOD, conn->readFd, &ev);
+}
+
+static void Idle_onEnter(cfsm_Ctx * fsm)
+{
+    /* Nothing to do until the descriptor becomes readable. */
+    fsm->onEvent = Idle_onEvent;
+    watch(fsm, EPOLLIN);
+    cfsm_sleepUntilEvent(fsm);
+}
+
+static void Idle_onEvent(cfsm_Ctx * fsm, int eventId)
+{
+    Connection * conn = (Connection *)fsm->ctxPtr;
+    char buffer[64];
+    ssize_t size;
+
+    if (EV_READABLE != eventId)
+    {
+        return;
+    }
+
+    /* Drain the descriptor, level triggered epoll reports it again. */
+    while ((size = read(conn->readFd, buffer, sizeof(buffer))) > 0)
+    {
+        conn->requests += (int)(size / 7);
+    }
+
+    printf("connection %d: request received (%d total)\n", conn->id, conn->requests);
+    cfsm_transition(fsm, Busy_onEnter);
+}
+
+static void Busy_onEnter(cfsm_Ctx * fsm)
+{
+    /* Pretend to work, resume processing after BUSY_TIME_MS. New
+     * requests stay in the pipe until the idle state watches again.
+     */
+    fsm->onProcess = Busy_onProcess;
+    watch(fsm, 0u);
+    cfsm_sleepUntil(fsm, now_ms() + BUSY_TIME_MS);
+}
+
+static void Busy_onProcess(cfsm_Ctx * fsm)
+{
+    Connection * conn = (Connection *)fsm->ctxPtr;
+
+    printf("connection %d: request done\n", conn->id);
+    cfsm_transition(fsm, Idle_onEnter);
+}
+
+/** @} */
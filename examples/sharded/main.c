@@ -0,0 +1,267 @@
+/* MIT License
+ *
+ * Copyright (C) 2024  Haju Schulz <haju@schulznorbert.de>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+/*******************************************************************************
+    DESCRIPTION
+*******************************************************************************/
+/**
+ * @brief  CFSM Linux sharded fleet example
+ *
+ * Runs one fleet shard per worker thread on multi socket (NUMA) hosts.
+ *
+ * - Each worker pins itself to a CPU, maps the storage of its shard and
+ *   adds the instances itself. Linux places pages on the node of the
+ *   thread that touches them first, so the shard ends up on the node of
+ *   its worker without libnuma. cfsm_fleet_init() does not touch the
+ *   entries, they are first written by cfsm_fleet_add().
+ * - With "--huge", shard storage is advised to use transparent huge
+ *   pages to reduce TLB misses.
+ * - After the run, the layout of each shard is printed from
+ *   cfsm_fleet_stats() and the node of the shard pages as reported by
+ *   get_mempolicy().
+ *
+ * Workers never share a fleet, so the process loop needs no locking.
+ * Events from other threads need to be passed to the owning worker,
+ * for example by a queue that the worker ingests.
+ *
+ * @addtogroup ShardedExample
+ *
+ * @{
+ */
+
+/******************************************************************************
+ * Includes
+ *****************************************************************************/
+
+#define _GNU_SOURCE
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "c_fsm.h"
+#include "c_fsm_fleet.h"
+
+/******************************************************************************
+ * Macros
+ *****************************************************************************/
+
+#define MAX_WORKERS      8        /**< Upper limit of worker threads       */
+#define SHARD_INSTANCES  262144u  /**< Instances per shard                 */
+#define ROUNDS           100u     /**< Process cycles per worker           */
+#define HUGE_PAGE_SIZE   (2u * 1024u * 1024u) /**< Shard size granularity */
+
+#define QUERY_NODE       1        /**< get_mempolicy MPOL_F_NODE           */
+#define QUERY_ADDR       2        /**< get_mempolicy MPOL_F_ADDR           */
+
+/******************************************************************************
+ * Types and Classes
+ *****************************************************************************/
+
+/** A fleet shard owned by one worker thread */
+typedef struct Shard {
+    pthread_t       thread;     /**< Worker thread                     */
+    int             cpu;        /**< CPU the worker is pinned to        */
+    int             cpuNode;    /**< NUMA node of that CPU              */
+    void *          storage;    /**< Mapped entry storage               */
+    size_t          mapped;     /**< Size of the mapping                */
+    cfsm_Fleet      fleet;      /**< The shard fleet                    */
+    unsigned long   ticks;      /**< Process cycles seen by instances   */
+} Shard;
+
+/** A shard padded to whole cache lines, so the hot fleet data and
+ *  counters of one worker never share a cache line with another worker.
+ */
+typedef union PaddedShard {
+    Shard         shard;                                /**< The shard */
+    unsigned char pad[CFSM_CACHE_ROUND(sizeof(Shard))]; /**< Padding   */
+} PaddedShard;
+
+/******************************************************************************
+ * Prototypes
+ *****************************************************************************/
+
+static void * worker(void * arg);
+static int pageNode(const void * address);
+
+static void Counting_onEnter(cfsm_Ctx * fsm);
+static void Counting_onProcess(cfsm_Ctx * fsm);
+
+/******************************************************************************
+ * Variables
+ *****************************************************************************/
+
+static PaddedShard shards[MAX_WORKERS]  /**< one shard per worker      */
+    __attribute__((aligned(CFSM_CACHE_LINE)));
+static int useHugePages;            /**< "--huge" given                */
+
+/******************************************************************************
+ * External functions
+ *****************************************************************************/
+
+int main(int argc, char * argv[])
+{
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    int workers = (cpus < 1) ? 1 : ((cpus > MAX_WORKERS) ? MAX_WORKERS : (int)cpus);
+
+    useHugePages = (argc > 1) && (0 == strcmp(argv[1], "--huge"));
+
+    for (int i = 0; i < workers; ++i)
+    {
+        shards[i].shard.cpu = i;
+        if (0 != pthread_create(&shards[i].shard.thread, NULL, worker, &shards[i].shard))
+        {
+            perror("pthread_create");
+            return 1;
+        }
+    }
+
+    printf("shard cpu cpu-node page-nodes(first,last) live runnable bytes ticks\n");
+
+    for (int i = 0; i < workers; ++i)
+    {
+        Shard * shard = &shards[i].shard;
+        cfsm_FleetStats stats;
+
+        (void)pthread_join(shard->thread, NULL);
+
+        if (NULL == shard->storage)
+        {
+            printf("%5d: no storage\n", i);
+            continue;
+        }
+
+        cfsm_fleet_stats(&shard->fleet, &stats);
+        printf("%5d %3d %8d %6d,%-6d %8lu %8lu %9lu %lu\n",
+            i,
+            shard->cpu,
+            shard->cpuNode,
+            pageNode(stats.storage),
+            pageNode((const char *)stats.storage + stats.storageBytes - 1u),
+            (unsigned long)stats.live,
+            (unsigned long)stats.runnable,
+            (unsigned long)stats.storageBytes,
+            shard->ticks);
+
+        (void)munmap(shard->storage, shard->mapped);
+    }
+
+    return 0;
+}
+
+/******************************************************************************
+ * Local functions
+ *****************************************************************************/
+
+/**
+ * @brief Worker thread owning one fleet shard.
+ *
+ * @param arg The shard of this worker.
+ * @return Always NULL.
+ */
+static void * worker(void * arg)
+{
+    Shard * shard = (Shard *)arg;
+    cpu_set_t cpuSet;
+    unsigned int cpu = 0u;
+    unsigned int node = 0u;
+
+    CPU_ZERO(&cpuSet);
+    CPU_SET(shard->cpu, &cpuSet);
+    (void)pthread_setaffinity_np(pthread_self(), sizeof(cpuSet), &cpuSet);
+
+    shard->cpuNode = -1;
+    if (0 == syscall(SYS_getcpu, &cpu, &node, NULL))
+    {
+        shard->cpuNode = (int)node;
+    }
+
+    /* Map, but do not touch. The pages are placed when first written
+     * by cfsm_fleet_add() below, which runs on this worker's node.
+     */
+    shard->mapped = SHARD_INSTANCES * sizeof(cfsm_FleetEntry);
+    shard->mapped = (shard->mapped + HUGE_PAGE_SIZE - 1u) & ~(size_t)(HUGE_PAGE_SIZE - 1u);
+    shard->storage = mmap(NULL, shard->mapped, PROT_READ | PROT_WRITE,
+        MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (MAP_FAILED == shard->storage)
+    {
+        shard->storage = NULL;
+        return NULL;
+    }
+
+#ifdef MADV_HUGEPAGE
+    if (0 != useHugePages)
+    {
+        (void)madvise(shard->storage, shard->mapped, MADV_HUGEPAGE);
+    }
+#endif
+
+    cfsm_fleet_init(&shard->fleet, (cfsm_FleetEntry *)shard->storage, SHARD_INSTANCES);
+    for (size_t i = 0u; i < SHARD_INSTANCES; ++i)
+    {
+        cfsm_transition(cfsm_fleet_add(&shard->fleet, shard), Counting_onEnter);
+    }
+
+    for (cfsm_Time now = 0u; now < ROUNDS; ++now)
+    {
+        cfsm_fleet_process(&shard->fleet, now);
+    }
+
+    return NULL;
+}
+
+/**
+ * @brief Get the NUMA node of the page holding an address.
+ *
+ * @param address An address of a touched page.
+ * @return The node or -1 if unknown, e.g. on kernels without NUMA.
+ */
+static int pageNode(const void * address)
+{
+    int node = -1;
+
+    if (0 != syscall(SYS_get_mempolicy, &node, NULL, 0ul, address,
+        QUERY_NODE | QUERY_ADDR))
+    {
+        return -1;
+    }
+
+    return node;
+}
+
+static void Counting_onEnter(cfsm_Ctx * fsm)
+{
+    fsm->onProcess = Counting_onProcess;
+}
+
+static void Counting_onProcess(cfsm_Ctx * fsm)
+{
+    ((Shard *)fsm->ctxPtr)->ticks++;
+}
+
+/** @} */
@@ -33,79 +33,376 @@
  *
  * Repository: https://github.com/nhjschulz/cfsm
  *
+ * With CFSM_HEADER_ONLY defined, c_fsm.h includes this file to provide
+ * the functions as static inline definitions.
  */
 
+#ifndef SRC_C_FSM_C_FSM_C_
+#define SRC_C_FSM_C_FSM_C_
+
 /******************************************************************************
  * Includes
  *****************************************************************************/
 #include "c_fsm.h"
 
+#if defined(CFSM_ENABLE_PROFILE)
+#include "c_fsm_profile.h"
+#endif
+
+#if defined(CFSM_ENABLE_USDT)
+#include "c_fsm_sdt.h"
+#endif
+
+#if defined(CFSM_ENABLE_TRACE)
+#include "c_fsm_trace.h"
+#endif
+
+#if defined(CFSM_ENABLE_HITS)
+#include "c_fsm_hits.h"
+#endif
+
 /******************************************************************************
  * Macros
  *****************************************************************************/
 
+#if defined(CFSM_CONFIG_NOOP_HANDLERS)
+/* Handlers are never NULL, the check folds to a constant. */
+#define CFSM_HANDLER_SET(handler) (1)
+#else
+#define CFSM_HANDLER_SET(handler) (0 != (handler))
+#endif
+
+#if defined(CFSM_ENABLE_PROFILE)
+/* Time the operation of a state, see c_fsm_profile.h. */
+#define CFSM_PROFILE_START(op_state) \
+    cfsm_TransitionFunction profileState = (op_state); \
+    uint32_t profileSlot = fsm->profileSlot; \
+    cfsm_ProfileTick profileStart = cfsm_profile_now()
+#define CFSM_PROFILE_STOP(op) \
+    cfsm_profile_record(profileState, profileSlot, (op), profileStart)
+#else
+#define CFSM_PROFILE_START(op_state)
+#define CFSM_PROFILE_STOP(op)
+#endif
+
+#if defined(CFSM_ENABLE_USDT)
+/* Static tracepoints, see c_fsm_sdt.h. Arguments are context address,
+ * state identity and event ID.
+ */
+#define CFSM_PROBE_LEAVE(fsm) \
+    CFSM_SDT_PROBE2(cfsm, leave, (fsm), (fsm)->state)
+#define CFSM_PROBE_ENTER(fsm) \
+    CFSM_SDT_PROBE2(cfsm, enter, (fsm), (fsm)->state)
+#define CFSM_PROBE_PROCESS(fsm) \
+    CFSM_SDT_PROBE2(cfsm, process, (fsm), (fsm)->state)
+#define CFSM_PROBE_EVENT(fsm, eventId) \
+    CFSM_SDT_PROBE3(cfsm, event, (fsm), (fsm)->state, (eventId))
+#else
+#define CFSM_PROBE_LEAVE(fsm)
+#define CFSM_PROBE_ENTER(fsm)
+#define CFSM_PROBE_PROCESS(fsm)
+#define CFSM_PROBE_EVENT(fsm, eventId)
+#endif
+
+#if defined(CFSM_ENABLE_TRACE)
+/* Record into the attached trace, see c_fsm_trace.h. */
+#define CFSM_RECORD(kind, fsm, eventId) cfsm_trace_record((kind), (fsm), (eventId))
+#else
+#define CFSM_RECORD(kind, fsm, eventId)
+#endif
+
+#if defined(CFSM_ENABLE_HITS)
+/* Count the event in the hit matrix, see c_fsm_hits.h. Handlers are
+ * compared against CFSM_NO_* to detect unhandled events also with
+ * CFSM_CONFIG_NOOP_HANDLERS.
+ */
+#define CFSM_HIT(fsm, eventId, handled) \
+    cfsm_hits_record((fsm)->state, (eventId), (handled))
+#else
+#define CFSM_HIT(fsm, eventId, handled)
+#endif
+
+#if !defined(CFSM_HEADER_ONLY)
+/* Plain events hide the payload of an enclosing cfsm_eventData() call
+ * from their handlers, see cfsm_eventPayload().
+ */
+#define CFSM_PAYLOAD_HIDE() \
+    const event_Payload * const hiddenPayload = activePayload; \
+    activePayload = (const event_Payload *)0
+#define CFSM_PAYLOAD_SHOW() \
+    activePayload = hiddenPayload
+#else
+#define CFSM_PAYLOAD_HIDE()
+#define CFSM_PAYLOAD_SHOW()
+#endif
+
+/* Storage of the payload of cfsm_eventData(), one per thread. */
+#if defined(__STDC_VERSION__) && (__STDC_VERSION__ >= 201112L) && \
+    !defined(__STDC_NO_THREADS__)
+#define CFSM_THREAD_LOCAL _Thread_local
+#elif defined(__GNUC__) && !defined(__AVR__)
+#define CFSM_THREAD_LOCAL __thread
+#elif defined(_MSC_VER)
+#define CFSM_THREAD_LOCAL __declspec(thread)
+#else
+#define CFSM_THREAD_LOCAL
+#endif
+
 /******************************************************************************
  * Types and Classes
  *****************************************************************************/
 
+#if !defined(CFSM_HEADER_ONLY)
+
+/** Payload of a running cfsm_eventData() call
+ */
+typedef struct event_Payload {
+    const struct cfsm_Ctx *       fsm;   /**< Receiving context             */
+    const void *                  data;  /**< The borrowed payload          */
+    size_t                        size;  /**< Payload size in bytes         */
+    const struct event_Payload *  outer; /**< Payload of an enclosing call  */
+} event_Payload;
+
+#endif
+
 /******************************************************************************
  * Prototypes
  *****************************************************************************/
 
+static inline void event_signal(struct cfsm_Ctx * fsm, int eventId);
+
 /******************************************************************************
  * Variables
  *****************************************************************************/
 
+#if !defined(CFSM_HEADER_ONLY)
+static CFSM_THREAD_LOCAL const event_Payload * activePayload; /**< Innermost payload */
+#endif
+
 /******************************************************************************
  * External functions
  *****************************************************************************/
 
-void cfsm_init(struct cfsm_Ctx * fsm, cfsm_InstanceDataPtr instanceData)
+CFSM_API void cfsm_init(
+    struct cfsm_Ctx * fsm,
+    cfsm_InstanceDataPtr instanceData)
 {
-    *fsm = (cfsm_Ctx) {instanceData, 0, 0, 0};
+    /* Assigned one by one, as the header only mode may be compiled
+     * as C++ which lacks compound literals.
+     */
+    fsm->ctxPtr      = instanceData;
+    fsm->onLeave     = CFSM_NO_LEAVE;
+    fsm->onProcess   = CFSM_NO_PROCESS;
+    fsm->onEvent     = CFSM_NO_EVENT;
+#if defined(CFSM_ENABLE_STATE_ID)
+    fsm->state       = (cfsm_TransitionFunction)0;
+#endif
+#if defined(CFSM_ENABLE_PROFILE)
+    fsm->profileEntered = 0u;
+    fsm->profileSlot    = CFSM_PROFILE_NO_SLOT;
+#endif
 }
 
-void cfsm_transition(struct cfsm_Ctx * fsm, cfsm_TransitionFunction enterFunc)
+CFSM_API void cfsm_transition(
+    struct cfsm_Ctx * fsm,
+    cfsm_TransitionFunction enterFunc)
 {
+#if defined(CFSM_ENABLE_PROFILE)
+    cfsm_profile_dwell(fsm->state, fsm->profileSlot, fsm->profileEntered);
+#endif
+
+    CFSM_PROBE_LEAVE(fsm);
+    CFSM_RECORD(CFSM_TRACE_LEAVE, fsm, 0);
+
     /* Call former state leave operations if present. */
-    if ((cfsm_TransitionFunction)0 != fsm->onLeave)
+    if (CFSM_HANDLER_SET(fsm->onLeave))
     {
+        CFSM_PROFILE_START(fsm->state);
         fsm->onLeave(fsm);
+        CFSM_PROFILE_STOP(CFSM_PROFILE_LEAVE);
     }
 
     /* Clear all handler. They get set by the enter function if needed.
      */
-    fsm->onEvent  = (cfsm_EventFunction)0;
-    fsm->onLeave  = (cfsm_TransitionFunction)0;
-    fsm->onProcess= (cfsm_ProcessFunction)0;
+    fsm->onEvent  = CFSM_NO_EVENT;
+    fsm->onLeave  = CFSM_NO_LEAVE;
+    fsm->onProcess= CFSM_NO_PROCESS;
+
+#if defined(CFSM_ENABLE_STATE_ID)
+    /* Record new state before entering it, as the enter function
+     * may transition again.
+     */
+    fsm->state = enterFunc;
+#endif
+#if defined(CFSM_ENABLE_PROFILE)
+    /* Look the state up once, the operations use the cached slot. */
+    fsm->profileSlot    = cfsm_profile_slot(enterFunc);
+    fsm->profileEntered = cfsm_profile_now();
+#endif
+
+    CFSM_PROBE_ENTER(fsm);
+    CFSM_RECORD(CFSM_TRACE_ENTER, fsm, 0);
 
     /* Call enter function NULL checked. It might be NULL to "disable"
      * all FSM operations.
      */
     if ((cfsm_TransitionFunction)0 != enterFunc)
     {
+        CFSM_PROFILE_START(enterFunc);
         enterFunc(fsm);
+        CFSM_PROFILE_STOP(CFSM_PROFILE_ENTER);
     }
 }
 
-void cfsm_process(struct cfsm_Ctx * fsm)
+CFSM_API void cfsm_process(struct cfsm_Ctx * fsm)
 {
+    CFSM_PROBE_PROCESS(fsm);
+
     /* Delegate to state processing operation if handler is defined. */
-    if ((cfsm_ProcessFunction)0 != fsm->onProcess)
+    if (CFSM_HANDLER_SET(fsm->onProcess))
     {
+        CFSM_PROFILE_START(fsm->state);
         fsm->onProcess(fsm);
+        CFSM_PROFILE_STOP(CFSM_PROFILE_PROCESS);
     }
 }
 
-void cfsm_event(struct cfsm_Ctx * fsm, int eventId)
+CFSM_API void cfsm_event(struct cfsm_Ctx * fsm, int eventId)
 {
-    /* Delegate to state event processing if handler is defined. */
-    if ((cfsm_EventFunction)0 != fsm->onEvent)
+    CFSM_PAYLOAD_HIDE();
+    event_signal(fsm, eventId);
+    CFSM_PAYLOAD_SHOW();
+}
+
+CFSM_API size_t cfsm_eventBatch(
+    struct cfsm_Ctx * fsm,
+    const int * eventIds,
+    size_t count)
+{
+    const int * const end = eventIds + count;
+    size_t delivered = 0u;
+    CFSM_PAYLOAD_HIDE();
+
+    for (; eventIds != end; ++eventIds)
     {
-        fsm->onEvent(fsm, eventId);
+        /* The handler is read again for every event, as the previous
+         * one may have caused a transition. Without handler, no further
+         * transition can happen and the rest of the batch is dropped.
+         * The check is against CFSM_NO_EVENT, so no-op handlers are not
+         * called for the dropped rest either.
+         */
+        cfsm_EventFunction handler = fsm->onEvent;
+
+        if (CFSM_NO_EVENT == handler)
+        {
+#if defined(CFSM_ENABLE_HITS) || defined(CFSM_ENABLE_USDT) || \
+    defined(CFSM_ENABLE_TRACE)
+            /* Report the dropped rest like unhandled cfsm_event() calls. */
+            for (; eventIds != end; ++eventIds)
+            {
+                CFSM_PROBE_EVENT(fsm, *eventIds);
+                CFSM_RECORD(CFSM_TRACE_EVENT, fsm, *eventIds);
+                CFSM_HIT(fsm, *eventIds, 0);
+            }
+#endif
+            break;
+        }
+
+        CFSM_PROBE_EVENT(fsm, *eventIds);
+        CFSM_RECORD(CFSM_TRACE_EVENT, fsm, *eventIds);
+        CFSM_HIT(fsm, *eventIds, 1);
+        CFSM_PROFILE_START(fsm->state);
+        handler(fsm, *eventIds);
+        CFSM_PROFILE_STOP(CFSM_PROFILE_EVENT);
+        ++delivered;
     }
+
+    CFSM_PAYLOAD_SHOW();
+
+    return delivered;
 }
 
+#if !defined(CFSM_HEADER_ONLY)
+
+void cfsm_eventData(
+    struct cfsm_Ctx * fsm,
+    int eventId,
+    const void * data,
+    size_t size)
+{
+    event_Payload payload;
+
+    payload.fsm   = fsm;
+    payload.data  = data;
+    payload.size  = size;
+    payload.outer = activePayload;
+    activePayload = &payload;
+
+    event_signal(fsm, eventId);
+
+    activePayload = payload.outer;
+}
+
+const void * cfsm_eventPayload(const struct cfsm_Ctx * fsm, size_t * size)
+{
+    const event_Payload * payload = activePayload;
+
+    if (((const event_Payload *)0 == payload) || (fsm != payload->fsm))
+    {
+        payload = (const event_Payload *)0;
+    }
+
+    if ((size_t *)0 != size)
+    {
+        *size = ((const event_Payload *)0 != payload) ? payload->size : 0u;
+    }
+
+    return ((const event_Payload *)0 != payload) ? payload->data : (const void *)0;
+}
+
+#endif
+
+#if defined(CFSM_CONFIG_NOOP_HANDLERS) && !defined(CFSM_HEADER_ONLY)
+
+void cfsm_noop(struct cfsm_Ctx * fsm)
+{
+    (void)fsm;
+}
+
+void cfsm_noopEvent(struct cfsm_Ctx * fsm, int eventId)
+{
+    (void)fsm;
+    (void)eventId;
+}
+
+#endif
+
 /******************************************************************************
  * Local functions
  *****************************************************************************/
+
+/**
+ * @brief Signal an event to the active state, see cfsm_event().
+ *
+ * Shared by cfsm_event() and cfsm_eventData(), which differ in the
+ * payload they show to the handler.
+ *
+ * @param fsm The state machine.
+ * @param eventId The event ID.
+ */
+static inline void event_signal(struct cfsm_Ctx * fsm, int eventId)
+{
+    CFSM_PROBE_EVENT(fsm, eventId);
+    CFSM_RECORD(CFSM_TRACE_EVENT, fsm, eventId);
+    CFSM_HIT(fsm, eventId, CFSM_NO_EVENT != fsm->onEvent);
+
+    /* Delegate to state event processing if handler is defined. */
+    if (CFSM_HANDLER_SET(fsm->onEvent))
+    {
+        CFSM_PROFILE_START(fsm->state);
+        fsm->onEvent(fsm, eventId);
+        CFSM_PROFILE_STOP(CFSM_PROFILE_EVENT);
+    }
+}
+
+#endif /* SRC_C_FSM_C_FSM_C_ */
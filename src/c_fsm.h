@@ -47,6 +47,11 @@ extern "C" {
 /******************************************************************************
  * Includes
  *****************************************************************************/
+#include <stddef.h>
+
+#if defined(CFSM_ENABLE_PROFILE)
+#include <stdint.h>
+#endif
 
 /******************************************************************************
  * Macros
@@ -56,6 +61,46 @@ extern "C" {
 #define CFSM_VER_MINOR 3  /**< semantic versioning minor  x.X.x */
 #define CFSM_VER_PATCH 0  /**< semantic versioning patch  x.x.X */
 
+#ifndef CFSM_CACHE_LINE
+/** Cache line size in bytes used by padded types. */
+#define CFSM_CACHE_LINE 64u
+#endif
+
+/** Size in bytes rounded up to whole cache lines. */
+#define CFSM_CACHE_ROUND(size) \
+    ((((size) + CFSM_CACHE_LINE - 1u) / CFSM_CACHE_LINE) * CFSM_CACHE_LINE)
+
+#if defined(CFSM_HEADER_ONLY)
+/* The implementation is included at the end of this file. */
+#define CFSM_API static inline  /**< CFSM function linkage */
+#else
+#define CFSM_API                /**< CFSM function linkage */
+#endif
+
+#if (defined(CFSM_ENABLE_PROFILE) || defined(CFSM_ENABLE_USDT) || \
+     defined(CFSM_ENABLE_TRACE) || defined(CFSM_ENABLE_HITS)) && \
+    !defined(CFSM_ENABLE_STATE_ID)
+/* The diagnostic hooks report the active state. */
+#define CFSM_ENABLE_STATE_ID
+#endif
+
+#if defined(CFSM_CONFIG_NOOP_HANDLERS)
+
+/* Unset handlers are shared no-op functions. Dispatch calls them
+ * unconditionally instead of NULL checking the handler first.
+ */
+#define CFSM_NO_LEAVE      cfsm_noop      /**< unset onLeave     */
+#define CFSM_NO_PROCESS    cfsm_noop      /**< unset onProcess   */
+#define CFSM_NO_EVENT      cfsm_noopEvent /**< unset onEvent     */
+
+#else
+
+#define CFSM_NO_LEAVE      ((cfsm_TransitionFunction)0) /**< unset onLeave     */
+#define CFSM_NO_PROCESS    ((cfsm_ProcessFunction)0)    /**< unset onProcess   */
+#define CFSM_NO_EVENT      ((cfsm_EventFunction)0)      /**< unset onEvent     */
+
+#endif
+
 /******************************************************************************
  * Types and Classes
  *****************************************************************************/
@@ -88,14 +133,41 @@ typedef void (*cfsm_ProcessFunction)(struct cfsm_Ctx * fsm);
 typedef void *cfsm_InstanceDataPtr;
 
 /** The CFSM context data structure
+ *
+ * The state identity is only present with CFSM_ENABLE_STATE_ID, which
+ * fleets, compact fleets, traces and performance counters require and
+ * the diagnostic hooks imply. Without it, the context is 4 pointers as in
+ * CFSM 0.3.
 */
 typedef struct cfsm_Ctx {
-    cfsm_InstanceDataPtr    ctxPtr;    /**< Context instance data        */
-    cfsm_TransitionFunction onLeave;   /**< Operation to run on leave    */
-    cfsm_ProcessFunction    onProcess; /**< Cyclic processoperation      */
-    cfsm_EventFunction      onEvent;   /**< Report event to active state */
+    cfsm_InstanceDataPtr    ctxPtr;      /**< Context instance data        */
+    cfsm_TransitionFunction onLeave;     /**< Operation to run on leave    */
+    cfsm_ProcessFunction    onProcess;   /**< Cyclic processoperation      */
+    cfsm_EventFunction      onEvent;     /**< Report event to active state */
+#if defined(CFSM_ENABLE_STATE_ID)
+    cfsm_TransitionFunction state;       /**< Enter operation of the active
+                                              state, used as state identity */
+#endif
+#if defined(CFSM_ENABLE_PROFILE)
+    uint64_t                profileEntered; /**< Profiler time of the last
+                                                 transition, see
+                                                 c_fsm_profile.h */
+    uint32_t                profileSlot; /**< Profile table index of the
+                                              active state */
+#endif
 } cfsm_Ctx;
 
+/** A CFSM context padded to whole cache lines
+ *
+ * In an array of padded contexts that starts cache line aligned, each
+ * context has cache lines of its own. Contexts used by different threads
+ * then do not invalidate each other's cache lines (false sharing).
+ */
+typedef union cfsm_PaddedCtx {
+    cfsm_Ctx      fsm;                                    /**< The context */
+    unsigned char pad[CFSM_CACHE_ROUND(sizeof(cfsm_Ctx))]; /**< Padding     */
+} cfsm_PaddedCtx;
+
 /******************************************************************************
  * Functions
  *****************************************************************************/
@@ -103,17 +175,17 @@ typedef struct cfsm_Ctx {
 /**
  * @brief Initialize the given fsm.
  *
- * Initialize a cfsm context structure by setting all handlers to NULL
- * and update the instance data pointer with instanceData. Instance data
- * is used if the same operation handlers are used in multiple FSM instances.
- * The handlers can then access the instance data to operate on the actual
- * context.
+ * Initialize a cfsm context structure by setting all handlers to the
+ * CFSM_NO_* values (NULL by default) and update the instance data pointer
+ * with instanceData. Instance data is used if the same operation handlers
+ * are used in multiple FSM instances. The handlers can then access the
+ * instance data to operate on the actual context.
  *
  * @param fsm The fsm data structure to initialize.
  * @param instanceData Pointer to instance data (may be NULL if unneeded).
  * @since 0.1.0
  */
-void cfsm_init(cfsm_Ctx * fsm, cfsm_InstanceDataPtr instanceData);
+CFSM_API void cfsm_init(cfsm_Ctx * fsm, cfsm_InstanceDataPtr instanceData);
 
  /**
   * @brief Transition given fsm to a new state.
@@ -122,13 +194,18 @@ void cfsm_init(cfsm_Ctx * fsm, cfsm_InstanceDataPtr instanceData);
   * The called function is expected to update the state handlers in
   * the state structure. Unused handlers needs not to be set.
   * Passing NULL as enterfunc triggers the leave handler for the current
-  * state and clears all handler which stops the FSM from doing anything.
+  * state and resets all handler to CFSM_NO_* which stops the FSM from
+  * doing anything.
+  * The enterFunc is recorded as the state member of the fsm to
+  * identify the active state.
   *
   * @param fsm  The fsm data structure
   * @param enterFunc The enter operation for the new fsm state (may be NULL)
   * @since 0.1.0
   */
-void cfsm_transition(struct cfsm_Ctx * fsm, cfsm_TransitionFunction enterFunc);
+CFSM_API void cfsm_transition(
+    struct cfsm_Ctx * fsm,
+    cfsm_TransitionFunction enterFunc);
 
 /**
  * @brief Execute a process cycle to the current fsm state.
@@ -141,7 +218,7 @@ void cfsm_transition(struct cfsm_Ctx * fsm, cfsm_TransitionFunction enterFunc);
  * @param fsm The fsm data structure
  * @since 0.1.0
  */
-void cfsm_process(struct cfsm_Ctx * fsm);
+CFSM_API void cfsm_process(struct cfsm_Ctx * fsm);
 
 /**
  * @brief Signal an event to the current fsm state.
@@ -161,7 +238,119 @@ void cfsm_process(struct cfsm_Ctx * fsm);
  * @param eventId An application defined ID to identify the event.
  * @since 0.1.0
  */
-void cfsm_event(struct cfsm_Ctx * fsm, int eventId);
+CFSM_API void cfsm_event(struct cfsm_Ctx * fsm, int eventId);
+
+/**
+ * @brief Signal a sequence of events to the fsm.
+ *
+ * Same as calling cfsm_event() for each element of eventIds, but with a
+ * single library call. Events are delivered in order. Each event goes to
+ * the state that is active at that time, so a transition caused by one
+ * event redirects the following events to the new state. The remaining
+ * events are dropped at once if the active state has no onEvent handler
+ * (CFSM_NO_EVENT), without changing the state or its handlers.
+ *
+ * @param fsm The fsm data structure
+ * @param eventIds Application defined event IDs.
+ * @param count Number of elements in eventIds.
+ * @return The number of events passed to an onEvent handler. The other
+ *         count minus return value events were dropped.
+ * @since 0.4.0
+ */
+CFSM_API size_t cfsm_eventBatch(
+    struct cfsm_Ctx * fsm,
+    const int * eventIds,
+    size_t count);
+
+/**
+ * @brief Signal an event with payload to the current fsm state.
+ *
+ * Call the onEvent handler of the current fsm state like cfsm_event().
+ * While the handler runs, it gets a pointer to the event payload, like
+ * a received packet, from cfsm_eventPayload(). Handlers that do not need
+ * the payload are the same as for cfsm_event().
+ *
+ * The payload is not copied. It is only borrowed for the duration
+ * of the call, as the handler runs synchronously. A handler that
+ * needs the data later must copy it.
+ *
+ * The payload is kept in a per thread variable instead of the context,
+ * so contexts do not carry a handler slot for it. This function is
+ * therefore never inlined by CFSM_HEADER_ONLY, header only users link
+ * the cfsm library for it.
+ *
+ * @param fsm The fsm data structure
+ * @param eventId An application defined ID to identify the event.
+ * @param data The event payload (may be NULL if size is 0).
+ * @param size The payload size in bytes.
+ * @since 0.4.0
+ */
+void cfsm_eventData(
+    struct cfsm_Ctx * fsm,
+    int eventId,
+    const void * data,
+    size_t size);
+
+/**
+ * @brief Get the payload of the event being handled.
+ *
+ * Intended for onEvent handlers. Nested cfsm_eventData(), cfsm_event()
+ * and cfsm_eventBatch() calls hide the payload of the outer call until
+ * they return, so handlers of nested plain events see no payload. With
+ * CFSM_HEADER_ONLY, only nested cfsm_eventData() calls hide it.
+ *
+ * @param fsm The fsm passed to the event handler.
+ * @param size Receives the payload size in bytes (may be NULL).
+ * @return The payload of the running cfsm_eventData() call for fsm, or
+ *         NULL if fsm is not handling an event with payload.
+ * @since 0.4.0
+ */
+const void * cfsm_eventPayload(const struct cfsm_Ctx * fsm, size_t * size);
+
+#if defined(CFSM_CONFIG_NOOP_HANDLERS)
+
+/**
+ * @brief Shared no-op leave and process operation.
+ *
+ * Installed for unset handlers if CFSM_CONFIG_NOOP_HANDLERS is defined.
+ * States that want to clear a handler must assign CFSM_NO_LEAVE or
+ * CFSM_NO_PROCESS instead of NULL in this configuration.
+ *
+ * The no-op operations are library functions also with CFSM_HEADER_ONLY,
+ * as their addresses must be the same in all translation units to
+ * compare handlers against CFSM_NO_*. Header only builds must link a
+ * library built with CFSM_CONFIG_NOOP_HANDLERS then.
+ *
+ * @param fsm The fsm data structure
+ * @since 0.4.0
+ */
+void cfsm_noop(struct cfsm_Ctx * fsm);
+
+/**
+ * @brief Shared no-op event operation.
+ *
+ * Installed as CFSM_NO_EVENT if CFSM_CONFIG_NOOP_HANDLERS is defined.
+ *
+ * @param fsm The fsm data structure
+ * @param eventId Ignored event ID.
+ * @since 0.4.0
+ */
+void cfsm_noopEvent(struct cfsm_Ctx * fsm, int eventId);
+
+#endif
+
+#if defined(CFSM_HEADER_ONLY)
+#if defined(CFSM_ENABLE_PROFILE)
+#include "c_fsm_profile.h"
+#endif
+#if defined(CFSM_ENABLE_TRACE)
+#include "c_fsm_trace.h"
+#endif
+#if defined(CFSM_ENABLE_HITS)
+#include "c_fsm_hits.h"
+#endif
+#include "c_fsm.c"
+#endif
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,346 @@
+/* MIT License
+ *
+ * Copyright (C) 2024  Haju Schulz <haju@schulznorbert.de>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+/*******************************************************************************
+    DESCRIPTION
+*******************************************************************************/
+
+/**
+ * @brief  CFSM compact context implementation
+ *
+ * This file contains the implementation for storing many cfsm
+ * instances in 8 bytes each.
+ *
+ * Repository: https://github.com/nhjschulz/cfsm
+ *
+ */
+
+/******************************************************************************
+ * Includes
+ *****************************************************************************/
+#include "c_fsm.h"
+
+/* Compact fleets tell states apart by cfsm_Ctx::state. */
+#if defined(CFSM_ENABLE_STATE_ID)
+
+#include "c_fsm_compact.h"
+#include "c_fsm_fleet.h"
+
+/******************************************************************************
+ * Macros
+ *****************************************************************************/
+
+/******************************************************************************
+ * Types and Classes
+ *****************************************************************************/
+
+/** Temporary expansion of a compact instance during dispatch
+ *
+ * The tag is at the offset of cfsm_FleetEntry::fleet, which is never NULL
+ * for a fleet instance. This lets fleet only functions and
+ * cfsm_compact_indexOf() detect the wrong kind of context.
+ */
+typedef struct compact_Frame {
+    cfsm_Ctx     fsm;   /**< Expanded instance (must be first) */
+    const void * tag;   /**< Always NULL, see above            */
+    size_t       index; /**< Index of the compact instance     */
+} compact_Frame;
+
+/* Fails to compile if the tag no longer overlays cfsm_FleetEntry::fleet. */
+typedef char compact_TagCheck[
+    (offsetof(compact_Frame, tag) == offsetof(cfsm_FleetEntry, fleet)) ? 1 : -1];
+
+/******************************************************************************
+ * Prototypes
+ *****************************************************************************/
+
+static void compact_load(
+    const cfsm_CompactFleet * fleet,
+    size_t index,
+    compact_Frame * frame);
+static void compact_store(cfsm_CompactFleet * fleet, const compact_Frame * frame);
+static void compact_cache(cfsm_CompactFleet * fleet, uint16_t state, const cfsm_Ctx * fsm);
+static uint16_t compact_stateIndex(
+    const cfsm_CompactFleet * fleet,
+    cfsm_TransitionFunction enterFunc,
+    uint16_t * hint);
+
+/******************************************************************************
+ * Variables
+ *****************************************************************************/
+
+/******************************************************************************
+ * External functions
+ *****************************************************************************/
+
+void cfsm_compact_init(
+    cfsm_CompactFleet * fleet,
+    cfsm_CompactCtx * contexts,
+    size_t count,
+    cfsm_CompactState * states,
+    uint16_t stateCount,
+    void * instanceData,
+    size_t instanceSize)
+{
+    fleet->contexts     = contexts;
+    fleet->count        = count;
+    fleet->states       = states;
+    fleet->stateCount   = stateCount;
+    fleet->start        = CFSM_COMPACT_NO_STATE;
+    fleet->instanceData = (unsigned char *)instanceData;
+    fleet->instanceSize = instanceSize;
+    fleet->mismatches   = 0u;
+
+    for (uint16_t i = 0u; i < stateCount; ++i)
+    {
+        states[i].onLeave   = CFSM_NO_LEAVE;
+        states[i].onProcess = CFSM_NO_PROCESS;
+        states[i].onEvent   = CFSM_NO_EVENT;
+        states[i].cached    = 0u;
+        states[i].next      = CFSM_COMPACT_NO_STATE;
+    }
+
+    for (size_t i = 0u; i < count; ++i)
+    {
+        contexts[i].state    = CFSM_COMPACT_NO_STATE;
+        contexts[i].flags    = 0u;
+        contexts[i].instance = (uint32_t)i;
+    }
+}
+
+void cfsm_compact_transition(
+    cfsm_CompactFleet * fleet,
+    size_t index,
+    cfsm_TransitionFunction enterFunc)
+{
+    compact_Frame frame;
+
+    compact_load(fleet, index, &frame);
+    cfsm_transition(&frame.fsm, enterFunc);
+    compact_store(fleet, &frame);
+}
+
+void cfsm_compact_process(cfsm_CompactFleet * fleet, size_t index)
+{
+    compact_Frame frame;
+
+    compact_load(fleet, index, &frame);
+    cfsm_process(&frame.fsm);
+    compact_store(fleet, &frame);
+}
+
+void cfsm_compact_processAll(cfsm_CompactFleet * fleet)
+{
+    for (size_t index = 0u; index < fleet->count; ++index)
+    {
+        uint16_t state = fleet->contexts[index].state;
+
+        /* Expanding is only worth it if there is something to process. */
+        if ((CFSM_COMPACT_NO_STATE != state) &&
+            (CFSM_NO_PROCESS != fleet->states[state].onProcess))
+        {
+            cfsm_compact_process(fleet, index);
+        }
+    }
+}
+
+void cfsm_compact_event(cfsm_CompactFleet * fleet, size_t index, int eventId)
+{
+    compact_Frame frame;
+
+    compact_load(fleet, index, &frame);
+    cfsm_event(&frame.fsm, eventId);
+    compact_store(fleet, &frame);
+}
+
+void cfsm_compact_eventData(
+    cfsm_CompactFleet * fleet,
+    size_t index,
+    int eventId,
+    const void * data,
+    size_t size)
+{
+    compact_Frame frame;
+
+    compact_load(fleet, index, &frame);
+    cfsm_eventData(&frame.fsm, eventId, data, size);
+    compact_store(fleet, &frame);
+}
+
+size_t cfsm_compact_indexOf(const cfsm_Ctx * fsm)
+{
+    /* Only fleet entries and frames have a tag, see the header. */
+    const compact_Frame * frame = (const compact_Frame *)fsm;
+
+    if ((const void *)0 != frame->tag)
+    {
+        return CFSM_COMPACT_NO_INDEX;
+    }
+
+    return frame->index;
+}
+
+/******************************************************************************
+ * Local functions
+ *****************************************************************************/
+
+/**
+ * @brief Expand a compact instance into a frame.
+ *
+ * @param fleet The compact fleet data structure.
+ * @param index Index of the instance.
+ * @param frame The frame to fill.
+ */
+static void compact_load(
+    const cfsm_CompactFleet * fleet,
+    size_t index,
+    compact_Frame * frame)
+{
+    const cfsm_CompactCtx * ctx = &fleet->contexts[index];
+
+    cfsm_init(
+        &frame->fsm,
+        ((unsigned char *)0 != fleet->instanceData) ?
+            fleet->instanceData + ((size_t)ctx->instance * fleet->instanceSize) :
+            (cfsm_InstanceDataPtr)0);
+    frame->tag   = (const void *)0;
+    frame->index = index;
+
+    if (CFSM_COMPACT_NO_STATE != ctx->state)
+    {
+        const cfsm_CompactState * state = &fleet->states[ctx->state];
+
+        frame->fsm.onLeave   = state->onLeave;
+        frame->fsm.onProcess = state->onProcess;
+        frame->fsm.onEvent   = state->onEvent;
+        frame->fsm.state     = state->enter;
+    }
+}
+
+/**
+ * @brief Write a frame back to its compact instance.
+ *
+ * Stores the state index if the handler caused a transition. The handlers
+ * of the frame are cached in the state table of its state, whether or not
+ * the state changed.
+ *
+ * @param fleet The compact fleet data structure.
+ * @param frame The frame to store.
+ */
+static void compact_store(cfsm_CompactFleet * fleet, const compact_Frame * frame)
+{
+    cfsm_CompactCtx * ctx = &fleet->contexts[frame->index];
+    uint16_t state = ctx->state;
+    cfsm_TransitionFunction previous = (CFSM_COMPACT_NO_STATE != state) ?
+        fleet->states[state].enter :
+        (cfsm_TransitionFunction)0;
+
+    if (previous != frame->fsm.state)
+    {
+        state = compact_stateIndex(
+            fleet,
+            frame->fsm.state,
+            (CFSM_COMPACT_NO_STATE != state) ? &fleet->states[state].next : &fleet->start);
+        ctx->state = state;
+    }
+
+    if (CFSM_COMPACT_NO_STATE != state)
+    {
+        compact_cache(fleet, state, &frame->fsm);
+    }
+}
+
+/**
+ * @brief Cache the handler set of an instance in the state table.
+ *
+ * The first handler set of a state is cached as is. A later one that
+ * differs replaces it and is counted as a mismatch, as all instances in
+ * that state share the cached handlers.
+ *
+ * @param fleet The compact fleet data structure.
+ * @param state The state index of the instance.
+ * @param fsm The expanded instance.
+ */
+static void compact_cache(cfsm_CompactFleet * fleet, uint16_t state, const cfsm_Ctx * fsm)
+{
+    cfsm_CompactState * entry = &fleet->states[state];
+
+    if ((entry->onLeave   == fsm->onLeave) &&
+        (entry->onProcess == fsm->onProcess) &&
+        (entry->onEvent   == fsm->onEvent))
+    {
+        entry->cached = 1u;
+        return;
+    }
+
+    if (0u != entry->cached)
+    {
+        ++fleet->mismatches;
+    }
+
+    entry->onLeave   = fsm->onLeave;
+    entry->onProcess = fsm->onProcess;
+    entry->onEvent   = fsm->onEvent;
+    entry->cached    = 1u;
+}
+
+/**
+ * @brief Find the state table index of an enter operation.
+ *
+ * The hint is checked first. The table is only searched if the hint is
+ * another state, and the hint is updated with the result.
+ *
+ * @param fleet The compact fleet data structure.
+ * @param enterFunc The enter operation to look for.
+ * @param hint Index of the state found last time for the left state.
+ * @return The state index or CFSM_COMPACT_NO_STATE if not found.
+ */
+static uint16_t compact_stateIndex(
+    const cfsm_CompactFleet * fleet,
+    cfsm_TransitionFunction enterFunc,
+    uint16_t * hint)
+{
+    if ((cfsm_TransitionFunction)0 == enterFunc)
+    {
+        return CFSM_COMPACT_NO_STATE;
+    }
+
+    if ((*hint < fleet->stateCount) && (enterFunc == fleet->states[*hint].enter))
+    {
+        return *hint;
+    }
+
+    for (uint16_t i = 0u; i < fleet->stateCount; ++i)
+    {
+        if (enterFunc == fleet->states[i].enter)
+        {
+            *hint = i;
+            return i;
+        }
+    }
+
+    return CFSM_COMPACT_NO_STATE;
+}
+
+#endif /* CFSM_ENABLE_STATE_ID */
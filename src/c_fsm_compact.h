@@ -0,0 +1,254 @@
+/* MIT License
+ *
+ * Copyright (C) 2024  Haju Schulz <haju@schulznorbert.de>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*******************************************************************************
+    DESCRIPTION
+*******************************************************************************/
+/**
+ * @brief  CFSM compact context header file
+ *
+ * A compact fleet stores each CFSM instance in 8 bytes instead of a
+ * cfsm_Ctx with its handler pointers. An instance is a state index into
+ * a per fleet state table and an index into an instance data array.
+ * Dispatch functions expand an instance into a temporary cfsm_Ctx, so
+ * ordinary state handlers run unchanged, including cfsm_transition()
+ * calls.
+ *
+ * Handlers are looked up from the state table, so they belong to a state
+ * and not to an instance. They are taken from the first instance that
+ * enters a state. Every state must install the same handlers on each
+ * enter, independent of the instance data, and must not change them
+ * while active. A handler set that differs from the cached one is
+ * written back to the state table, so it applies to all instances in
+ * that state, and counted in cfsm_CompactFleet::mismatches to diagnose
+ * the violation.
+ *
+ * cfsm_compact_indexOf() is only valid in handlers called by a
+ * cfsm_compact_* function. Fleet only functions like cfsm_sleepUntil()
+ * or cfsm_enterLocal() must not be used by compact fleet handlers. They
+ * detect a compact instance and ignore the call or return NULL.
+ *
+ * The compact fleet does not allocate memory. The application provides
+ * all storage during cfsm_compact_init().
+ *
+ * Repository: https://github.com/nhjschulz/cfsm
+ *
+ * @addtogroup CFSM
+ *
+ * @{
+ */
+
+#ifndef SRC_C_FSM_C_FSM_COMPACT_H_
+#define SRC_C_FSM_C_FSM_COMPACT_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/******************************************************************************
+ * Includes
+ *****************************************************************************/
+#include <stddef.h>
+#include <stdint.h>
+
+#include "c_fsm.h"
+
+#if !defined(CFSM_ENABLE_STATE_ID)
+#error "c_fsm_compact.h requires CFSM_ENABLE_STATE_ID"
+#endif
+
+/******************************************************************************
+ * Macros
+ *****************************************************************************/
+
+/** State index of compact instances without active state. */
+#define CFSM_COMPACT_NO_STATE ((uint16_t)0xFFFFu)
+
+/** Index returned by cfsm_compact_indexOf() for non compact instances. */
+#define CFSM_COMPACT_NO_INDEX ((size_t)-1)
+
+/******************************************************************************
+ * Types and Classes
+ *****************************************************************************/
+
+/** A compact CFSM instance of 8 bytes
+ */
+typedef struct cfsm_CompactCtx {
+    uint16_t state;    /**< Index into the state table               */
+    uint16_t flags;    /**< Free for application use, e.g. a queue   */
+    uint32_t instance; /**< Index into the instance data array       */
+} cfsm_CompactCtx;
+
+/** A state table entry of a compact fleet
+ *
+ * The application sets the enter operation, CFSM fills in the other
+ * handlers when the state is entered the first time. Transitions look
+ * the new state index up by its enter operation. The result is kept in
+ * next, so the table is only searched when a state is left for another
+ * successor than last time.
+ */
+typedef struct cfsm_CompactState {
+    cfsm_TransitionFunction enter;     /**< State enter operation    */
+    cfsm_TransitionFunction onLeave;   /**< Cached leave operation   */
+    cfsm_ProcessFunction    onProcess; /**< Cached process operation */
+    cfsm_EventFunction      onEvent;   /**< Cached event operation   */
+    uint8_t                 cached;    /**< Handlers are cached      */
+    uint16_t                next;      /**< Index of the state last
+                                            entered from this one    */
+} cfsm_CompactState;
+
+/** The CFSM compact fleet data structure
+ */
+typedef struct cfsm_CompactFleet {
+    cfsm_CompactCtx *   contexts;     /**< Application provided instances   */
+    size_t              count;        /**< Number of instances              */
+    cfsm_CompactState * states;       /**< Application provided state table */
+    uint16_t            stateCount;   /**< Number of states in table        */
+    uint16_t            start;        /**< Index of the state last entered
+                                           without active state          */
+    unsigned char *     instanceData; /**< Instance data array or NULL      */
+    size_t              instanceSize; /**< Size of an instance data element */
+    uint32_t            mismatches;   /**< Handler sets differing from cache*/
+} cfsm_CompactFleet;
+
+/******************************************************************************
+ * Functions
+ *****************************************************************************/
+
+/**
+ * @brief Initialize the given compact fleet.
+ *
+ * All instances start without active state and with instance index
+ * equal to their own index. The ctxPtr of instance i is element i of
+ * the instance data array, or NULL if no array is given. The enter
+ * members of the state table must be set, the other members are
+ * cleared.
+ *
+ * @param fleet The compact fleet data structure to initialize.
+ * @param contexts Storage for the instances.
+ * @param count Number of elements in contexts.
+ * @param states State table with the enter operation of every state.
+ * @param stateCount Number of elements in states (less than
+ *        CFSM_COMPACT_NO_STATE).
+ * @param instanceData Instance data array (may be NULL if unneeded).
+ * @param instanceSize Size of an instance data array element in bytes.
+ * @since 0.4.0
+ */
+void cfsm_compact_init(
+    cfsm_CompactFleet * fleet,
+    cfsm_CompactCtx * contexts,
+    size_t count,
+    cfsm_CompactState * states,
+    uint16_t stateCount,
+    void * instanceData,
+    size_t instanceSize);
+
+/**
+ * @brief Transition an instance to a new state.
+ *
+ * Same as cfsm_transition() for the instance. A NULL enterFunc stops the
+ * instance. An enter operation that is not in the state table stops the
+ * instance as well, as it has no compact representation.
+ *
+ * @param fleet The compact fleet data structure.
+ * @param index Index of the instance.
+ * @param enterFunc The enter operation for the new state (may be NULL)
+ * @since 0.4.0
+ */
+void cfsm_compact_transition(
+    cfsm_CompactFleet * fleet,
+    size_t index,
+    cfsm_TransitionFunction enterFunc);
+
+/**
+ * @brief Execute a process cycle for an instance.
+ *
+ * @param fleet The compact fleet data structure.
+ * @param index Index of the instance.
+ * @since 0.4.0
+ */
+void cfsm_compact_process(cfsm_CompactFleet * fleet, size_t index);
+
+/**
+ * @brief Execute a process cycle for all instances.
+ *
+ * Instances are processed in index order. Instances in states without
+ * process operation are skipped without expanding them.
+ *
+ * @param fleet The compact fleet data structure.
+ * @since 0.4.0
+ */
+void cfsm_compact_processAll(cfsm_CompactFleet * fleet);
+
+/**
+ * @brief Signal an event to an instance.
+ *
+ * @param fleet The compact fleet data structure.
+ * @param index Index of the instance.
+ * @param eventId An application defined ID to identify the event.
+ * @since 0.4.0
+ */
+void cfsm_compact_event(cfsm_CompactFleet * fleet, size_t index, int eventId);
+
+/**
+ * @brief Signal an event with payload to an instance.
+ *
+ * Same as cfsm_eventData() for the instance. Handlers get the payload
+ * by cfsm_eventPayload() as usual.
+ *
+ * @param fleet The compact fleet data structure.
+ * @param index Index of the instance.
+ * @param eventId An application defined ID to identify the event.
+ * @param data The event payload (may be NULL if size is 0).
+ * @param size The payload size in bytes.
+ * @since 0.4.0
+ */
+void cfsm_compact_eventData(
+    cfsm_CompactFleet * fleet,
+    size_t index,
+    int eventId,
+    const void * data,
+    size_t size);
+
+/**
+ * @brief Get the instance index from within a compact fleet handler.
+ *
+ * Only valid for the fsm passed to a handler by a cfsm_compact_*
+ * function or by a cfsm_fleet_* function. A fleet instance is detected
+ * by the member following its context. A plain cfsm_Ctx has no such
+ * member, passing one is undefined behavior.
+ *
+ * @param fsm The fsm passed to a handler by a cfsm_compact_* function.
+ * @return Index of the instance in the compact fleet or
+ *         CFSM_COMPACT_NO_INDEX for a fleet instance.
+ * @since 0.4.0
+ */
+size_t cfsm_compact_indexOf(const cfsm_Ctx * fsm);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SRC_C_FSM_C_FSM_COMPACT_H_ */
+
+/** @} */
@@ -0,0 +1,1177 @@
+/* MIT License
+ *
+ * Copyright (C) 2024  Haju Schulz <haju@schulznorbert.de>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+/*******************************************************************************
+    DESCRIPTION
+*******************************************************************************/
+
+/**
+ * @brief  CFSM fleet implementation
+ *
+ * This file contains the implementation for managing many cfsm
+ * instances with a shared process cycle.
+ *
+ * Repository: https://github.com/nhjschulz/cfsm
+ *
+ */
+
+/******************************************************************************
+ * Includes
+ *****************************************************************************/
+#include "c_fsm.h"
+
+/* Fleets tell states apart by cfsm_Ctx::state. */
+#if defined(CFSM_ENABLE_STATE_ID)
+
+#include <assert.h>
+#include <string.h>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
+#include "c_fsm_fleet.h"
+
+/******************************************************************************
+ * Macros
+ *****************************************************************************/
+
+#define FLEET_RUNNABLE   (1u << 0) /**< Entry is on runnable list          */
+#define FLEET_SLEEPING   (1u << 1) /**< Entry is on sleeping list          */
+#define FLEET_WAITING    (1u << 2) /**< Entry is on waiting list           */
+#define FLEET_LIST_MASK  (FLEET_RUNNABLE | FLEET_SLEEPING | FLEET_WAITING)
+
+#define FLEET_REQ_SLEEP  (1u << 3) /**< cfsm_sleepUntil() requested        */
+#define FLEET_REQ_WAIT   (1u << 4) /**< cfsm_sleepUntilEvent() requested   */
+#define FLEET_REQ_MASK   (FLEET_REQ_SLEEP | FLEET_REQ_WAIT)
+
+#define FLEET_LOCAL      (1u << 5) /**< cfsm_enterLocal() claimed the slot */
+
+#define FLEET_INDEX_MASK ((cfsm_Handle)((1ul << CFSM_FLEET_INDEX_BITS) - 1u))
+#define FLEET_GEN_MASK   ((cfsm_Handle)(0xFFFFFFFFul >> CFSM_FLEET_INDEX_BITS))
+
+/** Last generation before wrapping, limited by the handle and by the entry. */
+#define FLEET_GEN_LAST   ((FLEET_GEN_MASK < 0xFFFFu) ? FLEET_GEN_MASK : 0xFFFFu)
+
+#define FLEET_NIL        ((uint32_t)0xFFFFFFFFu) /**< End of list index    */
+
+#define FLEET_INGEST_BUCKETS 256u  /**< Partitions used by cfsm_fleet_ingest() */
+
+#define FLEET_EXPIRE_BLOCK   32u   /**< Instances per armed bitmap word     */
+
+/******************************************************************************
+ * Types and Classes
+ *****************************************************************************/
+
+#if (UINTPTR_MAX == 0xFFFFFFFFFFFFFFFFu) && !defined(CFSM_ENABLE_PROFILE)
+/* Fails to compile if an entry no longer fills exactly one cache line. */
+typedef char fleet_EntrySizeCheck[(64u == sizeof(cfsm_FleetEntry)) ? 1 : -1];
+#endif
+
+/******************************************************************************
+ * Prototypes
+ *****************************************************************************/
+
+static uint32_t * fleet_listHead(cfsm_Fleet * fleet, unsigned int list);
+static uint32_t * fleet_listCount(cfsm_Fleet * fleet, unsigned int list);
+static void fleet_unlink(cfsm_Fleet * fleet, cfsm_FleetEntry * entry);
+static void fleet_link(cfsm_Fleet * fleet, cfsm_FleetEntry * entry, unsigned int list);
+static void fleet_settle(cfsm_Fleet * fleet, cfsm_FleetEntry * entry);
+static void fleet_wake(cfsm_Fleet * fleet, cfsm_FleetEntry * entry);
+static void fleet_track(cfsm_Fleet * fleet, cfsm_FleetEntry * entry);
+static unsigned char * fleet_localSlot(const cfsm_FleetEntry * entry);
+static cfsm_FleetStateList * fleet_stateList(
+    const cfsm_Fleet * fleet,
+    cfsm_TransitionFunction state);
+static int fleet_isExpired(cfsm_Time now, cfsm_Time deadline);
+static size_t fleet_bucketOf(const cfsm_Fleet * fleet, cfsm_Handle handle, unsigned int shift);
+static void fleet_disarm(cfsm_Fleet * fleet, size_t index);
+static uint32_t fleet_expiredMask(const cfsm_Time * deadlines, cfsm_Time now);
+static unsigned int fleet_lowestBit(uint32_t mask);
+static int fleet_earliestTimeout(const cfsm_Fleet * fleet, cfsm_Time * earliest, int found);
+
+/******************************************************************************
+ * Variables
+ *****************************************************************************/
+
+/******************************************************************************
+ * External functions
+ *****************************************************************************/
+
+void cfsm_fleet_init(cfsm_Fleet * fleet, cfsm_FleetEntry * entries, size_t capacity)
+{
+    if (capacity > (size_t)FLEET_INDEX_MASK + 1u)
+    {
+        capacity = (size_t)FLEET_INDEX_MASK + 1u;
+    }
+
+    fleet->entries    = entries;
+    fleet->capacity   = capacity;
+    fleet->count      = 0u;
+    fleet->localArena = (unsigned char *)0;
+    fleet->localSlot  = 0u;
+    fleet->deadlines  = (cfsm_Time *)0;
+    fleet->armed      = (uint32_t *)0;
+    fleet->stateLists = (cfsm_FleetStateList *)0;
+    fleet->stateCount = 0u;
+    fleet->members    = (cfsm_FleetMember *)0;
+    fleet->memberCursor = FLEET_NIL;
+    fleet->freeList   = FLEET_NIL;
+    fleet->freeTail   = FLEET_NIL;
+    fleet->runnable   = FLEET_NIL;
+    fleet->sleeping   = FLEET_NIL;
+    fleet->sleepingTail = FLEET_NIL;
+    fleet->waiting    = FLEET_NIL;
+    fleet->cursor     = FLEET_NIL;
+    fleet->runnableCount = 0u;
+    fleet->sleepingCount = 0u;
+    fleet->waitingCount  = 0u;
+}
+
+void cfsm_fleet_initShard(
+    cfsm_Fleet * fleet,
+    void * storage,
+    size_t storageSize,
+    size_t shard,
+    size_t shardCount)
+{
+    size_t lines = storageSize / CFSM_CACHE_LINE;
+    size_t share = lines / shardCount;
+    size_t extra = lines % shardCount;
+
+    /* The first "extra" shards get one more cache line. */
+    size_t first = (shard * share) + ((shard < extra) ? shard : extra);
+    size_t count = share + ((shard < extra) ? 1u : 0u);
+
+    cfsm_fleet_init(
+        fleet,
+        (cfsm_FleetEntry *)((unsigned char *)storage + (first * CFSM_CACHE_LINE)),
+        (count * CFSM_CACHE_LINE) / sizeof(cfsm_FleetEntry));
+}
+
+void cfsm_fleet_attachLocal(cfsm_Fleet * fleet, void * arena, size_t localSize)
+{
+    fleet->localArena = (unsigned char *)arena;
+    fleet->localSlot  = CFSM_FLEET_LOCAL_HEADER + CFSM_FLEET_LOCAL_SLOT(localSize);
+}
+
+void cfsm_fleet_attachStates(
+    cfsm_Fleet * fleet,
+    cfsm_FleetStateList * lists,
+    size_t listCount,
+    cfsm_FleetMember * members)
+{
+    fleet->stateLists = lists;
+    fleet->stateCount = listCount;
+    fleet->members    = members;
+
+    for (size_t i = 0u; i < listCount; ++i)
+    {
+        lists[i].head  = FLEET_NIL;
+        lists[i].count = 0u;
+    }
+
+    for (size_t i = 0u; i < fleet->capacity; ++i)
+    {
+        members[i].state = (cfsm_TransitionFunction)0;
+        members[i].prev  = FLEET_NIL;
+        members[i].next  = FLEET_NIL;
+    }
+
+    /* Track the instances added before. */
+    for (size_t i = 0u; i < fleet->count; ++i)
+    {
+        if (0u != (fleet->entries[i].flags & FLEET_LIST_MASK))
+        {
+            fleet_track(fleet, &fleet->entries[i]);
+        }
+    }
+}
+
+void cfsm_fleet_attachDeadlines(
+    cfsm_Fleet * fleet,
+    cfsm_Time * deadlines,
+    uint32_t * armed)
+{
+    fleet->deadlines = deadlines;
+    fleet->armed     = armed;
+
+    memset(armed, 0, CFSM_FLEET_ARMED_WORDS(fleet->capacity) * sizeof(*armed));
+}
+
+cfsm_Ctx * cfsm_fleet_add(cfsm_Fleet * fleet, cfsm_InstanceDataPtr instanceData)
+{
+    cfsm_FleetEntry * entry;
+    size_t index = fleet->freeList;
+
+    if (FLEET_NIL != index)
+    {
+        entry = &fleet->entries[index];
+        fleet->freeList = entry->next;
+        if (FLEET_NIL == fleet->freeList)
+        {
+            fleet->freeTail = FLEET_NIL;
+        }
+    }
+    else if (fleet->count < fleet->capacity)
+    {
+        index = fleet->count++;
+        entry = &fleet->entries[index];
+        entry->generation = 1u;
+    }
+    else
+    {
+        return (cfsm_Ctx *)0;
+    }
+
+    cfsm_init(&entry->fsm, instanceData);
+    entry->fleet = fleet;
+    entry->deadline = 0u;
+    entry->flags = 0u;
+    fleet_link(fleet, entry, FLEET_RUNNABLE);
+
+    return &entry->fsm;
+}
+
+void cfsm_fleet_remove(cfsm_Fleet * fleet, cfsm_Ctx * fsm)
+{
+    cfsm_FleetEntry * entry = (cfsm_FleetEntry *)fsm;
+    uint32_t index = (uint32_t)(entry - fleet->entries);
+
+    /* Only live entries are on a list, free entries are not. */
+    if (0u == (entry->flags & FLEET_LIST_MASK))
+    {
+        return;
+    }
+
+    cfsm_transition(fsm, (cfsm_TransitionFunction)0);
+
+    fleet_unlink(fleet, entry);
+    fleet_disarm(fleet, index);
+    fleet_track(fleet, entry);
+    entry->flags = 0u;
+
+    /* Invalidate all handles. The generation wraps around, skipping 0
+     * to keep CFSM_FLEET_INVALID_HANDLE invalid.
+     */
+    entry->generation = (FLEET_GEN_LAST == entry->generation) ?
+        (uint16_t)1u :
+        (uint16_t)(entry->generation + 1u);
+
+    /* Append to the free list, so the entry is reused last. */
+    entry->next = FLEET_NIL;
+    if (FLEET_NIL == fleet->freeTail)
+    {
+        fleet->freeList = index;
+    }
+    else
+    {
+        fleet->entries[fleet->freeTail].next = index;
+    }
+    fleet->freeTail = index;
+}
+
+cfsm_Handle cfsm_fleet_handleOf(const cfsm_Fleet * fleet, const cfsm_Ctx * fsm)
+{
+    const cfsm_FleetEntry * entry = (const cfsm_FleetEntry *)fsm;
+    cfsm_Handle index = (cfsm_Handle)(entry - fleet->entries);
+
+    return ((cfsm_Handle)entry->generation << CFSM_FLEET_INDEX_BITS) | index;
+}
+
+cfsm_Ctx * cfsm_fleet_lookup(const cfsm_Fleet * fleet, cfsm_Handle handle)
+{
+    size_t index = (size_t)(handle & FLEET_INDEX_MASK);
+    cfsm_FleetEntry * entry;
+
+    if (index >= fleet->count)
+    {
+        return (cfsm_Ctx *)0;
+    }
+
+    entry = &fleet->entries[index];
+    if ((entry->generation != (handle >> CFSM_FLEET_INDEX_BITS)) ||
+        (0u == (entry->flags & FLEET_LIST_MASK)))
+    {
+        return (cfsm_Ctx *)0;
+    }
+
+    return &entry->fsm;
+}
+
+size_t cfsm_fleet_indexOf(const cfsm_Fleet * fleet, const cfsm_Ctx * fsm)
+{
+    return (size_t)((const cfsm_FleetEntry *)fsm - fleet->entries);
+}
+
+cfsm_Ctx * cfsm_fleet_at(const cfsm_Fleet * fleet, size_t index)
+{
+    cfsm_FleetEntry * entry;
+
+    if (index >= fleet->count)
+    {
+        return (cfsm_Ctx *)0;
+    }
+
+    entry = &fleet->entries[index];
+    if (0u == (entry->flags & FLEET_LIST_MASK))
+    {
+        return (cfsm_Ctx *)0;
+    }
+
+    return &entry->fsm;
+}
+
+int cfsm_fleet_post(cfsm_Fleet * fleet, cfsm_Handle handle, int eventId)
+{
+    cfsm_Ctx * fsm = cfsm_fleet_lookup(fleet, handle);
+
+    if ((cfsm_Ctx *)0 == fsm)
+    {
+        return 0;
+    }
+
+    cfsm_fleet_event(fleet, fsm, eventId);
+
+    return 1;
+}
+
+size_t cfsm_fleet_ingest(
+    cfsm_Fleet * fleet,
+    const cfsm_Handle * targets,
+    const int * eventIds,
+    size_t count,
+    cfsm_Handle * scratchTargets,
+    int * scratchIds)
+{
+    uint32_t offsets[FLEET_INGEST_BUCKETS];
+    unsigned int shift = 0u;
+    size_t delivered = 0u;
+    size_t i;
+
+    if (((cfsm_Handle *)0 != scratchTargets) && ((int *)0 != scratchIds))
+    {
+        /* Stable counting sort by entry index range. */
+        uint32_t sum = 0u;
+
+        while ((fleet->count >> shift) > FLEET_INGEST_BUCKETS)
+        {
+            ++shift;
+        }
+
+        memset(offsets, 0, sizeof(offsets));
+        for (i = 0u; i < count; ++i)
+        {
+            offsets[fleet_bucketOf(fleet, targets[i], shift)]++;
+        }
+
+        for (i = 0u; i < FLEET_INGEST_BUCKETS; ++i)
+        {
+            uint32_t bucketSize = offsets[i];
+
+            offsets[i] = sum;
+            sum += bucketSize;
+        }
+
+        for (i = 0u; i < count; ++i)
+        {
+            uint32_t pos = offsets[fleet_bucketOf(fleet, targets[i], shift)]++;
+
+            scratchTargets[pos] = targets[i];
+            scratchIds[pos] = eventIds[i];
+        }
+
+        targets = scratchTargets;
+        eventIds = scratchIds;
+    }
+
+    for (i = 0u; i < count; ++i)
+    {
+        delivered += (size_t)cfsm_fleet_post(fleet, targets[i], eventIds[i]);
+    }
+
+    return delivered;
+}
+
+void cfsm_fleet_process(cfsm_Fleet * fleet, cfsm_Time now)
+{
+    uint32_t index;
+
+    /* Wake up expired sleepers, which are at the head of the deadline
+     * ordered list. They get linked in front of the runnable list and
+     * are therefore processed in this cycle.
+     */
+    while (FLEET_NIL != fleet->sleeping)
+    {
+        cfsm_FleetEntry * entry = &fleet->entries[fleet->sleeping];
+
+        if (0 == fleet_isExpired(now, entry->deadline))
+        {
+            break;
+        }
+
+        fleet_unlink(fleet, entry);
+        fleet_link(fleet, entry, FLEET_RUNNABLE);
+    }
+
+    /* The cursor holds the next entry, as handlers may move entries
+     * between lists. Unlinking the cursor entry advances it.
+     */
+    index = fleet->runnable;
+    while (FLEET_NIL != index)
+    {
+        cfsm_FleetEntry * entry = &fleet->entries[index];
+
+        fleet->cursor = entry->next;
+
+        if (0u == (entry->flags & FLEET_REQ_MASK))
+        {
+            cfsm_process(&entry->fsm);
+        }
+        fleet_settle(fleet, entry);
+
+        index = fleet->cursor;
+    }
+}
+
+int cfsm_fleet_nextProcess(const cfsm_Fleet * fleet, cfsm_Time now, cfsm_Time * delay)
+{
+    cfsm_Time earliest = 0u;
+    int found = 0;
+
+    if (FLEET_NIL != fleet->runnable)
+    {
+        *delay = 0u;
+        return 1;
+    }
+
+    if (FLEET_NIL != fleet->sleeping)
+    {
+        earliest = fleet->entries[fleet->sleeping].deadline;
+        found = 1;
+    }
+
+    /* Armed timeouts are due at their deadline as well. */
+    found = fleet_earliestTimeout(fleet, &earliest, found);
+    if (0 == found)
+    {
+        return 0;
+    }
+
+    *delay = fleet_isExpired(now, earliest) ? 0u : (cfsm_Time)(earliest - now);
+
+    return 1;
+}
+
+void cfsm_fleet_stats(const cfsm_Fleet * fleet, cfsm_FleetStats * stats)
+{
+    stats->capacity     = fleet->capacity;
+    stats->used         = fleet->count;
+    stats->runnable     = fleet->runnableCount;
+    stats->sleeping     = fleet->sleepingCount;
+    stats->waiting      = fleet->waitingCount;
+    stats->live         = stats->runnable + stats->sleeping + stats->waiting;
+    stats->storage      = fleet->entries;
+    stats->storageBytes = fleet->count * sizeof(cfsm_FleetEntry);
+}
+
+void cfsm_fleet_armTimeout(cfsm_Fleet * fleet, cfsm_Ctx * fsm, cfsm_Time deadline)
+{
+    size_t index = cfsm_fleet_indexOf(fleet, fsm);
+
+    fleet->deadlines[index] = deadline;
+    fleet->armed[index / FLEET_EXPIRE_BLOCK] |= (uint32_t)1u << (index % FLEET_EXPIRE_BLOCK);
+}
+
+void cfsm_fleet_disarmTimeout(cfsm_Fleet * fleet, cfsm_Ctx * fsm)
+{
+    fleet_disarm(fleet, cfsm_fleet_indexOf(fleet, fsm));
+}
+
+size_t cfsm_fleet_expire(cfsm_Fleet * fleet, cfsm_Time now, int eventId)
+{
+    size_t signaled = 0u;
+
+    if ((uint32_t *)0 == fleet->armed)
+    {
+        return 0u;
+    }
+
+    for (size_t base = 0u; base < fleet->count; base += FLEET_EXPIRE_BLOCK)
+    {
+        uint32_t * word = &fleet->armed[base / FLEET_EXPIRE_BLOCK];
+        uint32_t expired;
+
+        if (0u == *word)
+        {
+            continue;
+        }
+
+        if ((base + FLEET_EXPIRE_BLOCK) <= fleet->capacity)
+        {
+            expired = fleet_expiredMask(&fleet->deadlines[base], now);
+        }
+        else
+        {
+            /* Partial last block, must not read beyond the column. */
+            expired = 0u;
+            for (size_t i = base; i < fleet->capacity; ++i)
+            {
+                expired |= (uint32_t)fleet_isExpired(now, fleet->deadlines[i]) <<
+                    (i - base);
+            }
+        }
+
+        expired &= *word;
+        while (0u != expired)
+        {
+            unsigned int offset = fleet_lowestBit(expired);
+            uint32_t bit = (uint32_t)1u << offset;
+
+            expired &= ~bit;
+
+            /* A handler of this block may have removed the instance or
+             * disarmed its timeout meanwhile.
+             */
+            if (0u != (*word & bit))
+            {
+                *word &= ~bit;
+                cfsm_fleet_event(fleet, &fleet->entries[base + offset].fsm, eventId);
+                ++signaled;
+            }
+        }
+    }
+
+    return signaled;
+}
+
+void cfsm_fleet_event(cfsm_Fleet * fleet, cfsm_Ctx * fsm, int eventId)
+{
+    cfsm_FleetEntry * entry = (cfsm_FleetEntry *)fsm;
+
+    /* Any event wakes up a sleeping instance. */
+    fleet_wake(fleet, entry);
+
+    cfsm_event(fsm, eventId);
+
+    fleet_settle(fleet, entry);
+}
+
+size_t cfsm_fleet_eventBatch(
+    cfsm_Fleet * fleet,
+    cfsm_Ctx * fsm,
+    const int * eventIds,
+    size_t count)
+{
+    cfsm_FleetEntry * entry = (cfsm_FleetEntry *)fsm;
+    size_t delivered;
+
+    fleet_wake(fleet, entry);
+
+    delivered = cfsm_eventBatch(fsm, eventIds, count);
+
+    fleet_settle(fleet, entry);
+
+    return delivered;
+}
+
+void cfsm_fleet_eventData(
+    cfsm_Fleet * fleet,
+    cfsm_Ctx * fsm,
+    int eventId,
+    const void * data,
+    size_t size)
+{
+    cfsm_FleetEntry * entry = (cfsm_FleetEntry *)fsm;
+
+    fleet_wake(fleet, entry);
+
+    cfsm_eventData(fsm, eventId, data, size);
+
+    fleet_settle(fleet, entry);
+}
+
+void cfsm_fleet_transition(
+    cfsm_Fleet * fleet,
+    cfsm_Ctx * fsm,
+    cfsm_TransitionFunction enterFunc)
+{
+    cfsm_FleetEntry * entry = (cfsm_FleetEntry *)fsm;
+
+    fleet_wake(fleet, entry);
+    cfsm_transition(fsm, enterFunc);
+    fleet_settle(fleet, entry);
+}
+
+size_t cfsm_fleet_transitionAll(
+    cfsm_Fleet * fleet,
+    cfsm_TransitionFunction fromState,
+    cfsm_TransitionFunction toState)
+{
+    cfsm_FleetStateList * list = fleet_stateList(fleet, fromState);
+    size_t transitions = 0u;
+
+    if ((cfsm_FleetStateList *)0 != list)
+    {
+        /* The member cursor holds the next entry, as enter and leave
+         * operations may move other instances between state lists.
+         */
+        uint32_t index = list->head;
+
+        while (FLEET_NIL != index)
+        {
+            cfsm_FleetEntry * entry = &fleet->entries[index];
+
+            fleet->memberCursor = fleet->members[index].next;
+#if defined(__GNUC__)
+            /* Fetch the next member while this one transitions. */
+            if (FLEET_NIL != fleet->memberCursor)
+            {
+                __builtin_prefetch(&fleet->entries[fleet->memberCursor]);
+                __builtin_prefetch(&fleet->members[fleet->memberCursor]);
+            }
+#endif
+
+            if (fromState == entry->fsm.state)
+            {
+                cfsm_fleet_transition(fleet, &entry->fsm, toState);
+                ++transitions;
+            }
+            else
+            {
+                /* Changed state outside of the fleet, track it now. */
+                fleet_track(fleet, entry);
+            }
+
+            index = fleet->memberCursor;
+        }
+        fleet->memberCursor = FLEET_NIL;
+    }
+    else
+    {
+        cfsm_FleetEntry * entry = fleet->entries;
+        cfsm_FleetEntry * const end = &fleet->entries[fleet->count];
+
+        for (; entry != end; ++entry)
+        {
+            /* Removed entries have no state, but are not on any list. */
+            if ((fromState == entry->fsm.state) &&
+                (0u != (entry->flags & FLEET_LIST_MASK)))
+            {
+                cfsm_fleet_transition(fleet, &entry->fsm, toState);
+                ++transitions;
+            }
+        }
+    }
+
+    return transitions;
+}
+
+void * cfsm_enterLocal(cfsm_Ctx * fsm, size_t size)
+{
+    cfsm_FleetEntry * entry = (cfsm_FleetEntry *)fsm;
+    unsigned char * slot = fleet_localSlot(entry);
+
+    /* Refuse data that would spill into the slot of the next entry. */
+    if (((unsigned char *)0 == slot) ||
+        (size > (entry->fleet->localSlot - CFSM_FLEET_LOCAL_HEADER)))
+    {
+        return (void *)0;
+    }
+
+    *(cfsm_TransitionFunction *)slot = fsm->state;
+    entry->flags |= (uint16_t)FLEET_LOCAL;
+
+    return memset(slot + CFSM_FLEET_LOCAL_HEADER, 0, size);
+}
+
+void * cfsm_stateLocal(cfsm_Ctx * fsm)
+{
+    cfsm_FleetEntry * entry = (cfsm_FleetEntry *)fsm;
+    unsigned char * slot = fleet_localSlot(entry);
+
+    /* The slot may be unclaimed or hold the data of an earlier state. */
+    if (((unsigned char *)0 == slot) ||
+        (0u == (entry->flags & FLEET_LOCAL)) ||
+        (fsm->state != *(const cfsm_TransitionFunction *)slot))
+    {
+        return (void *)0;
+    }
+
+    return slot + CFSM_FLEET_LOCAL_HEADER;
+}
+
+void cfsm_sleepUntil(cfsm_Ctx * fsm, cfsm_Time deadline)
+{
+    cfsm_FleetEntry * entry = (cfsm_FleetEntry *)fsm;
+
+    /* A compact fleet instance has no owning fleet. */
+    if ((cfsm_Fleet *)0 == entry->fleet)
+    {
+        return;
+    }
+
+    entry->deadline = deadline;
+    entry->flags = (uint16_t)((entry->flags & ~FLEET_REQ_MASK) | FLEET_REQ_SLEEP);
+
+    /* No fleet call settles an instance that is not runnable. Removed
+     * entries are on no list and are not settled either.
+     */
+    if (0u != (entry->flags & (FLEET_SLEEPING | FLEET_WAITING)))
+    {
+        fleet_settle(entry->fleet, entry);
+    }
+}
+
+void cfsm_sleepUntilEvent(cfsm_Ctx * fsm)
+{
+    cfsm_FleetEntry * entry = (cfsm_FleetEntry *)fsm;
+
+    if ((cfsm_Fleet *)0 == entry->fleet)
+    {
+        return;
+    }
+
+    entry->flags = (uint16_t)((entry->flags & ~FLEET_REQ_MASK) | FLEET_REQ_WAIT);
+
+    if (0u != (entry->flags & (FLEET_SLEEPING | FLEET_WAITING)))
+    {
+        fleet_settle(entry->fleet, entry);
+    }
+}
+
+/******************************************************************************
+ * Local functions
+ *****************************************************************************/
+
+static uint32_t * fleet_listHead(cfsm_Fleet * fleet, unsigned int list)
+{
+    if (FLEET_SLEEPING == list)
+    {
+        return &fleet->sleeping;
+    }
+    else if (FLEET_WAITING == list)
+    {
+        return &fleet->waiting;
+    }
+
+    return &fleet->runnable;
+}
+
+static uint32_t * fleet_listCount(cfsm_Fleet * fleet, unsigned int list)
+{
+    if (FLEET_SLEEPING == list)
+    {
+        return &fleet->sleepingCount;
+    }
+    else if (FLEET_WAITING == list)
+    {
+        return &fleet->waitingCount;
+    }
+
+    return &fleet->runnableCount;
+}
+
+static void fleet_unlink(cfsm_Fleet * fleet, cfsm_FleetEntry * entry)
+{
+    /* Callers check membership, free entries have stale links. */
+    assert(0u != (entry->flags & FLEET_LIST_MASK));
+
+    if (fleet->cursor == (uint32_t)(entry - fleet->entries))
+    {
+        fleet->cursor = entry->next;
+    }
+
+    if (FLEET_NIL != entry->prev)
+    {
+        fleet->entries[entry->prev].next = entry->next;
+    }
+    else
+    {
+        *fleet_listHead(fleet, entry->flags & FLEET_LIST_MASK) = entry->next;
+    }
+
+    if (FLEET_NIL != entry->next)
+    {
+        fleet->entries[entry->next].prev = entry->prev;
+    }
+    else if (0u != (entry->flags & FLEET_SLEEPING))
+    {
+        fleet->sleepingTail = entry->prev;
+    }
+
+    --*fleet_listCount(fleet, entry->flags & FLEET_LIST_MASK);
+    entry->flags &= (uint16_t)~FLEET_LIST_MASK;
+}
+
+static void fleet_link(cfsm_Fleet * fleet, cfsm_FleetEntry * entry, unsigned int list)
+{
+    uint32_t * head = fleet_listHead(fleet, list);
+    uint32_t index = (uint32_t)(entry - fleet->entries);
+    uint32_t prev = FLEET_NIL;
+
+    if (FLEET_SLEEPING == list)
+    {
+        /* Keep deadline order, equal deadlines in request order. Most
+         * sleepers wait for the same duration, so the search starts
+         * at the latest deadline.
+         */
+        prev = fleet->sleepingTail;
+        while ((FLEET_NIL != prev) &&
+               (0 == fleet_isExpired(entry->deadline, fleet->entries[prev].deadline)))
+        {
+            prev = fleet->entries[prev].prev;
+        }
+    }
+
+    entry->prev = prev;
+    if (FLEET_NIL != prev)
+    {
+        entry->next = fleet->entries[prev].next;
+        fleet->entries[prev].next = index;
+    }
+    else
+    {
+        entry->next = *head;
+        *head = index;
+    }
+
+    if (FLEET_NIL != entry->next)
+    {
+        fleet->entries[entry->next].prev = index;
+    }
+    else if (FLEET_SLEEPING == list)
+    {
+        fleet->sleepingTail = index;
+    }
+
+    ++*fleet_listCount(fleet, list);
+    entry->flags |= (uint16_t)list;
+}
+
+static void fleet_settle(cfsm_Fleet * fleet, cfsm_FleetEntry * entry)
+{
+    /* Move entry to the list matching a pending sleep request. */
+    unsigned int list;
+
+    /* A removed entry is on no list and keeps no requests. */
+    if (0u == (entry->flags & FLEET_LIST_MASK))
+    {
+        entry->flags &= (uint16_t)~FLEET_REQ_MASK;
+        return;
+    }
+
+    fleet_track(fleet, entry);
+
+    if (0u != (entry->flags & FLEET_REQ_SLEEP))
+    {
+        list = FLEET_SLEEPING;
+    }
+    else if (0u != (entry->flags & FLEET_REQ_WAIT))
+    {
+        list = FLEET_WAITING;
+    }
+    else
+    {
+        return;
+    }
+
+    fleet_unlink(fleet, entry);
+    entry->flags &= (uint16_t)~FLEET_REQ_MASK;
+    fleet_link(fleet, entry, list);
+}
+
+static void fleet_wake(cfsm_Fleet * fleet, cfsm_FleetEntry * entry)
+{
+    /* Drop pending sleep requests and make entry runnable. */
+    entry->flags &= (uint16_t)~FLEET_REQ_MASK;
+
+    /* A removed entry is on no list, its links are stale. */
+    if ((0u != (entry->flags & FLEET_LIST_MASK)) &&
+        (0u == (entry->flags & FLEET_RUNNABLE)))
+    {
+        fleet_unlink(fleet, entry);
+        fleet_link(fleet, entry, FLEET_RUNNABLE);
+    }
+}
+
+/**
+ * @brief Move an entry to the state list of its active state.
+ *
+ * Does nothing if the fleet does not track states or the state did not
+ * change since the last call.
+ *
+ * @param fleet The fleet data structure.
+ * @param entry The entry to track.
+ */
+static void fleet_track(cfsm_Fleet * fleet, cfsm_FleetEntry * entry)
+{
+    uint32_t index = (uint32_t)(entry - fleet->entries);
+    cfsm_FleetMember * member;
+    cfsm_FleetStateList * list;
+
+    if (((cfsm_FleetMember *)0 == fleet->members) ||
+        (fleet->members[index].state == entry->fsm.state))
+    {
+        return;
+    }
+
+    member = &fleet->members[index];
+    list = fleet_stateList(fleet, member->state);
+    if ((cfsm_FleetStateList *)0 != list)
+    {
+        if (fleet->memberCursor == index)
+        {
+            fleet->memberCursor = member->next;
+        }
+
+        if (FLEET_NIL != member->prev)
+        {
+            fleet->members[member->prev].next = member->next;
+        }
+        else
+        {
+            list->head = member->next;
+        }
+
+        if (FLEET_NIL != member->next)
+        {
+            fleet->members[member->next].prev = member->prev;
+        }
+        --list->count;
+    }
+
+    member->state = entry->fsm.state;
+    member->prev  = FLEET_NIL;
+    member->next  = FLEET_NIL;
+
+    list = fleet_stateList(fleet, member->state);
+    if ((cfsm_FleetStateList *)0 != list)
+    {
+        member->next = list->head;
+        if (FLEET_NIL != list->head)
+        {
+            fleet->members[list->head].prev = index;
+        }
+        list->head = index;
+        ++list->count;
+    }
+}
+
+/**
+ * @brief Get the state local storage slot of an entry.
+ *
+ * @param entry The entry.
+ * @return The slot header or NULL if the fleet has no state local
+ *         storage or entry is a compact fleet instance.
+ */
+static unsigned char * fleet_localSlot(const cfsm_FleetEntry * entry)
+{
+    const cfsm_Fleet * fleet = entry->fleet;
+
+    /* A compact fleet instance has no owning fleet. */
+    if (((const cfsm_Fleet *)0 == fleet) || ((unsigned char *)0 == fleet->localArena))
+    {
+        return (unsigned char *)0;
+    }
+
+    return &fleet->localArena[(size_t)(entry - fleet->entries) * fleet->localSlot];
+}
+
+/**
+ * @brief Find the earliest deadline of all armed timeouts.
+ *
+ * Scans the armed bitmap, which costs one word per 32 entries plus one
+ * deadline per armed timeout.
+ *
+ * @param fleet The fleet data structure.
+ * @param earliest The earliest deadline so far, updated if an armed
+ *                 timeout is due earlier.
+ * @param found Whether earliest holds a deadline already.
+ * @return 1 if earliest holds a deadline, else found.
+ */
+static int fleet_earliestTimeout(const cfsm_Fleet * fleet, cfsm_Time * earliest, int found)
+{
+    if ((uint32_t *)0 == fleet->armed)
+    {
+        return found;
+    }
+
+    for (size_t base = 0u; base < fleet->count; base += FLEET_EXPIRE_BLOCK)
+    {
+        uint32_t word = fleet->armed[base / FLEET_EXPIRE_BLOCK];
+
+        while (0u != word)
+        {
+            cfsm_Time deadline = fleet->deadlines[base + fleet_lowestBit(word)];
+
+            word &= word - 1u;
+
+            if ((0 == found) || fleet_isExpired(*earliest, deadline))
+            {
+                *earliest = deadline;
+                found = 1;
+            }
+        }
+    }
+
+    return found;
+}
+
+/**
+ * @brief Find the state list of a tracked state.
+ *
+ * @param fleet The fleet data structure.
+ * @param state The enter operation of the state.
+ * @return The state list or NULL if the state is not tracked.
+ */
+static cfsm_FleetStateList * fleet_stateList(
+    const cfsm_Fleet * fleet,
+    cfsm_TransitionFunction state)
+{
+    if ((cfsm_TransitionFunction)0 != state)
+    {
+        for (size_t i = 0u; i < fleet->stateCount; ++i)
+        {
+            if (state == fleet->stateLists[i].state)
+            {
+                return &fleet->stateLists[i];
+            }
+        }
+    }
+
+    return (cfsm_FleetStateList *)0;
+}
+
+static int fleet_isExpired(cfsm_Time now, cfsm_Time deadline)
+{
+    /* Wrap around safe check for "now >= deadline". */
+    return (cfsm_Time)(now - deadline) < (cfsm_Time)0x80000000u;
+}
+
+static size_t fleet_bucketOf(const cfsm_Fleet * fleet, cfsm_Handle handle, unsigned int shift)
+{
+    /* Invalid indices go to the last bucket, cfsm_fleet_post() drops them. */
+    size_t index = (size_t)(handle & FLEET_INDEX_MASK);
+
+    if (index >= fleet->count)
+    {
+        return FLEET_INGEST_BUCKETS - 1u;
+    }
+
+    index >>= shift;
+
+    return (index < FLEET_INGEST_BUCKETS) ? index : (FLEET_INGEST_BUCKETS - 1u);
+}
+
+/**
+ * @brief Disarm the timeout of an entry if deadlines are attached.
+ *
+ * @param fleet The fleet data structure.
+ * @param index The entry index.
+ */
+static void fleet_disarm(cfsm_Fleet * fleet, size_t index)
+{
+    if ((uint32_t *)0 != fleet->armed)
+    {
+        fleet->armed[index / FLEET_EXPIRE_BLOCK] &=
+            ~((uint32_t)1u << (index % FLEET_EXPIRE_BLOCK));
+    }
+}
+
+/**
+ * @brief Compare a block of deadlines against now.
+ *
+ * @param deadlines FLEET_EXPIRE_BLOCK deadlines.
+ * @param now The current time.
+ * @return Bit mask with a set bit for each expired deadline.
+ */
+static uint32_t fleet_expiredMask(const cfsm_Time * deadlines, cfsm_Time now)
+{
+    uint32_t mask = 0u;
+
+#if defined(__AVX2__)
+    const __m256i vnow = _mm256_set1_epi32((int)now);
+
+    for (unsigned int i = 0u; i < FLEET_EXPIRE_BLOCK; i += 8u)
+    {
+        /* Expired if now - deadline is positive as signed value, see
+         * fleet_isExpired(). The sign bits are collected by movemask.
+         */
+        __m256i diff = _mm256_sub_epi32(
+            vnow,
+            _mm256_loadu_si256((const __m256i *)&deadlines[i]));
+        unsigned int pending = (unsigned int)_mm256_movemask_ps(_mm256_castsi256_ps(diff));
+
+        mask |= (uint32_t)(~pending & 0xFFu) << i;
+    }
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+    static const uint32_t laneBits[4] = { 1u, 2u, 4u, 8u };
+    const uint32x4_t vnow = vdupq_n_u32(now);
+    const uint32x4_t vhalf = vdupq_n_u32(0x80000000u);
+    const uint32x4_t vbits = vld1q_u32(laneBits);
+
+    for (unsigned int i = 0u; i < FLEET_EXPIRE_BLOCK; i += 4u)
+    {
+        uint32x4_t diff = vsubq_u32(vnow, vld1q_u32(&deadlines[i]));
+        uint32x4_t expired = vcltq_u32(diff, vhalf);
+
+        mask |= vaddvq_u32(vandq_u32(expired, vbits)) << i;
+    }
+#else
+    for (unsigned int i = 0u; i < FLEET_EXPIRE_BLOCK; ++i)
+    {
+        mask |= (uint32_t)fleet_isExpired(now, deadlines[i]) << i;
+    }
+#endif
+
+    return mask;
+}
+
+/**
+ * @brief Get the position of the lowest set bit.
+ *
+ * @param mask A non zero bit mask.
+ * @return The bit position.
+ */
+static unsigned int fleet_lowestBit(uint32_t mask)
+{
+#if defined(__GNUC__)
+    return (unsigned int)__builtin_ctzl((unsigned long)mask);
+#else
+    unsigned int position = 0u;
+
+    while (0u == (mask & 1u))
+    {
+        mask >>= 1;
+        ++position;
+    }
+
+    return position;
+#endif
+}
+
+#endif /* CFSM_ENABLE_STATE_ID */
@@ -0,0 +1,699 @@
+/* MIT License
+ *
+ * Copyright (C) 2024  Haju Schulz <haju@schulznorbert.de>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*******************************************************************************
+    DESCRIPTION
+*******************************************************************************/
+/**
+ * @brief  CFSM fleet header file
+ *
+ * A fleet manages many CFSM instances that share the same state handlers.
+ * It keeps track of which instances need process cycles, so that instances
+ * waiting for a timeout or an event cost nothing during cfsm_fleet_process().
+ *
+ * The fleet does not allocate memory. The application provides the entry
+ * storage during cfsm_fleet_init().
+ *
+ * Repository: https://github.com/nhjschulz/cfsm
+ *
+ * @addtogroup CFSM
+ *
+ * @{
+ */
+
+#ifndef SRC_C_FSM_C_FSM_FLEET_H_
+#define SRC_C_FSM_C_FSM_FLEET_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/******************************************************************************
+ * Includes
+ *****************************************************************************/
+#include <stddef.h>
+#include <stdint.h>
+
+#include "c_fsm.h"
+
+#if !defined(CFSM_ENABLE_STATE_ID)
+#error "c_fsm_fleet.h requires CFSM_ENABLE_STATE_ID"
+#endif
+
+/******************************************************************************
+ * Macros
+ *****************************************************************************/
+
+#ifndef CFSM_FLEET_INDEX_BITS
+/** Number of handle bits for the entry index, the rest is the generation. */
+#define CFSM_FLEET_INDEX_BITS 24
+#endif
+
+#if (CFSM_FLEET_INDEX_BITS < 1) || (CFSM_FLEET_INDEX_BITS > 24)
+#error "CFSM_FLEET_INDEX_BITS must be 1 to 24 to leave at least 8 generation bits"
+#endif
+
+/** Number of uint32_t words of the armed bitmap for a given capacity. */
+#define CFSM_FLEET_ARMED_WORDS(capacity) (((capacity) + 31u) / 32u)
+
+/** Element of an application column array for the given fleet instance. */
+#define CFSM_FLEET_COLUMN(fleet, column, fsm) \
+    ((column)[cfsm_fleet_indexOf((fleet), (fsm))])
+
+/** A handle value that never refers to a fleet instance. */
+#define CFSM_FLEET_INVALID_HANDLE ((cfsm_Handle)0)
+
+/** Alignment of state local storage slots in bytes. */
+#define CFSM_FLEET_LOCAL_ALIGN 8u
+
+/** Size of state local storage slots for a given state local size. */
+#define CFSM_FLEET_LOCAL_SLOT(size) \
+    (((size) + CFSM_FLEET_LOCAL_ALIGN - 1u) & ~(size_t)(CFSM_FLEET_LOCAL_ALIGN - 1u))
+
+/** Size of the slot header, which records the state owning the slot. */
+#define CFSM_FLEET_LOCAL_HEADER CFSM_FLEET_LOCAL_SLOT(sizeof(cfsm_TransitionFunction))
+
+/** Arena size needed for capacity instances with given state local size. */
+#define CFSM_FLEET_LOCAL_ARENA_SIZE(capacity, size) \
+    ((capacity) * (CFSM_FLEET_LOCAL_HEADER + CFSM_FLEET_LOCAL_SLOT(size)))
+
+/******************************************************************************
+ * Types and Classes
+ *****************************************************************************/
+
+/**
+ * @brief Application defined time base, for example milliseconds.
+ *
+ * Time values may wrap around. Deadlines are compared relative to "now",
+ * so they must not be further than half the value range in the future.
+ */
+typedef uint32_t cfsm_Time;
+
+/**
+ * @brief Handle to a fleet instance.
+ *
+ * A handle combines the entry index with a generation counter that
+ * changes when the entry is removed. Handles to removed instances are
+ * therefore detected as stale, even if the entry got reused.
+ */
+typedef uint32_t cfsm_Handle;
+
+/** A fleet managed CFSM instance
+ *
+ * An entry is 64 bytes on 64 bit targets, so an entry array starting at
+ * a cache line boundary has one entry per 64 byte cache line. This does
+ * not hold with CFSM_ENABLE_PROFILE, which adds to the cfsm_Ctx.
+ */
+typedef struct cfsm_FleetEntry {
+    cfsm_Ctx            fsm;        /**< Instance FSM (must be first)         */
+    struct cfsm_Fleet * fleet;      /**< Owning fleet                         */
+    uint32_t            prev;       /**< Index of previous entry in same list */
+    uint32_t            next;       /**< Index of next entry in same/free list*/
+    cfsm_Time           deadline;   /**< Wake up time if sleeping             */
+    uint16_t            flags;      /**< Fleet internal state flags           */
+    uint16_t            generation; /**< Handle generation counter            */
+} cfsm_FleetEntry;
+
+/** Instances of a fleet in one state, see cfsm_fleet_attachStates()
+ */
+typedef struct cfsm_FleetStateList {
+    cfsm_TransitionFunction state; /**< Tracked state, set by application */
+    uint32_t                head;  /**< First instance in the state       */
+    uint32_t                count; /**< Number of instances in the state  */
+} cfsm_FleetStateList;
+
+/** State membership of a fleet entry, see cfsm_fleet_attachStates()
+ */
+typedef struct cfsm_FleetMember {
+    cfsm_TransitionFunction state; /**< State the entry is tracked in     */
+    uint32_t                prev;  /**< Previous entry in same state list */
+    uint32_t                next;  /**< Next entry in same state list     */
+} cfsm_FleetMember;
+
+/** The CFSM fleet data structure
+ */
+typedef struct cfsm_Fleet {
+    cfsm_FleetEntry *     entries;       /**< Application provided entry storage */
+    size_t                capacity;      /**< Number of entries in storage       */
+    size_t                count;         /**< Entries taken from storage so far  */
+    unsigned char *       localArena;    /**< State local storage or NULL        */
+    size_t                localSlot;     /**< Size of a slot including header    */
+    cfsm_Time *           deadlines;     /**< Timeout deadline column or NULL    */
+    uint32_t *            armed;         /**< Bitmap of armed timeouts or NULL   */
+    cfsm_FleetStateList * stateLists;    /**< Tracked states or NULL             */
+    size_t                stateCount;    /**< Number of tracked states           */
+    cfsm_FleetMember *    members;       /**< State membership column or NULL    */
+    uint32_t              memberCursor;  /**< Next entry of state list walk      */
+    uint32_t              freeList;      /**< Removed entries for reuse, oldest
+                                              first                              */
+    uint32_t              freeTail;      /**< Most recently removed entry        */
+    uint32_t              runnable;      /**< Instances getting process cycles   */
+    uint32_t              sleeping;      /**< Instances sleeping until deadline,
+                                              earliest deadline first            */
+    uint32_t              sleepingTail;  /**< Sleeper with the latest deadline   */
+    uint32_t              waiting;       /**< Instances sleeping until event     */
+    uint32_t              cursor;        /**< Next entry during process loop     */
+    uint32_t              runnableCount; /**< Length of runnable list            */
+    uint32_t              sleepingCount; /**< Length of sleeping list            */
+    uint32_t              waitingCount;  /**< Length of waiting list             */
+} cfsm_Fleet;
+
+/** A fleet padded to whole cache lines
+ *
+ * The fleet data structure is written on every process cycle. Fleets of
+ * different worker threads kept in one array should therefore use the
+ * padded type, in an array that starts cache line aligned.
+ */
+typedef union cfsm_PaddedFleet {
+    cfsm_Fleet    fleet;                                    /**< The fleet */
+    unsigned char pad[CFSM_CACHE_ROUND(sizeof(cfsm_Fleet))]; /**< Padding   */
+} cfsm_PaddedFleet;
+
+/** Fleet statistics reported by cfsm_fleet_stats()
+ */
+typedef struct cfsm_FleetStats {
+    size_t       capacity;     /**< Number of entries in storage          */
+    size_t       used;         /**< Entries taken from storage so far     */
+    size_t       live;         /**< Instances in the fleet                */
+    size_t       runnable;     /**< Instances getting process cycles      */
+    size_t       sleeping;     /**< Instances sleeping until deadline     */
+    size_t       waiting;      /**< Instances sleeping until event        */
+    const void * storage;      /**< Start of the entry storage            */
+    size_t       storageBytes; /**< Bytes of entry storage used so far    */
+} cfsm_FleetStats;
+
+/******************************************************************************
+ * Functions
+ *****************************************************************************/
+
+/**
+ * @brief Initialize the given fleet.
+ *
+ * The fleet uses the entries array as storage for its instances. The
+ * array must stay valid as long as the fleet is used. A capacity beyond
+ * the handle index range (see CFSM_FLEET_INDEX_BITS) is truncated.
+ *
+ * @param fleet The fleet data structure to initialize.
+ * @param entries Storage for the fleet instances.
+ * @param capacity Number of elements in entries.
+ * @since 0.4.0
+ */
+void cfsm_fleet_init(cfsm_Fleet * fleet, cfsm_FleetEntry * entries, size_t capacity);
+
+/**
+ * @brief Initialize a fleet as one shard of shared entry storage.
+ *
+ * Splits the storage into shardCount parts at cache line boundaries and
+ * initializes the fleet with part number shard. Fleets of different
+ * worker threads initialized from the same storage this way never share
+ * a cache line, provided the storage is cache line aligned.
+ *
+ * @param fleet The fleet data structure to initialize.
+ * @param storage Cache line aligned storage for all shards.
+ * @param storageSize Size of storage in bytes.
+ * @param shard Number of the shard to initialize, less than shardCount.
+ * @param shardCount Number of shards sharing the storage.
+ * @since 0.4.0
+ */
+void cfsm_fleet_initShard(
+    cfsm_Fleet * fleet,
+    void * storage,
+    size_t storageSize,
+    size_t shard,
+    size_t shardCount);
+
+/**
+ * @brief Provide state local storage for the fleet instances.
+ *
+ * The arena is split into one slot per fleet entry. A slot holds the
+ * state local data of the active state only, so it must be as large as
+ * the largest state local data of all states (see cfsm_enterLocal()).
+ * Use CFSM_FLEET_LOCAL_ARENA_SIZE() to calculate the arena size. Must be
+ * called before the instances enter states that use cfsm_enterLocal().
+ *
+ * @param fleet The fleet data structure.
+ * @param arena Storage for state local data, aligned for any data type.
+ * @param localSize The largest state local data size.
+ * @since 0.4.0
+ */
+void cfsm_fleet_attachLocal(cfsm_Fleet * fleet, void * arena, size_t localSize);
+
+/**
+ * @brief Track the instances of the given states in per state lists.
+ *
+ * Lets cfsm_fleet_transitionAll() visit the instances of a tracked state
+ * only, instead of scanning all entries. The application sets the state
+ * member of each list, the other members are initialized. A state change
+ * is tracked when its instance returns to the fleet, like after a handler
+ * call of cfsm_fleet_process() or cfsm_fleet_event(), or by
+ * cfsm_fleet_transition(). A cfsm_transition() of the application on a
+ * fleet instance is not seen until then. Tracking costs a lookup in the
+ * lists on each state change, so it is meant for a few states.
+ *
+ * @param fleet The fleet data structure.
+ * @param lists States to track, each state at most once and not NULL.
+ * @param listCount Number of elements in lists.
+ * @param members Membership column with capacity elements.
+ * @since 0.4.0
+ */
+void cfsm_fleet_attachStates(
+    cfsm_Fleet * fleet,
+    cfsm_FleetStateList * lists,
+    size_t listCount,
+    cfsm_FleetMember * members);
+
+/**
+ * @brief Provide timeout deadline storage for the fleet instances.
+ *
+ * Timeouts replace process operations that poll a time difference in
+ * every cycle. An instance arms a timeout by cfsm_fleet_armTimeout() and
+ * may then sleep until an event. cfsm_fleet_expire() finds all expired
+ * deadlines in one pass over the contiguous deadline column and signals
+ * the timeout event to those instances only. Must be called before
+ * instances are added.
+ *
+ * @param fleet The fleet data structure.
+ * @param deadlines Deadline column with capacity elements.
+ * @param armed Bitmap with CFSM_FLEET_ARMED_WORDS(capacity) elements.
+ * @since 0.4.0
+ */
+void cfsm_fleet_attachDeadlines(
+    cfsm_Fleet * fleet,
+    cfsm_Time * deadlines,
+    uint32_t * armed);
+
+/**
+ * @brief Add a new instance to the fleet.
+ *
+ * The returned fsm is initialized by cfsm_init() with the given instance
+ * data and is runnable. Use cfsm_transition() to enter its first state.
+ * Entries of removed instances are reused first, the longest removed
+ * one first. Adding and removing instances takes constant time.
+ *
+ * @param fleet The fleet data structure.
+ * @param instanceData Pointer to instance data (may be NULL if unneeded).
+ * @return The new instance fsm or NULL if the fleet is full.
+ * @since 0.4.0
+ */
+cfsm_Ctx * cfsm_fleet_add(cfsm_Fleet * fleet, cfsm_InstanceDataPtr instanceData);
+
+/**
+ * @brief Remove an instance from the fleet.
+ *
+ * The instance leaves its active state by cfsm_transition() to NULL.
+ * Its entry is then released for reuse and all handles to the instance
+ * become stale.
+ *
+ * Each reuse of an entry takes the next handle generation. The generation
+ * wraps around after 255 reuses with the default CFSM_FLEET_INDEX_BITS,
+ * so a handle kept over that many reuses of its entry could match a
+ * later instance again. Released entries are reused in removal order,
+ * which spreads reuses over all entries and makes this unlikely. Fewer
+ * index bits give more generations.
+ *
+ * @param fleet The fleet data structure.
+ * @param fsm A fsm returned by cfsm_fleet_add() for this fleet.
+ * @since 0.4.0
+ */
+void cfsm_fleet_remove(cfsm_Fleet * fleet, cfsm_Ctx * fsm);
+
+/**
+ * @brief Get the handle of a fleet instance.
+ *
+ * @param fleet The fleet data structure.
+ * @param fsm A fsm returned by cfsm_fleet_add() for this fleet.
+ * @return The handle to the instance.
+ * @since 0.4.0
+ */
+cfsm_Handle cfsm_fleet_handleOf(const cfsm_Fleet * fleet, const cfsm_Ctx * fsm);
+
+/**
+ * @brief Get the fsm of a fleet instance by handle.
+ *
+ * @param fleet The fleet data structure.
+ * @param handle A handle returned by cfsm_fleet_handleOf().
+ * @return The instance fsm or NULL if the handle is stale or invalid.
+ * @since 0.4.0
+ */
+cfsm_Ctx * cfsm_fleet_lookup(const cfsm_Fleet * fleet, cfsm_Handle handle);
+
+/**
+ * @brief Get the entry index of a fleet instance.
+ *
+ * The index is stable while the instance is in the fleet and below the
+ * fleet capacity. It can therefore index application arrays of capacity
+ * elements that hold instance data as columns (struct of arrays) instead
+ * of a struct per instance, see CFSM_FLEET_COLUMN(). Bulk operations
+ * then loop over a contiguous column and get the instance back with
+ * cfsm_fleet_at(). Entries of removed instances are reused, so column
+ * elements need to be initialized when an instance is added.
+ *
+ * @param fleet The fleet data structure.
+ * @param fsm A fsm returned by cfsm_fleet_add() for this fleet.
+ * @return The entry index of the instance.
+ * @since 0.4.0
+ */
+size_t cfsm_fleet_indexOf(const cfsm_Fleet * fleet, const cfsm_Ctx * fsm);
+
+/**
+ * @brief Get the fsm of a fleet instance by entry index.
+ *
+ * Entry indices below the count member of the fleet have been used.
+ * Column loops therefore need to cover this range only.
+ *
+ * @param fleet The fleet data structure.
+ * @param index An entry index, see cfsm_fleet_indexOf().
+ * @return The instance fsm or NULL if no instance uses the entry.
+ * @since 0.4.0
+ */
+cfsm_Ctx * cfsm_fleet_at(const cfsm_Fleet * fleet, size_t index);
+
+/**
+ * @brief Signal an event to a fleet instance by handle.
+ *
+ * Like cfsm_fleet_event(), but the event is dropped if the handle is
+ * stale. This allows event producers to hold on to handles without
+ * tracking the instance lifetime. The fleet itself is not thread safe,
+ * so posting from other threads requires the application to pass the
+ * (handle, event) pair to the fleet owning thread, for example through
+ * a queue.
+ *
+ * @param fleet The fleet data structure.
+ * @param handle A handle returned by cfsm_fleet_handleOf().
+ * @param eventId An application defined ID to identify the event.
+ * @return 1 if the event was signaled, 0 if it was dropped.
+ * @since 0.4.0
+ */
+int cfsm_fleet_post(cfsm_Fleet * fleet, cfsm_Handle handle, int eventId);
+
+/**
+ * @brief Signal a columnar batch of (instance, event) pairs to the fleet.
+ *
+ * Event i is posted to the instance targets[i] like cfsm_fleet_post().
+ * If scratch storage is given, the batch is first partitioned by entry
+ * index into ranges of neighbouring entries. Delivery then passes the
+ * fleet storage mostly sequentially instead of randomly, which pays off
+ * for batches much larger than the CPU caches. The partitioning is
+ * stable, so the events of one instance are delivered in their original
+ * order. The order between different instances is not kept.
+ *
+ * @param fleet The fleet data structure.
+ * @param targets Handles of the instances to receive the events.
+ * @param eventIds Application defined event IDs.
+ * @param count Number of elements in targets and eventIds.
+ * @param scratchTargets Storage for count handles or NULL.
+ * @param scratchIds Storage for count event IDs or NULL.
+ * @return The number of delivered events. Events to stale handles
+ *         are dropped.
+ * @since 0.4.0
+ */
+size_t cfsm_fleet_ingest(
+    cfsm_Fleet * fleet,
+    const cfsm_Handle * targets,
+    const int * eventIds,
+    size_t count,
+    cfsm_Handle * scratchTargets,
+    int * scratchIds);
+
+/**
+ * @brief Execute a process cycle for all runnable fleet instances.
+ *
+ * Sleeping instances whose deadline has been reached become runnable
+ * first. Then cfsm_process() is called for every runnable instance.
+ * Sleepers are kept ordered by deadline, so only expired ones and the
+ * next one to expire are touched. Instances sleeping until an event are
+ * skipped without being touched.
+ *
+ * @param fleet The fleet data structure.
+ * @param now The current time.
+ * @since 0.4.0
+ */
+void cfsm_fleet_process(cfsm_Fleet * fleet, cfsm_Time now);
+
+/**
+ * @brief Get the time until the next process cycle is needed.
+ *
+ * Intended for event loops that block on I/O between process cycles,
+ * to calculate the timeout of the blocking call. Timeouts armed by
+ * cfsm_fleet_armTimeout() count as well, the loop then has to call
+ * cfsm_fleet_expire() before cfsm_fleet_process(). They are found by a
+ * scan of the armed bitmap, one word per 32 instances.
+ *
+ * @param fleet The fleet data structure.
+ * @param now The current time.
+ * @param delay Set to the time until cfsm_fleet_process() must be called.
+ *              It is 0 if there are runnable instances, expired sleepers
+ *              or expired timeouts.
+ * @return 1 if delay was set, 0 if all instances wait for an event
+ *         without armed timeout.
+ * @since 0.4.0
+ */
+int cfsm_fleet_nextProcess(const cfsm_Fleet * fleet, cfsm_Time now, cfsm_Time * delay);
+
+/**
+ * @brief Get statistics of a fleet.
+ *
+ * Takes constant time. The storage range allows applications to report
+ * the memory placement of a fleet, for example the NUMA node of each
+ * shard when running one fleet per worker thread.
+ *
+ * @param fleet The fleet data structure.
+ * @param stats Set to the current fleet statistics.
+ * @since 0.4.0
+ */
+void cfsm_fleet_stats(const cfsm_Fleet * fleet, cfsm_FleetStats * stats);
+
+/**
+ * @brief Arm the timeout of a fleet instance.
+ *
+ * A previously armed timeout of the instance is replaced. Timeouts stay
+ * armed across transitions until they expire or get disarmed. Requires
+ * cfsm_fleet_attachDeadlines().
+ *
+ * @param fleet The fleet data structure.
+ * @param fsm A fsm returned by cfsm_fleet_add() for this fleet.
+ * @param deadline Time at which the timeout expires.
+ * @since 0.4.0
+ */
+void cfsm_fleet_armTimeout(cfsm_Fleet * fleet, cfsm_Ctx * fsm, cfsm_Time deadline);
+
+/**
+ * @brief Disarm the timeout of a fleet instance.
+ *
+ * Removing an instance disarms its timeout as well.
+ *
+ * @param fleet The fleet data structure.
+ * @param fsm A fsm returned by cfsm_fleet_add() for this fleet.
+ * @since 0.4.0
+ */
+void cfsm_fleet_disarmTimeout(cfsm_Fleet * fleet, cfsm_Ctx * fsm);
+
+/**
+ * @brief Signal a timeout event to all instances with expired deadline.
+ *
+ * Scans the deadline column in blocks of 32 instances. Blocks without
+ * armed timeout are skipped by the armed bitmap. The deadline compare
+ * uses AVX2 or AArch64 NEON if the compiler targets them (for example
+ * with -mavx2 or -march=native) and a portable scalar loop otherwise.
+ * Expired timeouts are disarmed before the event is signaled by
+ * cfsm_fleet_event(), so handlers may arm a new timeout.
+ *
+ * @param fleet The fleet data structure.
+ * @param now The current time.
+ * @param eventId Event ID of the timeout event.
+ * @return The number of signaled timeout events.
+ * @since 0.4.0
+ */
+size_t cfsm_fleet_expire(cfsm_Fleet * fleet, cfsm_Time now, int eventId);
+
+/**
+ * @brief Signal an event to a fleet instance.
+ *
+ * A sleeping instance becomes runnable again before the event is passed
+ * to cfsm_event().
+ *
+ * @param fleet The fleet data structure.
+ * @param fsm A fsm returned by cfsm_fleet_add() for this fleet.
+ * @param eventId An application defined ID to identify the event.
+ * @since 0.4.0
+ */
+void cfsm_fleet_event(cfsm_Fleet * fleet, cfsm_Ctx * fsm, int eventId);
+
+/**
+ * @brief Signal a sequence of events to a fleet instance.
+ *
+ * Like cfsm_fleet_event(), but the events are passed to cfsm_eventBatch().
+ * Sleep requests from the handlers take effect after the whole batch.
+ *
+ * @param fleet The fleet data structure.
+ * @param fsm A fsm returned by cfsm_fleet_add() for this fleet.
+ * @param eventIds Application defined event IDs.
+ * @param count Number of elements in eventIds.
+ * @return The number of events passed to an onEvent handler, see
+ *         cfsm_eventBatch().
+ * @since 0.4.0
+ */
+size_t cfsm_fleet_eventBatch(
+    cfsm_Fleet * fleet,
+    cfsm_Ctx * fsm,
+    const int * eventIds,
+    size_t count);
+
+/**
+ * @brief Signal an event with payload to a fleet instance.
+ *
+ * Like cfsm_fleet_event(), but the event is passed to cfsm_eventData().
+ *
+ * @param fleet The fleet data structure.
+ * @param fsm A fsm returned by cfsm_fleet_add() for this fleet.
+ * @param eventId An application defined ID to identify the event.
+ * @param data The event payload (may be NULL if size is 0).
+ * @param size The payload size in bytes.
+ * @since 0.4.0
+ */
+void cfsm_fleet_eventData(
+    cfsm_Fleet * fleet,
+    cfsm_Ctx * fsm,
+    int eventId,
+    const void * data,
+    size_t size);
+
+/**
+ * @brief Transition a fleet instance to a new state.
+ *
+ * Same as cfsm_transition(), but a sleeping instance becomes runnable
+ * first, as the sleep belongs to the left state, and the new state is
+ * tracked at once (see cfsm_fleet_attachStates()).
+ *
+ * @param fleet The fleet data structure.
+ * @param fsm A fsm returned by cfsm_fleet_add() for this fleet.
+ * @param enterFunc The enter operation for the new state (may be NULL)
+ * @since 0.4.0
+ */
+void cfsm_fleet_transition(
+    cfsm_Fleet * fleet,
+    cfsm_Ctx * fsm,
+    cfsm_TransitionFunction enterFunc);
+
+/**
+ * @brief Transition all fleet instances in a given state to a new state.
+ *
+ * Every instance whose active state is fromState (see cfsm_Ctx::state)
+ * transitions to toState by cfsm_transition(). Sleeping instances become
+ * runnable before the transition, as the sleep belongs to the left state.
+ *
+ * If fromState is tracked by cfsm_fleet_attachStates(), only the
+ * instances in its list are visited. Otherwise all entries are scanned.
+ *
+ * @param fleet The fleet data structure.
+ * @param fromState The enter operation identifying the state to leave.
+ * @param toState The enter operation of the new state (may be NULL).
+ * @return The number of instances that transitioned.
+ * @since 0.4.0
+ */
+size_t cfsm_fleet_transitionAll(
+    cfsm_Fleet * fleet,
+    cfsm_TransitionFunction fromState,
+    cfsm_TransitionFunction toState);
+
+/**
+ * @brief Suspend process cycles of a fleet instance until a deadline.
+ *
+ * The instance is excluded from cfsm_fleet_process() until the deadline
+ * has been reached or an event is signaled through cfsm_fleet_event().
+ * The request is typically done from inside a state handler and takes
+ * effect when the handler returns to the fleet. For an instance that
+ * sleeps already, it takes effect at once.
+ *
+ * The instance is inserted into the deadline ordered sleepers, searching
+ * from the latest deadline. The insertion time grows with the number of
+ * sleepers that have a later deadline. It is constant if instances sleep
+ * for the same duration.
+ *
+ * Only fleet instances can sleep. The call is ignored for a compact fleet
+ * instance, other contexts must not be passed.
+ *
+ * @param fsm A fsm returned by cfsm_fleet_add().
+ * @param deadline The time to resume process cycles.
+ * @since 0.4.0
+ */
+void cfsm_sleepUntil(cfsm_Ctx * fsm, cfsm_Time deadline);
+
+/**
+ * @brief Suspend process cycles of a fleet instance until an event.
+ *
+ * The instance is excluded from cfsm_fleet_process() until an event is
+ * signaled through cfsm_fleet_event().
+ * The request is typically done from inside a state handler and takes
+ * effect when the handler returns to the fleet. For an instance that
+ * sleeps already, it takes effect at once.
+ *
+ * Only fleet instances can wait. The call is ignored for a compact fleet
+ * instance, other contexts must not be passed.
+ *
+ * @param fsm A fsm returned by cfsm_fleet_add().
+ * @since 0.4.0
+ */
+void cfsm_sleepUntilEvent(cfsm_Ctx * fsm);
+
+/**
+ * @brief Claim state local storage for the state being entered.
+ *
+ * Called from a state enter operation to get zero initialized storage
+ * that lives while the state is active. Leaving the state releases it
+ * for the next state, so no data is preserved between states. The slot
+ * records the claiming state, so a later state that does not claim the
+ * slot gets no stale data from cfsm_stateLocal().
+ * Only fleet instances have state local storage, other contexts than
+ * fleet or compact fleet instances must not be passed.
+ *
+ * @param fsm A fsm returned by cfsm_fleet_add().
+ * @param size The state local data size.
+ * @return The storage or NULL if the fleet has no state local storage,
+ *         size exceeds the localSize passed to cfsm_fleet_attachLocal()
+ *         or fsm is a compact fleet instance.
+ * @since 0.4.0
+ */
+void * cfsm_enterLocal(cfsm_Ctx * fsm, size_t size);
+
+/**
+ * @brief Get the state local storage of the active state.
+ *
+ * Other contexts than fleet or compact fleet instances must not be
+ * passed.
+ *
+ * @param fsm A fsm returned by cfsm_fleet_add().
+ * @return The storage claimed by cfsm_enterLocal() or NULL if the active
+ *         state did not claim storage, the fleet has no state local
+ *         storage or fsm is a compact fleet instance.
+ * @since 0.4.0
+ */
+void * cfsm_stateLocal(cfsm_Ctx * fsm);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SRC_C_FSM_C_FSM_FLEET_H_ */
+
+/** @} */
@@ -0,0 +1,342 @@
+/* MIT License
+ *
+ * Copyright (C) 2024  Haju Schulz <haju@schulznorbert.de>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+/*******************************************************************************
+    DESCRIPTION
+*******************************************************************************/
+
+/**
+ * @brief  CFSM event hit matrix implementation
+ *
+ * This file contains the implementation for counting cfsm events per
+ * (state, event ID) pair. It is empty unless CFSM_ENABLE_HITS is defined.
+ *
+ * Repository: https://github.com/nhjschulz/cfsm
+ *
+ */
+
+/******************************************************************************
+ * Includes
+ *****************************************************************************/
+#include "c_fsm_hits.h"
+
+#if defined(CFSM_ENABLE_HITS)
+
+#include <string.h>
+
+/******************************************************************************
+ * Macros
+ *****************************************************************************/
+
+/* Thread local storage class of the attached matrix. Targets without
+ * threads fall back to a plain static variable.
+ */
+#if defined(__STDC_VERSION__) && (__STDC_VERSION__ >= 201112L) && \
+    !defined(__STDC_NO_THREADS__)
+#define HITS_THREAD_LOCAL _Thread_local
+#elif defined(__GNUC__) && !defined(__AVR__)
+#define HITS_THREAD_LOCAL __thread
+#elif defined(_MSC_VER)
+#define HITS_THREAD_LOCAL __declspec(thread)
+#else
+#define HITS_THREAD_LOCAL
+#endif
+
+/******************************************************************************
+ * Types and Classes
+ *****************************************************************************/
+
+/******************************************************************************
+ * Prototypes
+ *****************************************************************************/
+
+static cfsm_HitCell * hits_lookup(
+    cfsm_Hits * hits,
+    cfsm_TransitionFunction state,
+    int eventId);
+static size_t hits_hash(cfsm_TransitionFunction state, int eventId);
+static void hits_writeState(
+    FILE * out,
+    cfsm_HitsStateName stateName,
+    cfsm_TransitionFunction state);
+
+/******************************************************************************
+ * Variables
+ *****************************************************************************/
+
+static HITS_THREAD_LOCAL cfsm_Hits * activeHits; /**< Matrix of this thread */
+
+/******************************************************************************
+ * External functions
+ *****************************************************************************/
+
+void cfsm_hits_init(cfsm_Hits * hits, cfsm_HitCell * cells, size_t capacity)
+{
+    size_t size = 1u;
+
+    /* Round down to a power of two for masking instead of modulo. */
+    while ((size << 1) <= capacity)
+    {
+        size <<= 1;
+    }
+
+    hits->cells    = cells;
+    hits->capacity = (0u != capacity) ? size : 0u;
+    hits->used     = 0u;
+    hits->dropped  = 0u;
+
+    memset(cells, 0, capacity * sizeof(*cells));
+}
+
+void cfsm_hits_attach(cfsm_Hits * hits)
+{
+    activeHits = hits;
+}
+
+void cfsm_hits_record(cfsm_TransitionFunction state, int eventId, int handled)
+{
+    cfsm_Hits * hits = activeHits;
+
+    if ((cfsm_Hits *)0 != hits)
+    {
+        cfsm_HitCell * cell = hits_lookup(hits, state, eventId);
+
+        if ((cfsm_HitCell *)0 == cell)
+        {
+            ++hits->dropped;
+        }
+        else
+        {
+            ++cell->hits;
+
+            if (0 == handled)
+            {
+                ++cell->unhandled;
+            }
+        }
+    }
+}
+
+const cfsm_HitCell * cfsm_hits_find(
+    const cfsm_Hits * hits,
+    cfsm_TransitionFunction state,
+    int eventId)
+{
+    size_t mask = hits->capacity - 1u;
+    size_t index;
+    size_t probes;
+
+    index = hits_hash(state, eventId) & mask;
+
+    for (probes = 0u; probes < hits->capacity; ++probes)
+    {
+        const cfsm_HitCell * cell = &hits->cells[index];
+
+        if (0u == cell->hits)
+        {
+            break;
+        }
+        if ((cell->state == state) && (cell->eventId == (int32_t)eventId))
+        {
+            return cell;
+        }
+        index = (index + 1u) & mask;
+    }
+
+    return (const cfsm_HitCell *)0;
+}
+
+void cfsm_hits_merge(cfsm_Hits * dst, const cfsm_Hits * src)
+{
+    size_t index;
+
+    for (index = 0u; index < src->capacity; ++index)
+    {
+        const cfsm_HitCell * from = &src->cells[index];
+
+        if (0u != from->hits)
+        {
+            cfsm_HitCell * to = hits_lookup(dst, from->state, from->eventId);
+
+            if ((cfsm_HitCell *)0 == to)
+            {
+                dst->dropped += from->hits;
+            }
+            else
+            {
+                to->hits      += from->hits;
+                to->unhandled += from->unhandled;
+            }
+        }
+    }
+
+    dst->dropped += src->dropped;
+}
+
+void cfsm_hits_writeCsv(
+    const cfsm_Hits * hits,
+    FILE * out,
+    cfsm_HitsStateName stateName,
+    cfsm_HitsEventName eventName)
+{
+    size_t index;
+
+    fprintf(out, "state,event,hits,unhandled\n");
+
+    for (index = 0u; index < hits->capacity; ++index)
+    {
+        const cfsm_HitCell * cell = &hits->cells[index];
+        const char * name = (const char *)0;
+
+        if (0u == cell->hits)
+        {
+            continue;
+        }
+
+        hits_writeState(out, stateName, cell->state);
+
+        if ((cfsm_HitsEventName)0 != eventName)
+        {
+            name = eventName((int)cell->eventId);
+        }
+        if ((const char *)0 != name)
+        {
+            fprintf(out, ",%s", name);
+        }
+        else
+        {
+            fprintf(out, ",%ld", (long)cell->eventId);
+        }
+
+        fprintf(out, ",%llu,%llu\n",
+            (unsigned long long)cell->hits,
+            (unsigned long long)cell->unhandled);
+    }
+}
+
+/******************************************************************************
+ * Local functions
+ *****************************************************************************/
+
+/**
+ * @brief Find or claim the cell of a (state, event ID) pair.
+ *
+ * @param hits The hit matrix.
+ * @param state The state.
+ * @param eventId The event ID.
+ * @return The cell or NULL if the pair is new and the matrix is full.
+ */
+static cfsm_HitCell * hits_lookup(
+    cfsm_Hits * hits,
+    cfsm_TransitionFunction state,
+    int eventId)
+{
+    size_t mask = hits->capacity - 1u;
+    size_t index;
+    size_t probes;
+
+    index = hits_hash(state, eventId) & mask;
+
+    for (probes = 0u; probes < hits->capacity; ++probes)
+    {
+        cfsm_HitCell * cell = &hits->cells[index];
+
+        if (0u == cell->hits)
+        {
+            /* Keep a quarter free so probe sequences stay short. */
+            if ((hits->used + 1u) * 4u > hits->capacity * 3u)
+            {
+                break;
+            }
+            ++hits->used;
+            cell->state   = state;
+            cell->eventId = (int32_t)eventId;
+            return cell;
+        }
+        if ((cell->state == state) && (cell->eventId == (int32_t)eventId))
+        {
+            return cell;
+        }
+        index = (index + 1u) & mask;
+    }
+
+    return (cfsm_HitCell *)0;
+}
+
+/**
+ * @brief Hash a (state, event ID) pair.
+ *
+ * @param state The state.
+ * @param eventId The event ID.
+ * @return The hash value.
+ */
+static size_t hits_hash(cfsm_TransitionFunction state, int eventId)
+{
+    uint32_t key = (uint32_t)((uintptr_t)state >> 2) ^
+        ((uint32_t)eventId * 0x9E3779B1u);
+
+    /* Multiplicative mixing, the low bits select the cell. */
+    key ^= key >> 16;
+    key *= 0x85EBCA6Bu;
+    key ^= key >> 13;
+
+    return (size_t)key;
+}
+
+/**
+ * @brief Write the state column of a CSV row.
+ *
+ * The stopped state is written as [*], like in PlantUML diagrams.
+ *
+ * @param out The stream to write to.
+ * @param stateName State name function or NULL.
+ * @param state The state.
+ */
+static void hits_writeState(
+    FILE * out,
+    cfsm_HitsStateName stateName,
+    cfsm_TransitionFunction state)
+{
+    const char * name = (const char *)0;
+
+    if ((cfsm_TransitionFunction)0 == state)
+    {
+        name = "[*]";
+    }
+    else if ((cfsm_HitsStateName)0 != stateName)
+    {
+        name = stateName(state);
+    }
+
+    if ((const char *)0 != name)
+    {
+        fprintf(out, "%s", name);
+    }
+    else
+    {
+        fprintf(out, "0x%llx", (unsigned long long)(uintptr_t)state);
+    }
+}
+
+#endif /* CFSM_ENABLE_HITS */
@@ -0,0 +1,187 @@
+/* MIT License
+ *
+ * Copyright (C) 2024  Haju Schulz <haju@schulznorbert.de>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*******************************************************************************
+    DESCRIPTION
+*******************************************************************************/
+/**
+ * @brief  CFSM event hit matrix header file
+ *
+ * The hit matrix counts which (active state, event ID) pairs occur and how
+ * many of those events found no event handler. It shows which transitions
+ * are worth optimizing and which diagram paths are never taken. Counting
+ * is compiled into the CFSM event functions only if CFSM_ENABLE_HITS is
+ * defined for the library and the application.
+ *
+ * The matrix is sparse. Cells are kept in an open addressing hash table
+ * of application provided storage. Each thread attaches a matrix of its
+ * own, so counting needs no locks or atomics. For reading, the per thread
+ * matrices are merged with cfsm_hits_merge().
+ *
+ * Repository: https://github.com/nhjschulz/cfsm
+ *
+ * @addtogroup CFSM
+ *
+ * @{
+ */
+
+/* Outside of the include guard, as the header only c_fsm.h includes this
+ * file before its implementation.
+ */
+#include "c_fsm.h"
+
+#ifndef SRC_C_FSM_C_FSM_HITS_H_
+#define SRC_C_FSM_C_FSM_HITS_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/******************************************************************************
+ * Includes
+ *****************************************************************************/
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+/******************************************************************************
+ * Macros
+ *****************************************************************************/
+
+/******************************************************************************
+ * Types and Classes
+ *****************************************************************************/
+
+/** Counts of one (state, event ID) pair
+ */
+typedef struct cfsm_HitCell {
+    cfsm_TransitionFunction state;     /**< Active state, NULL if stopped */
+    int32_t                 eventId;   /**< Event ID                      */
+    uint64_t                hits;      /**< Events, 0 marks unused cells  */
+    uint64_t                unhandled; /**< Events without event handler  */
+} cfsm_HitCell;
+
+/** The CFSM hit matrix data structure
+ */
+typedef struct cfsm_Hits {
+    cfsm_HitCell * cells;    /**< Application provided cell storage  */
+    size_t         capacity; /**< Number of cells, a power of two    */
+    size_t         used;     /**< Cells in use                       */
+    uint64_t       dropped;  /**< Events of pairs beyond capacity    */
+} cfsm_Hits;
+
+/** State name function, like the generated <prefix>_stateName(). */
+typedef const char * (*cfsm_HitsStateName)(cfsm_TransitionFunction state);
+
+/** Event name function, like the generated <prefix>_eventName(). */
+typedef const char * (*cfsm_HitsEventName)(int eventId);
+
+/******************************************************************************
+ * Functions
+ *****************************************************************************/
+
+/**
+ * @brief Initialize a hit matrix.
+ *
+ * The table is kept at most 3/4 full, events of further pairs are
+ * counted as dropped.
+ *
+ * @param hits The hit matrix to initialize.
+ * @param cells Cell storage.
+ * @param capacity Number of cells, rounded down to a power of two.
+ * @since 0.4.0
+ */
+void cfsm_hits_init(cfsm_Hits * hits, cfsm_HitCell * cells, size_t capacity);
+
+/**
+ * @brief Make a hit matrix the target of all CFSM events of the calling
+ *        thread.
+ *
+ * @param hits The hit matrix to count into or NULL to stop counting.
+ * @since 0.4.0
+ */
+void cfsm_hits_attach(cfsm_Hits * hits);
+
+/**
+ * @brief Count an event in the hit matrix of the calling thread.
+ *
+ * Used by the CFSM counting hooks.
+ *
+ * @param state The active state.
+ * @param eventId The event ID.
+ * @param handled 0 if the state has no handler for the event.
+ * @since 0.4.0
+ */
+void cfsm_hits_record(cfsm_TransitionFunction state, int eventId, int handled);
+
+/**
+ * @brief Look up the counts of a (state, event ID) pair.
+ *
+ * @param hits The hit matrix.
+ * @param state The state.
+ * @param eventId The event ID.
+ * @return The cell or NULL if the pair never occurred.
+ * @since 0.4.0
+ */
+const cfsm_HitCell * cfsm_hits_find(
+    const cfsm_Hits * hits,
+    cfsm_TransitionFunction state,
+    int eventId);
+
+/**
+ * @brief Add all counts of a hit matrix to another one.
+ *
+ * Merging a matrix that another thread still counts into is possible,
+ * but the result may miss that thread's latest events.
+ *
+ * @param dst The hit matrix to add to.
+ * @param src The hit matrix to add.
+ * @since 0.4.0
+ */
+void cfsm_hits_merge(cfsm_Hits * dst, const cfsm_Hits * src);
+
+/**
+ * @brief Write all used cells as CSV.
+ *
+ * Columns are state, event, hits and unhandled. The CSV feeds
+ * tools/cfsm_puml_hits.py, which annotates the PlantUML diagram.
+ *
+ * @param hits The hit matrix.
+ * @param out The stream to write to.
+ * @param stateName State name function or NULL to write addresses.
+ * @param eventName Event name function or NULL to write IDs.
+ * @since 0.4.0
+ */
+void cfsm_hits_writeCsv(
+    const cfsm_Hits * hits,
+    FILE * out,
+    cfsm_HitsStateName stateName,
+    cfsm_HitsEventName eventName);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SRC_C_FSM_C_FSM_HITS_H_ */
+
+/** @} */
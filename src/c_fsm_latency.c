@@ -0,0 +1,347 @@
+/* MIT License
+ *
+ * Copyright (C) 2024  Haju Schulz <haju@schulznorbert.de>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+/*******************************************************************************
+    DESCRIPTION
+*******************************************************************************/
+
+/**
+ * @brief  CFSM event latency implementation
+ *
+ * This file contains the implementation for recording event latencies
+ * in HDR style histograms.
+ *
+ * Repository: https://github.com/nhjschulz/cfsm
+ *
+ */
+
+/******************************************************************************
+ * Includes
+ *****************************************************************************/
+#include <string.h>
+
+#include "c_fsm_latency.h"
+
+/******************************************************************************
+ * Macros
+ *****************************************************************************/
+
+#define LATENCY_SUB_COUNT (1u << CFSM_HISTOGRAM_SUB_BITS) /**< Buckets per octave */
+
+/******************************************************************************
+ * Types and Classes
+ *****************************************************************************/
+
+/******************************************************************************
+ * Prototypes
+ *****************************************************************************/
+
+static size_t latency_bucketOf(uint32_t value);
+static uint32_t latency_highestValueOf(size_t bucket);
+static unsigned int latency_highestBit(uint32_t value);
+
+/******************************************************************************
+ * Variables
+ *****************************************************************************/
+
+/******************************************************************************
+ * External functions
+ *****************************************************************************/
+
+void cfsm_histogram_reset(cfsm_Histogram * histogram)
+{
+    memset(histogram, 0, sizeof(*histogram));
+}
+
+void cfsm_histogram_record(cfsm_Histogram * histogram, uint32_t value)
+{
+    histogram->buckets[latency_bucketOf(value)]++;
+    histogram->count++;
+    histogram->sum += value;
+
+    if (value > histogram->max)
+    {
+        histogram->max = value;
+    }
+}
+
+void cfsm_histogram_merge(cfsm_Histogram * dst, const cfsm_Histogram * src)
+{
+    if (0u == src->count)
+    {
+        return;
+    }
+
+    for (size_t i = 0u; i < (size_t)CFSM_HISTOGRAM_BUCKETS; ++i)
+    {
+        dst->buckets[i] += src->buckets[i];
+    }
+
+    dst->count += src->count;
+    dst->sum   += src->sum;
+
+    if (src->max > dst->max)
+    {
+        dst->max = src->max;
+    }
+}
+
+uint32_t cfsm_histogram_percentile(const cfsm_Histogram * histogram, double percent)
+{
+    double target = ((double)histogram->count * percent) / 100.0;
+    uint32_t rank = (uint32_t)target;
+    uint32_t seen = 0u;
+
+    if (0u == histogram->count)
+    {
+        return 0u;
+    }
+
+    /* Rank of the percentile value, rounded up and 1 based. */
+    if ((double)rank < target)
+    {
+        ++rank;
+    }
+    if (0u == rank)
+    {
+        rank = 1u;
+    }
+    if (rank > histogram->count)
+    {
+        rank = histogram->count;
+    }
+
+    for (size_t i = 0u; i < (size_t)CFSM_HISTOGRAM_BUCKETS; ++i)
+    {
+        seen += histogram->buckets[i];
+        if (seen >= rank)
+        {
+            uint32_t value = latency_highestValueOf(i);
+
+            return (value < histogram->max) ? value : histogram->max;
+        }
+    }
+
+    return histogram->max;
+}
+
+void cfsm_latency_init(
+    cfsm_Latency * latency,
+    cfsm_Histogram * histograms,
+    size_t groups,
+    size_t events,
+    cfsm_LatencyClock clock)
+{
+    latency->histograms = histograms;
+    latency->groups     = groups;
+    latency->events     = events;
+    latency->dropped    = 0u;
+    latency->clock      = clock;
+
+    memset(histograms, 0, CFSM_LATENCY_HISTOGRAMS(groups, events) * sizeof(*histograms));
+}
+
+cfsm_Histogram * cfsm_latency_get(
+    const cfsm_Latency * latency,
+    size_t group,
+    int eventId,
+    cfsm_LatencyKind kind)
+{
+    if ((group >= latency->groups) ||
+        (eventId < 0) ||
+        ((size_t)eventId >= latency->events))
+    {
+        return (cfsm_Histogram *)0;
+    }
+
+    return &latency->histograms[
+        (((group * latency->events) + (size_t)eventId) * (size_t)CFSM_LATENCY_KINDS) +
+        (size_t)kind];
+}
+
+void cfsm_latency_record(
+    cfsm_Latency * latency,
+    size_t group,
+    int eventId,
+    uint32_t enqueued,
+    uint32_t dispatched,
+    uint32_t returned)
+{
+    cfsm_Histogram * wait = cfsm_latency_get(latency, group, eventId, CFSM_LATENCY_WAIT);
+
+    if ((cfsm_Histogram *)0 == wait)
+    {
+        latency->dropped++;
+        return;
+    }
+
+    /* The handle histogram directly follows the wait histogram. */
+    cfsm_histogram_record(wait, dispatched - enqueued);
+    cfsm_histogram_record(wait + 1, returned - dispatched);
+}
+
+void cfsm_latency_event(
+    cfsm_Latency * latency,
+    size_t group,
+    struct cfsm_Ctx * fsm,
+    int eventId,
+    uint32_t enqueued)
+{
+    uint32_t dispatched = latency->clock();
+
+    cfsm_event(fsm, eventId);
+
+    cfsm_latency_record(latency, group, eventId, enqueued, dispatched, latency->clock());
+}
+
+void cfsm_latency_merge(cfsm_Latency * dst, const cfsm_Latency * src)
+{
+    size_t count = CFSM_LATENCY_HISTOGRAMS(src->groups, src->events);
+
+    if ((dst->groups != src->groups) || (dst->events != src->events))
+    {
+        return;
+    }
+
+    for (size_t i = 0u; i < count; ++i)
+    {
+        cfsm_histogram_merge(&dst->histograms[i], &src->histograms[i]);
+    }
+
+    dst->dropped += src->dropped;
+}
+
+void cfsm_latency_report(const cfsm_Latency * latency, FILE * out)
+{
+    static const char * const kindNames[CFSM_LATENCY_KINDS] = {
+        "wait", "handle"
+    };
+
+    fprintf(out, "%5s %5s %-6s %10s %10s %10s %10s %10s\n",
+        "group", "event", "kind", "count", "p50", "p99", "p99.9", "max");
+
+    for (size_t group = 0u; group < latency->groups; ++group)
+    {
+        for (size_t event = 0u; event < latency->events; ++event)
+        {
+            for (unsigned int kind = 0u; kind < (unsigned int)CFSM_LATENCY_KINDS; ++kind)
+            {
+                const cfsm_Histogram * histogram = cfsm_latency_get(
+                    latency, group, (int)event, (cfsm_LatencyKind)kind);
+
+                if (0u != histogram->count)
+                {
+                    fprintf(out, "%5lu %5lu %-6s %10lu %10lu %10lu %10lu %10lu\n",
+                        (unsigned long)group,
+                        (unsigned long)event,
+                        kindNames[kind],
+                        (unsigned long)histogram->count,
+                        (unsigned long)cfsm_histogram_percentile(histogram, 50.0),
+                        (unsigned long)cfsm_histogram_percentile(histogram, 99.0),
+                        (unsigned long)cfsm_histogram_percentile(histogram, 99.9),
+                        (unsigned long)histogram->max);
+                }
+            }
+        }
+    }
+
+    if (0u != latency->dropped)
+    {
+        fprintf(out, "%lu records dropped, group or event ID out of range\n",
+            (unsigned long)latency->dropped);
+    }
+}
+
+/******************************************************************************
+ * Local functions
+ *****************************************************************************/
+
+/**
+ * @brief Get the histogram bucket of a value.
+ *
+ * Values below 2 * LATENCY_SUB_COUNT have a bucket each. Above, the
+ * bucket is given by the highest bit and the LATENCY_SUB_COUNT values
+ * below it.
+ *
+ * @param value The value.
+ * @return The bucket index.
+ */
+static size_t latency_bucketOf(uint32_t value)
+{
+    unsigned int shift;
+
+    if (value < (2u * LATENCY_SUB_COUNT))
+    {
+        return (size_t)value;
+    }
+
+    shift = latency_highestBit(value) - (unsigned int)CFSM_HISTOGRAM_SUB_BITS;
+
+    return ((size_t)shift << CFSM_HISTOGRAM_SUB_BITS) + (size_t)(value >> shift);
+}
+
+/**
+ * @brief Get the highest value of a histogram bucket.
+ *
+ * @param bucket The bucket index.
+ * @return The highest value that is recorded in the bucket.
+ */
+static uint32_t latency_highestValueOf(size_t bucket)
+{
+    unsigned int shift;
+    uint32_t lowest;
+
+    if (bucket < (2u * LATENCY_SUB_COUNT))
+    {
+        return (uint32_t)bucket;
+    }
+
+    shift  = (unsigned int)(bucket >> CFSM_HISTOGRAM_SUB_BITS) - 1u;
+    lowest = (uint32_t)(bucket - ((size_t)shift << CFSM_HISTOGRAM_SUB_BITS)) << shift;
+
+    return lowest + (((uint32_t)1u << shift) - 1u);
+}
+
+/**
+ * @brief Get the position of the highest set bit.
+ *
+ * @param value A non zero value.
+ * @return The bit position.
+ */
+static unsigned int latency_highestBit(uint32_t value)
+{
+#if defined(__GNUC__)
+    return (unsigned int)((sizeof(unsigned long) * 8u) - 1u) -
+        (unsigned int)__builtin_clzl((unsigned long)value);
+#else
+    unsigned int position = 0u;
+
+    while (0u != (value >>= 1))
+    {
+        ++position;
+    }
+
+    return position;
+#endif
+}
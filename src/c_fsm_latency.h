@@ -0,0 +1,266 @@
+/* MIT License
+ *
+ * Copyright (C) 2024  Haju Schulz <haju@schulznorbert.de>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*******************************************************************************
+    DESCRIPTION
+*******************************************************************************/
+/**
+ * @brief  CFSM event latency header file
+ *
+ * Latency histograms record how long queued events waited between being
+ * produced and being dispatched (wait) and how long the state took to
+ * handle them (handle). There is one histogram pair per application
+ * defined FSM group and event ID.
+ *
+ * The histograms use HDR style log linear buckets. Each power of two
+ * range is split into 2^CFSM_HISTOGRAM_SUB_BITS buckets, which bounds the
+ * relative error of reported values while recording stays a few
+ * instructions. Values are 32 bit application clock ticks.
+ *
+ * A cfsm_Latency is not thread safe. Multi threaded applications give
+ * each thread a shard of its own, which needs no locks or atomics, and
+ * merge the shards with cfsm_latency_merge() for reporting.
+ *
+ * Repository: https://github.com/nhjschulz/cfsm
+ *
+ * @addtogroup CFSM
+ *
+ * @{
+ */
+
+#ifndef SRC_C_FSM_C_FSM_LATENCY_H_
+#define SRC_C_FSM_C_FSM_LATENCY_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/******************************************************************************
+ * Includes
+ *****************************************************************************/
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "c_fsm.h"
+
+/******************************************************************************
+ * Macros
+ *****************************************************************************/
+
+#ifndef CFSM_HISTOGRAM_SUB_BITS
+/** Buckets per power of two as bits, 5 gives a relative error below 3.2%. */
+#define CFSM_HISTOGRAM_SUB_BITS 5
+#endif
+
+/** Number of buckets needed to cover 32 bit values. */
+#define CFSM_HISTOGRAM_BUCKETS \
+    ((33 - CFSM_HISTOGRAM_SUB_BITS) << CFSM_HISTOGRAM_SUB_BITS)
+
+/** Number of histograms for the given number of groups and event IDs. */
+#define CFSM_LATENCY_HISTOGRAMS(groups, events) \
+    ((groups) * (events) * (size_t)CFSM_LATENCY_KINDS)
+
+/******************************************************************************
+ * Types and Classes
+ *****************************************************************************/
+
+/** HDR style histogram of 32 bit values
+ */
+typedef struct cfsm_Histogram {
+    uint32_t count;                           /**< Number of values     */
+    uint32_t max;                             /**< Largest value        */
+    uint64_t sum;                             /**< Sum of all values    */
+    uint32_t buckets[CFSM_HISTOGRAM_BUCKETS]; /**< Values per bucket    */
+} cfsm_Histogram;
+
+/** Recorded latencies of an event */
+typedef enum cfsm_LatencyKind {
+    CFSM_LATENCY_WAIT = 0,  /**< Enqueue to dispatch            */
+    CFSM_LATENCY_HANDLE,    /**< Dispatch to return of handler  */
+    CFSM_LATENCY_KINDS      /**< Number of recorded latencies   */
+} cfsm_LatencyKind;
+
+/** Latency clock function returning application clock ticks. */
+typedef uint32_t (*cfsm_LatencyClock)(void);
+
+/** Latency histograms of one thread
+ */
+typedef struct cfsm_Latency {
+    cfsm_Histogram *  histograms; /**< Application provided histograms   */
+    size_t            groups;     /**< Number of FSM groups              */
+    size_t            events;     /**< Number of event IDs per group     */
+    uint32_t          dropped;    /**< Records outside groups or events  */
+    cfsm_LatencyClock clock;      /**< Time source of cfsm_latency_event */
+} cfsm_Latency;
+
+/******************************************************************************
+ * Functions
+ *****************************************************************************/
+
+/**
+ * @brief Clear a histogram.
+ *
+ * @param histogram The histogram to clear.
+ * @since 0.4.0
+ */
+void cfsm_histogram_reset(cfsm_Histogram * histogram);
+
+/**
+ * @brief Add a value to a histogram.
+ *
+ * @param histogram The histogram.
+ * @param value The value to add.
+ * @since 0.4.0
+ */
+void cfsm_histogram_record(cfsm_Histogram * histogram, uint32_t value);
+
+/**
+ * @brief Add all values of a histogram to another one.
+ *
+ * @param dst The histogram to add to.
+ * @param src The histogram to add.
+ * @since 0.4.0
+ */
+void cfsm_histogram_merge(cfsm_Histogram * dst, const cfsm_Histogram * src);
+
+/**
+ * @brief Get a percentile of the recorded values.
+ *
+ * @param histogram The histogram.
+ * @param percent The percentile, like 50.0, 99.0 or 99.9.
+ * @return The highest value of the bucket containing the percentile,
+ *         limited to the largest recorded value. 0 if the histogram
+ *         is empty.
+ * @since 0.4.0
+ */
+uint32_t cfsm_histogram_percentile(const cfsm_Histogram * histogram, double percent);
+
+/**
+ * @brief Initialize a latency shard.
+ *
+ * Histograms are stored by group, then event ID, then cfsm_LatencyKind.
+ *
+ * @param latency The latency data structure to initialize.
+ * @param histograms Storage for CFSM_LATENCY_HISTOGRAMS(groups, events)
+ *                   histograms.
+ * @param groups Number of FSM groups.
+ * @param events Number of event IDs, valid IDs are 0 to events - 1.
+ * @param clock Time source used by cfsm_latency_event() (may be NULL if
+ *              only cfsm_latency_record() is used).
+ * @since 0.4.0
+ */
+void cfsm_latency_init(
+    cfsm_Latency * latency,
+    cfsm_Histogram * histograms,
+    size_t groups,
+    size_t events,
+    cfsm_LatencyClock clock);
+
+/**
+ * @brief Get a histogram of a latency shard.
+ *
+ * @param latency The latency data structure.
+ * @param group The FSM group.
+ * @param eventId The event ID.
+ * @param kind The recorded latency.
+ * @return The histogram or NULL if group or eventId is out of range.
+ * @since 0.4.0
+ */
+cfsm_Histogram * cfsm_latency_get(
+    const cfsm_Latency * latency,
+    size_t group,
+    int eventId,
+    cfsm_LatencyKind kind);
+
+/**
+ * @brief Record the latencies of a dispatched event.
+ *
+ * For applications that dispatch queued events themselves, for example
+ * through cfsm_fleet_post(). Clock differences are computed modulo 2^32,
+ * so the clock may wrap around.
+ *
+ * @param latency The latency data structure.
+ * @param group The FSM group of the receiving instance.
+ * @param eventId The event ID.
+ * @param enqueued Clock ticks when the event was queued.
+ * @param dispatched Clock ticks when dispatch started.
+ * @param returned Clock ticks when the handler returned.
+ * @since 0.4.0
+ */
+void cfsm_latency_record(
+    cfsm_Latency * latency,
+    size_t group,
+    int eventId,
+    uint32_t enqueued,
+    uint32_t dispatched,
+    uint32_t returned);
+
+/**
+ * @brief Dispatch a queued event and record its latencies.
+ *
+ * Same as cfsm_event(), with the clock read before and after the call.
+ *
+ * @param latency The latency data structure.
+ * @param group The FSM group of fsm.
+ * @param fsm The fsm data structure.
+ * @param eventId An application defined ID to identify the event.
+ * @param enqueued Clock ticks when the event was queued.
+ * @since 0.4.0
+ */
+void cfsm_latency_event(
+    cfsm_Latency * latency,
+    size_t group,
+    struct cfsm_Ctx * fsm,
+    int eventId,
+    uint32_t enqueued);
+
+/**
+ * @brief Add all histograms of a shard to another one.
+ *
+ * Both shards must have the same number of groups and events. Merging a
+ * shard that another thread still records into is possible, but the
+ * result may miss that thread's latest records.
+ *
+ * @param dst The shard to add to.
+ * @param src The shard to add.
+ * @since 0.4.0
+ */
+void cfsm_latency_merge(cfsm_Latency * dst, const cfsm_Latency * src);
+
+/**
+ * @brief Write count, p50, p99, p99.9 and max of all used histograms.
+ *
+ * @param latency The latency data structure.
+ * @param out The stream to write to.
+ * @since 0.4.0
+ */
+void cfsm_latency_report(const cfsm_Latency * latency, FILE * out);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SRC_C_FSM_C_FSM_LATENCY_H_ */
+
+/** @} */
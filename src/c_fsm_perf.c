@@ -0,0 +1,460 @@
+/* MIT License
+ *
+ * Copyright (C) 2024  Haju Schulz <haju@schulznorbert.de>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+/*******************************************************************************
+    DESCRIPTION
+*******************************************************************************/
+
+/**
+ * @brief  CFSM hardware performance counter implementation
+ *
+ * This file contains the implementation for attributing hardware
+ * performance counters to cfsm states. Counters are only opened on
+ * Linux, other systems report them as unavailable.
+ *
+ * Repository: https://github.com/nhjschulz/cfsm
+ *
+ */
+
+/******************************************************************************
+ * Includes
+ *****************************************************************************/
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE  /* syscall() in strict C99 */
+#endif
+
+#include "c_fsm.h"
+
+/* Counters tell states apart by cfsm_Ctx::state. */
+#if defined(CFSM_ENABLE_STATE_ID)
+
+#include <string.h>
+
+#include "c_fsm_perf.h"
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+/******************************************************************************
+ * Macros
+ *****************************************************************************/
+
+#if defined(__linux__) && defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define PERF_HAS_RDPMC 1  /**< Counters may be read in user space */
+#else
+#define PERF_HAS_RDPMC 0  /**< Counters are read by system call   */
+#endif
+
+/******************************************************************************
+ * Types and Classes
+ *****************************************************************************/
+
+/******************************************************************************
+ * Prototypes
+ *****************************************************************************/
+
+static uint64_t perf_readCounter(const cfsm_Perf * perf, unsigned int counter);
+static cfsm_PerfState * perf_find(cfsm_Perf * perf, cfsm_TransitionFunction state);
+static void perf_account(
+    cfsm_Perf * perf,
+    cfsm_TransitionFunction state,
+    const uint64_t * before,
+    const uint64_t * after);
+static void perf_printPerCall(
+    FILE * out,
+    const cfsm_Perf * perf,
+    const cfsm_PerfState * state,
+    unsigned int counter);
+
+#if PERF_HAS_RDPMC
+static int perf_readPage(const void * page, uint64_t * value);
+#endif
+
+/******************************************************************************
+ * Variables
+ *****************************************************************************/
+
+/******************************************************************************
+ * External functions
+ *****************************************************************************/
+
+unsigned int cfsm_perf_open(cfsm_Perf * perf, cfsm_PerfState * states, size_t capacity)
+{
+#if defined(__linux__)
+    static const uint64_t configs[CFSM_PERF_COUNTERS] = {
+        PERF_COUNT_HW_CPU_CYCLES,
+        PERF_COUNT_HW_INSTRUCTIONS,
+        PERF_COUNT_HW_BRANCH_MISSES,
+        PERF_COUNT_HW_CACHE_MISSES
+    };
+#endif
+
+    perf->states    = states;
+    perf->capacity  = capacity;
+    perf->count     = 0u;
+    perf->dropped   = 0u;
+    perf->available = 0u;
+
+    memset(states, 0, capacity * sizeof(*states));
+
+    for (unsigned int i = 0u; i < (unsigned int)CFSM_PERF_COUNTERS; ++i)
+    {
+        perf->fds[i]   = -1;
+        perf->pages[i] = (void *)0;
+
+#if defined(__linux__)
+        {
+            struct perf_event_attr attr;
+
+            memset(&attr, 0, sizeof(attr));
+            attr.type           = PERF_TYPE_HARDWARE;
+            attr.size           = sizeof(attr);
+            attr.config         = configs[i];
+            attr.exclude_kernel = 1;
+            attr.exclude_hv     = 1;
+
+            /* Calling thread on any CPU. Fails without PMU or permission. */
+            perf->fds[i] = (int)syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+            if (perf->fds[i] < 0)
+            {
+                perf->fds[i] = -1;
+                continue;
+            }
+
+            perf->available |= 1u << i;
+
+#if PERF_HAS_RDPMC
+            perf->pages[i] = mmap((void *)0, (size_t)sysconf(_SC_PAGESIZE),
+                PROT_READ, MAP_SHARED, perf->fds[i], 0);
+            if (MAP_FAILED == perf->pages[i])
+            {
+                perf->pages[i] = (void *)0;
+            }
+#endif
+        }
+#endif
+    }
+
+    return perf->available;
+}
+
+void cfsm_perf_close(cfsm_Perf * perf)
+{
+    for (unsigned int i = 0u; i < (unsigned int)CFSM_PERF_COUNTERS; ++i)
+    {
+#if defined(__linux__)
+        if ((void *)0 != perf->pages[i])
+        {
+            (void)munmap(perf->pages[i], (size_t)sysconf(_SC_PAGESIZE));
+        }
+        if (0 <= perf->fds[i])
+        {
+            (void)close(perf->fds[i]);
+        }
+#endif
+        perf->pages[i] = (void *)0;
+        perf->fds[i]   = -1;
+    }
+
+    perf->available = 0u;
+}
+
+void cfsm_perf_read(const cfsm_Perf * perf, uint64_t values[CFSM_PERF_COUNTERS])
+{
+    for (unsigned int i = 0u; i < (unsigned int)CFSM_PERF_COUNTERS; ++i)
+    {
+        values[i] = (0u != (perf->available & (1u << i))) ? perf_readCounter(perf, i) : 0u;
+    }
+}
+
+void cfsm_perf_name(cfsm_Perf * perf, cfsm_TransitionFunction state, const char * name)
+{
+    cfsm_PerfState * entry = perf_find(perf, state);
+
+    if ((cfsm_PerfState *)0 != entry)
+    {
+        entry->name = name;
+    }
+}
+
+void cfsm_perf_process(cfsm_Perf * perf, struct cfsm_Ctx * fsm)
+{
+    cfsm_TransitionFunction state = fsm->state;
+    uint64_t before[CFSM_PERF_COUNTERS];
+    uint64_t after[CFSM_PERF_COUNTERS];
+
+    cfsm_perf_read(perf, before);
+    cfsm_process(fsm);
+    cfsm_perf_read(perf, after);
+
+    perf_account(perf, state, before, after);
+}
+
+void cfsm_perf_event(cfsm_Perf * perf, struct cfsm_Ctx * fsm, int eventId)
+{
+    cfsm_TransitionFunction state = fsm->state;
+    uint64_t before[CFSM_PERF_COUNTERS];
+    uint64_t after[CFSM_PERF_COUNTERS];
+
+    cfsm_perf_read(perf, before);
+    cfsm_event(fsm, eventId);
+    cfsm_perf_read(perf, after);
+
+    perf_account(perf, state, before, after);
+}
+
+void cfsm_perf_report(const cfsm_Perf * perf, FILE * out)
+{
+    fprintf(out, "%-24s %10s %12s %12s %6s %12s %12s\n",
+        "state", "calls", "cycles/call", "instr/call", "IPC",
+        "brmiss/call", "llcmiss/call");
+
+    for (size_t i = 0u; i < perf->count; ++i)
+    {
+        const cfsm_PerfState * state = &perf->states[i];
+        const unsigned int ipcMask =
+            (1u << CFSM_PERF_CYCLES) | (1u << CFSM_PERF_INSTRUCTIONS);
+
+        fprintf(out, "%-24s %10lu",
+            (const char *)0 != state->name ? state->name : "?",
+            (unsigned long)state->calls);
+
+        perf_printPerCall(out, perf, state, CFSM_PERF_CYCLES);
+        perf_printPerCall(out, perf, state, CFSM_PERF_INSTRUCTIONS);
+
+        if ((ipcMask == (perf->available & ipcMask)) && (0u != state->counts[CFSM_PERF_CYCLES]))
+        {
+            fprintf(out, " %6.2f",
+                (double)state->counts[CFSM_PERF_INSTRUCTIONS] /
+                (double)state->counts[CFSM_PERF_CYCLES]);
+        }
+        else
+        {
+            fprintf(out, " %6s", "n/a");
+        }
+
+        perf_printPerCall(out, perf, state, CFSM_PERF_BRANCH_MISSES);
+        perf_printPerCall(out, perf, state, CFSM_PERF_CACHE_MISSES);
+        fprintf(out, "\n");
+    }
+
+    if (0u == perf->available)
+    {
+        fprintf(out, "no hardware counters available\n");
+    }
+
+    if (0u != perf->dropped)
+    {
+        fprintf(out, "%lu calls dropped, state table full\n",
+            (unsigned long)perf->dropped);
+    }
+}
+
+/******************************************************************************
+ * Local functions
+ *****************************************************************************/
+
+/**
+ * @brief Read an available counter.
+ *
+ * @param perf The perf data structure.
+ * @param counter The counter.
+ * @return The counter value.
+ */
+static uint64_t perf_readCounter(const cfsm_Perf * perf, unsigned int counter)
+{
+    uint64_t value = 0u;
+
+#if PERF_HAS_RDPMC
+    if (((void *)0 != perf->pages[counter]) && perf_readPage(perf->pages[counter], &value))
+    {
+        return value;
+    }
+#endif
+
+#if defined(__linux__)
+    if ((ssize_t)sizeof(value) != read(perf->fds[counter], &value, sizeof(value)))
+    {
+        value = 0u;
+    }
+#else
+    (void)perf;
+    (void)counter;
+#endif
+
+    return value;
+}
+
+#if PERF_HAS_RDPMC
+/**
+ * @brief Read a counter in user space with rdpmc.
+ *
+ * Follows the protocol of struct perf_event_mmap_page. The kernel may
+ * update the page at any time, which is detected by its lock sequence.
+ *
+ * @param page The mapped counter page.
+ * @param value Receives the counter value.
+ * @return 1 on success, 0 if the kernel does not allow rdpmc or reports
+ *         no counter width.
+ */
+static int perf_readPage(const void * page, uint64_t * value)
+{
+    const volatile struct perf_event_mmap_page * pc =
+        (const volatile struct perf_event_mmap_page *)page;
+    uint32_t sequence;
+    uint64_t count;
+
+    do
+    {
+        uint32_t index;
+        unsigned int width;
+
+        sequence = pc->lock;
+        __asm__ volatile ("" ::: "memory");
+
+        /* Without a valid width the sign extension below is undefined,
+         * the counter is read by read() then.
+         */
+        index = pc->index;
+        width = (unsigned int)pc->pmc_width;
+        if ((0u == pc->cap_user_rdpmc) || (0u == index) ||
+            (0u == width) || (64u < width))
+        {
+            return 0;
+        }
+
+        {
+            uint32_t low;
+            uint32_t high;
+            int64_t pmc;
+
+            __asm__ volatile ("rdpmc" : "=a"(low), "=d"(high) : "c"(index - 1u));
+
+            /* Sign extend the counter from its hardware width. */
+            pmc = (int64_t)(((uint64_t)high << 32) | low);
+            pmc = (int64_t)((uint64_t)pmc << (64u - width)) >> (64u - width);
+
+            count = (uint64_t)pc->offset + (uint64_t)pmc;
+        }
+
+        __asm__ volatile ("" ::: "memory");
+    }
+    while (pc->lock != sequence);
+
+    *value = count;
+
+    return 1;
+}
+#endif
+
+/**
+ * @brief Find or add the counter data of a state.
+ *
+ * @param perf The perf data structure.
+ * @param state The state identity.
+ * @return The state data or NULL if the state table is full.
+ */
+static cfsm_PerfState * perf_find(cfsm_Perf * perf, cfsm_TransitionFunction state)
+{
+    for (size_t i = 0u; i < perf->count; ++i)
+    {
+        if (state == perf->states[i].state)
+        {
+            return &perf->states[i];
+        }
+    }
+
+    if (perf->count == perf->capacity)
+    {
+        perf->dropped++;
+        return (cfsm_PerfState *)0;
+    }
+
+    perf->states[perf->count].state = state;
+
+    return &perf->states[perf->count++];
+}
+
+/**
+ * @brief Add the counter differences of a handler call to a state.
+ *
+ * @param perf The perf data structure.
+ * @param state The state that ran the handler or NULL if stopped.
+ * @param before Counter values before the call.
+ * @param after Counter values after the call.
+ */
+static void perf_account(
+    cfsm_Perf * perf,
+    cfsm_TransitionFunction state,
+    const uint64_t * before,
+    const uint64_t * after)
+{
+    cfsm_PerfState * entry;
+
+    if ((cfsm_TransitionFunction)0 == state)
+    {
+        return;
+    }
+
+    entry = perf_find(perf, state);
+    if ((cfsm_PerfState *)0 != entry)
+    {
+        entry->calls++;
+
+        for (unsigned int i = 0u; i < (unsigned int)CFSM_PERF_COUNTERS; ++i)
+        {
+            entry->counts[i] += after[i] - before[i];
+        }
+    }
+}
+
+/**
+ * @brief Write the per call average of a counter as report column.
+ *
+ * @param out The stream to write to.
+ * @param perf The perf data structure.
+ * @param state The state data.
+ * @param counter The counter.
+ */
+static void perf_printPerCall(
+    FILE * out,
+    const cfsm_Perf * perf,
+    const cfsm_PerfState * state,
+    unsigned int counter)
+{
+    if ((0u != (perf->available & (1u << counter))) && (0u != state->calls))
+    {
+        fprintf(out, " %12.1f", (double)state->counts[counter] / (double)state->calls);
+    }
+    else
+    {
+        fprintf(out, " %12s", "n/a");
+    }
+}
+
+#endif /* CFSM_ENABLE_STATE_ID */
@@ -0,0 +1,197 @@
+/* MIT License
+ *
+ * Copyright (C) 2024  Haju Schulz <haju@schulznorbert.de>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*******************************************************************************
+    DESCRIPTION
+*******************************************************************************/
+/**
+ * @brief  CFSM hardware performance counter header file
+ *
+ * Attributes hardware performance counters to the states whose handlers
+ * run, to explain why a state is slow. Cycles, instructions, branch misses
+ * and cache misses are counted for the calling thread with Linux
+ * perf_event_open(). They are read with the rdpmc instruction on x86
+ * where the kernel allows it, otherwise with read().
+ *
+ * Counters that cannot be opened, for example in containers, virtual
+ * machines without PMU or on other systems than Linux, are reported as
+ * unavailable. The state handlers still run and are counted.
+ *
+ * Repository: https://github.com/nhjschulz/cfsm
+ *
+ * @addtogroup CFSM
+ *
+ * @{
+ */
+
+#ifndef SRC_C_FSM_C_FSM_PERF_H_
+#define SRC_C_FSM_C_FSM_PERF_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/******************************************************************************
+ * Includes
+ *****************************************************************************/
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "c_fsm.h"
+
+#if !defined(CFSM_ENABLE_STATE_ID)
+#error "c_fsm_perf.h requires CFSM_ENABLE_STATE_ID"
+#endif
+
+/******************************************************************************
+ * Macros
+ *****************************************************************************/
+
+/******************************************************************************
+ * Types and Classes
+ *****************************************************************************/
+
+/** Hardware performance counters */
+typedef enum cfsm_PerfCounter {
+    CFSM_PERF_CYCLES = 0,       /**< CPU cycles                 */
+    CFSM_PERF_INSTRUCTIONS,     /**< Retired instructions       */
+    CFSM_PERF_BRANCH_MISSES,    /**< Mispredicted branches      */
+    CFSM_PERF_CACHE_MISSES,     /**< Last level cache misses    */
+    CFSM_PERF_COUNTERS          /**< Number of counters         */
+} cfsm_PerfCounter;
+
+/** Counter values of one state
+ */
+typedef struct cfsm_PerfState {
+    cfsm_TransitionFunction state;  /**< State identity (enter operation) */
+    const char *  name;             /**< State name for reports or NULL   */
+    uint32_t      calls;            /**< Number of handler calls          */
+    uint64_t      counts[CFSM_PERF_COUNTERS]; /**< Counter sums           */
+} cfsm_PerfState;
+
+/** The CFSM performance counter data structure
+ */
+typedef struct cfsm_Perf {
+    cfsm_PerfState * states;     /**< Application provided state table   */
+    size_t           capacity;   /**< Number of elements in states       */
+    size_t           count;      /**< States recorded so far             */
+    uint32_t         dropped;    /**< Calls of states beyond capacity    */
+    unsigned int     available;  /**< Bit mask of opened counters        */
+    int              fds[CFSM_PERF_COUNTERS];    /**< Counter file handles */
+    void *           pages[CFSM_PERF_COUNTERS];  /**< Mapped counter pages
+                                                      for rdpmc or NULL   */
+} cfsm_Perf;
+
+/******************************************************************************
+ * Functions
+ *****************************************************************************/
+
+/**
+ * @brief Open the hardware counters for the calling thread.
+ *
+ * States are added to the table when their handlers run the first time.
+ * Calls of further states are counted as dropped once the table is full.
+ * The counters only count user space events of the calling thread, so
+ * the wrapped handlers must run in that thread.
+ *
+ * @param perf The perf data structure to initialize.
+ * @param states Storage for the per state data.
+ * @param capacity Number of elements in states.
+ * @return Bit mask of available counters, bit i for cfsm_PerfCounter i.
+ *         0 if no counter could be opened.
+ * @since 0.4.0
+ */
+unsigned int cfsm_perf_open(cfsm_Perf * perf, cfsm_PerfState * states, size_t capacity);
+
+/**
+ * @brief Close the hardware counters.
+ *
+ * Recorded data stays valid for cfsm_perf_report().
+ *
+ * @param perf The perf data structure.
+ * @since 0.4.0
+ */
+void cfsm_perf_close(cfsm_Perf * perf);
+
+/**
+ * @brief Read the current counter values.
+ *
+ * @param perf The perf data structure.
+ * @param values Receives the values, 0 for unavailable counters.
+ * @since 0.4.0
+ */
+void cfsm_perf_read(const cfsm_Perf * perf, uint64_t values[CFSM_PERF_COUNTERS]);
+
+/**
+ * @brief Set the report name of a state.
+ *
+ * @param perf The perf data structure.
+ * @param state The enter operation of the state.
+ * @param name The name, which must stay valid while perf is used.
+ * @since 0.4.0
+ */
+void cfsm_perf_name(cfsm_Perf * perf, cfsm_TransitionFunction state, const char * name);
+
+/**
+ * @brief Execute a process cycle and attribute the counters to the state.
+ *
+ * Same as cfsm_process(), with the counters read before and after.
+ *
+ * @param perf The perf data structure.
+ * @param fsm The fsm data structure.
+ * @since 0.4.0
+ */
+void cfsm_perf_process(cfsm_Perf * perf, struct cfsm_Ctx * fsm);
+
+/**
+ * @brief Signal an event and attribute the counters to the state.
+ *
+ * Same as cfsm_event(), with the counters read before and after. The
+ * counts belong to the state that handled the event, even if it
+ * transitions to another state.
+ *
+ * @param perf The perf data structure.
+ * @param fsm The fsm data structure.
+ * @param eventId An application defined ID to identify the event.
+ * @since 0.4.0
+ */
+void cfsm_perf_event(cfsm_Perf * perf, struct cfsm_Ctx * fsm, int eventId);
+
+/**
+ * @brief Write calls, counters per call, instructions per cycle and miss
+ *        rates of all states.
+ *
+ * @param perf The perf data structure.
+ * @param out The stream to write to.
+ * @since 0.4.0
+ */
+void cfsm_perf_report(const cfsm_Perf * perf, FILE * out);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SRC_C_FSM_C_FSM_PERF_H_ */
+
+/** @} */
@@ -0,0 +1,390 @@
+/* MIT License
+ *
+ * Copyright (C) 2024  Haju Schulz <haju@schulznorbert.de>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+/*******************************************************************************
+    DESCRIPTION
+*******************************************************************************/
+
+/**
+ * @brief  CFSM profiler implementation
+ *
+ * This file contains the implementation for profiling cfsm state
+ * operations. It is empty unless CFSM_ENABLE_PROFILE is defined.
+ *
+ * Repository: https://github.com/nhjschulz/cfsm
+ *
+ */
+
+/******************************************************************************
+ * Includes
+ *****************************************************************************/
+#if defined(CFSM_ENABLE_PROFILE) && !defined(_POSIX_C_SOURCE)
+#define _POSIX_C_SOURCE 199309L  /* clock_gettime() in strict C99 */
+#endif
+
+#include "c_fsm_profile.h"
+
+#if defined(CFSM_ENABLE_PROFILE)
+
+#include <string.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#elif defined(__unix__) || defined(__APPLE__)
+#include <time.h>
+#endif
+
+/******************************************************************************
+ * Macros
+ *****************************************************************************/
+
+/* Thread local storage class of the attached profile. Targets without
+ * threads fall back to a plain static variable.
+ */
+#if defined(__STDC_VERSION__) && (__STDC_VERSION__ >= 201112L) && \
+    !defined(__STDC_NO_THREADS__)
+#define PROFILE_THREAD_LOCAL _Thread_local
+#elif defined(__GNUC__) && !defined(__AVR__)
+#define PROFILE_THREAD_LOCAL __thread
+#elif defined(_MSC_VER)
+#define PROFILE_THREAD_LOCAL __declspec(thread)
+#else
+#define PROFILE_THREAD_LOCAL
+#endif
+
+/******************************************************************************
+ * Types and Classes
+ *****************************************************************************/
+
+/******************************************************************************
+ * Prototypes
+ *****************************************************************************/
+
+static cfsm_ProfileTick profile_defaultClock(void);
+static cfsm_ProfileState * profile_find(cfsm_Profile * profile, cfsm_TransitionFunction state);
+static cfsm_ProfileState * profile_at(
+    cfsm_Profile * profile,
+    cfsm_TransitionFunction state,
+    uint32_t slot);
+static unsigned int profile_bucketOf(cfsm_ProfileTick duration);
+static cfsm_ProfileTick profile_percentile(const cfsm_ProfileState * state, uint32_t rank);
+
+/******************************************************************************
+ * Variables
+ *****************************************************************************/
+
+static PROFILE_THREAD_LOCAL cfsm_Profile * activeProfile; /**< Profile of this thread */
+
+/******************************************************************************
+ * External functions
+ *****************************************************************************/
+
+void cfsm_profile_init(
+    cfsm_Profile * profile,
+    cfsm_ProfileState * states,
+    size_t capacity,
+    cfsm_ProfileClock clock)
+{
+    profile->states   = states;
+    profile->capacity = capacity;
+    profile->count    = 0u;
+    profile->dropped  = 0u;
+    profile->clock    = ((cfsm_ProfileClock)0 != clock) ? clock : profile_defaultClock;
+
+    memset(states, 0, capacity * sizeof(*states));
+}
+
+void cfsm_profile_attach(cfsm_Profile * profile)
+{
+    activeProfile = profile;
+}
+
+void cfsm_profile_name(
+    cfsm_Profile * profile,
+    cfsm_TransitionFunction state,
+    const char * name)
+{
+    cfsm_ProfileState * entry = profile_find(profile, state);
+
+    if ((cfsm_ProfileState *)0 != entry)
+    {
+        entry->name = name;
+    }
+    else
+    {
+        profile->dropped++;
+    }
+}
+
+void cfsm_profile_report(const cfsm_Profile * profile, FILE * out)
+{
+    static const char * const opNames[CFSM_PROFILE_OPS] = {
+        "enter", "leave", "process", "event"
+    };
+
+    fprintf(out, "%-24s %-8s %10s %14s %12s\n",
+        "state", "op", "calls", "ticks", "ticks/call");
+
+    for (size_t i = 0u; i < profile->count; ++i)
+    {
+        const cfsm_ProfileState * state = &profile->states[i];
+        const char * name = (const char *)0 != state->name ? state->name : "?";
+
+        for (unsigned int op = 0u; op < (unsigned int)CFSM_PROFILE_OPS; ++op)
+        {
+            if (0u != state->calls[op])
+            {
+                fprintf(out, "%-24s %-8s %10lu %14llu %12.1f\n",
+                    name,
+                    opNames[op],
+                    (unsigned long)state->calls[op],
+                    (unsigned long long)state->ticks[op],
+                    (double)state->ticks[op] / (double)state->calls[op]);
+            }
+        }
+    }
+
+    fprintf(out, "\n%-24s %10s %14s %12s %12s\n",
+        "state", "stays", "mean ticks", "p50 <", "p99 <");
+
+    for (size_t i = 0u; i < profile->count; ++i)
+    {
+        const cfsm_ProfileState * state = &profile->states[i];
+
+        if (0u != state->dwellCount)
+        {
+            fprintf(out, "%-24s %10lu %14.1f %12llu %12llu\n",
+                (const char *)0 != state->name ? state->name : "?",
+                (unsigned long)state->dwellCount,
+                (double)state->dwellTicks / (double)state->dwellCount,
+                (unsigned long long)profile_percentile(state, (state->dwellCount + 1u) / 2u),
+                (unsigned long long)profile_percentile(state,
+                    state->dwellCount - (state->dwellCount / 100u)));
+        }
+    }
+
+    if (0u != profile->dropped)
+    {
+        fprintf(out, "\n%lu records dropped, state table full\n",
+            (unsigned long)profile->dropped);
+    }
+}
+
+cfsm_ProfileTick cfsm_profile_now(void)
+{
+    return ((cfsm_Profile *)0 != activeProfile) ? activeProfile->clock() : 0u;
+}
+
+void cfsm_profile_record(
+    cfsm_TransitionFunction state,
+    uint32_t slot,
+    cfsm_ProfileOp op,
+    cfsm_ProfileTick start)
+{
+    cfsm_ProfileState * entry;
+
+    if (((cfsm_Profile *)0 == activeProfile) || ((cfsm_TransitionFunction)0 == state))
+    {
+        return;
+    }
+
+    entry = profile_at(activeProfile, state, slot);
+    if ((cfsm_ProfileState *)0 != entry)
+    {
+        entry->calls[op]++;
+        entry->ticks[op] += activeProfile->clock() - start;
+    }
+}
+
+void cfsm_profile_dwell(
+    cfsm_TransitionFunction state,
+    uint32_t slot,
+    cfsm_ProfileTick entered)
+{
+    cfsm_ProfileState * entry;
+    cfsm_ProfileTick duration;
+
+    if (((cfsm_Profile *)0 == activeProfile) || ((cfsm_TransitionFunction)0 == state))
+    {
+        return;
+    }
+
+    /* Stays that began before the profile was attached have no start. */
+    if (0u == entered)
+    {
+        return;
+    }
+
+    entry = profile_at(activeProfile, state, slot);
+    if ((cfsm_ProfileState *)0 != entry)
+    {
+        duration = activeProfile->clock() - entered;
+
+        entry->dwellCount++;
+        entry->dwellTicks += duration;
+        entry->dwell[profile_bucketOf(duration)]++;
+    }
+}
+
+uint32_t cfsm_profile_slot(cfsm_TransitionFunction state)
+{
+    cfsm_ProfileState * entry;
+
+    if (((cfsm_Profile *)0 == activeProfile) || ((cfsm_TransitionFunction)0 == state))
+    {
+        return CFSM_PROFILE_NO_SLOT;
+    }
+
+    /* A full table is counted as dropped by the records of the state. */
+    entry = profile_find(activeProfile, state);
+
+    return ((cfsm_ProfileState *)0 != entry) ?
+        (uint32_t)(entry - activeProfile->states) : CFSM_PROFILE_NO_SLOT;
+}
+
+/******************************************************************************
+ * Local functions
+ *****************************************************************************/
+
+/**
+ * @brief Default clock, see file description.
+ *
+ * @return Current ticks.
+ */
+static cfsm_ProfileTick profile_defaultClock(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+    return (cfsm_ProfileTick)__rdtsc();
+#elif defined(__unix__) || defined(__APPLE__)
+    struct timespec now;
+
+    (void)clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return ((cfsm_ProfileTick)now.tv_sec * 1000000000u) + (cfsm_ProfileTick)now.tv_nsec;
+#else
+    return 0u;
+#endif
+}
+
+/**
+ * @brief Find or add the profile data of a state.
+ *
+ * @param profile The profile data structure.
+ * @param state The state identity.
+ * @return The state data or NULL if the state table is full.
+ */
+static cfsm_ProfileState * profile_find(cfsm_Profile * profile, cfsm_TransitionFunction state)
+{
+    for (size_t i = 0u; i < profile->count; ++i)
+    {
+        if (state == profile->states[i].state)
+        {
+            return &profile->states[i];
+        }
+    }
+
+    if ((profile->count == profile->capacity) ||
+        (profile->count >= (size_t)CFSM_PROFILE_NO_SLOT))
+    {
+        return (cfsm_ProfileState *)0;
+    }
+
+    profile->states[profile->count].state = state;
+
+    return &profile->states[profile->count++];
+}
+
+/**
+ * @brief Get the profile data of a state by its cached slot.
+ *
+ * @param profile The profile data structure.
+ * @param state The state identity.
+ * @param slot The cached table index of the state.
+ * @return The state data or NULL if the state table is full.
+ */
+static cfsm_ProfileState * profile_at(
+    cfsm_Profile * profile,
+    cfsm_TransitionFunction state,
+    uint32_t slot)
+{
+    cfsm_ProfileState * entry;
+
+    if (((size_t)slot < profile->count) && (state == profile->states[slot].state))
+    {
+        return &profile->states[slot];
+    }
+
+    entry = profile_find(profile, state);
+    if ((cfsm_ProfileState *)0 == entry)
+    {
+        profile->dropped++;
+    }
+
+    return entry;
+}
+
+/**
+ * @brief Get the dwell histogram bucket of a duration.
+ *
+ * @param duration The duration in ticks.
+ * @return Index of the smallest power of two above duration.
+ */
+static unsigned int profile_bucketOf(cfsm_ProfileTick duration)
+{
+    unsigned int bucket = 0u;
+
+    while ((0u != duration) && (bucket < (CFSM_PROFILE_DWELL_BUCKETS - 1u)))
+    {
+        duration >>= 1;
+        ++bucket;
+    }
+
+    return bucket;
+}
+
+/**
+ * @brief Get the upper bound of the dwell time with the given rank.
+ *
+ * @param state The state data.
+ * @param rank The 1 based rank of the stay, ordered by duration.
+ * @return The upper bound of the histogram bucket holding that stay.
+ */
+static cfsm_ProfileTick profile_percentile(const cfsm_ProfileState * state, uint32_t rank)
+{
+    uint32_t seen = 0u;
+    unsigned int bucket;
+
+    for (bucket = 0u; bucket < (CFSM_PROFILE_DWELL_BUCKETS - 1u); ++bucket)
+    {
+        seen += state->dwell[bucket];
+        if (seen >= rank)
+        {
+            break;
+        }
+    }
+
+    return (cfsm_ProfileTick)1u << bucket;
+}
+
+#endif /* CFSM_ENABLE_PROFILE */
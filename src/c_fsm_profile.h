@@ -0,0 +1,242 @@
+/* MIT License
+ *
+ * Copyright (C) 2024  Haju Schulz <haju@schulznorbert.de>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*******************************************************************************
+    DESCRIPTION
+*******************************************************************************/
+/**
+ * @brief  CFSM profiler header file
+ *
+ * The profiler measures the time spent in the operations of each state
+ * and how long instances dwell in a state. It is compiled in only if
+ * CFSM_ENABLE_PROFILE is defined for the library and the application,
+ * otherwise the hooks in c_fsm.c compile away entirely.
+ *
+ * Times are measured in ticks of a clock function. The default clock
+ * reads the time stamp counter on x86 and CLOCK_MONOTONIC nanoseconds on
+ * other POSIX systems. Other targets need to provide a clock.
+ *
+ * The profiler is not thread safe. Multi threaded applications profile
+ * one worker thread only.
+ *
+ * Repository: https://github.com/nhjschulz/cfsm
+ *
+ * @addtogroup CFSM
+ *
+ * @{
+ */
+
+/* Outside of the include guard, as the header only c_fsm.h includes this
+ * file before its implementation.
+ */
+#include "c_fsm.h"
+
+#ifndef SRC_C_FSM_C_FSM_PROFILE_H_
+#define SRC_C_FSM_C_FSM_PROFILE_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/******************************************************************************
+ * Includes
+ *****************************************************************************/
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+/******************************************************************************
+ * Macros
+ *****************************************************************************/
+
+/** Number of log2 buckets of the dwell time histogram. */
+#define CFSM_PROFILE_DWELL_BUCKETS 64
+
+/** Slot of a state without profile table entry. */
+#define CFSM_PROFILE_NO_SLOT 0xFFFFFFFFu
+
+/******************************************************************************
+ * Types and Classes
+ *****************************************************************************/
+
+/** Profiler time stamp in clock ticks. */
+typedef uint64_t cfsm_ProfileTick;
+
+/** Profiler clock function. */
+typedef cfsm_ProfileTick (*cfsm_ProfileClock)(void);
+
+/** Profiled state operations */
+typedef enum cfsm_ProfileOp {
+    CFSM_PROFILE_ENTER = 0,  /**< Enter operation                */
+    CFSM_PROFILE_LEAVE,      /**< onLeave operation              */
+    CFSM_PROFILE_PROCESS,    /**< onProcess operation            */
+    CFSM_PROFILE_EVENT,      /**< onEvent operation              */
+    CFSM_PROFILE_OPS         /**< Number of profiled operations  */
+} cfsm_ProfileOp;
+
+/** Profile data of one state
+ */
+typedef struct cfsm_ProfileState {
+    cfsm_TransitionFunction state;  /**< State identity (enter operation)   */
+    const char *     name;          /**< State name for reports or NULL     */
+    uint32_t         calls[CFSM_PROFILE_OPS]; /**< Calls per operation      */
+    cfsm_ProfileTick ticks[CFSM_PROFILE_OPS]; /**< Ticks per operation      */
+    uint32_t         dwellCount;    /**< Number of completed stays          */
+    cfsm_ProfileTick dwellTicks;    /**< Sum of all stay durations          */
+    uint32_t         dwell[CFSM_PROFILE_DWELL_BUCKETS]; /**< Stays with a
+                                         duration below 2^i ticks           */
+} cfsm_ProfileState;
+
+/** The CFSM profile data structure
+ */
+typedef struct cfsm_Profile {
+    cfsm_ProfileState * states;     /**< Application provided state table */
+    size_t              capacity;   /**< Number of elements in states     */
+    size_t              count;      /**< States recorded so far           */
+    uint32_t            dropped;    /**< Records of states beyond capacity*/
+    cfsm_ProfileClock   clock;      /**< Time source                      */
+} cfsm_Profile;
+
+/******************************************************************************
+ * Functions
+ *****************************************************************************/
+
+/**
+ * @brief Initialize a profile.
+ *
+ * States are added to the table when they are recorded the first time.
+ * Records of further states are counted as dropped once the table is
+ * full.
+ *
+ * @param profile The profile data structure to initialize.
+ * @param states Storage for the per state data.
+ * @param capacity Number of elements in states.
+ * @param clock Time source or NULL for the default clock.
+ * @since 0.4.0
+ */
+void cfsm_profile_init(
+    cfsm_Profile * profile,
+    cfsm_ProfileState * states,
+    size_t capacity,
+    cfsm_ProfileClock clock);
+
+/**
+ * @brief Make a profile the target of all CFSM operations of the calling
+ *        thread.
+ *
+ * @param profile The profile to record into or NULL to stop recording.
+ * @since 0.4.0
+ */
+void cfsm_profile_attach(cfsm_Profile * profile);
+
+/**
+ * @brief Set the report name of a state.
+ *
+ * @param profile The profile data structure.
+ * @param state The enter operation of the state.
+ * @param name The name, which must stay valid while the profile is used.
+ * @since 0.4.0
+ */
+void cfsm_profile_name(
+    cfsm_Profile * profile,
+    cfsm_TransitionFunction state,
+    const char * name);
+
+/**
+ * @brief Write a profile report.
+ *
+ * Lists calls and ticks of each state operation, followed by the number,
+ * mean and approximate median and 99th percentile of the state dwell
+ * times. Operation ticks include nested transitions triggered by the
+ * operation.
+ *
+ * @param profile The profile data structure.
+ * @param out The stream to write to.
+ * @since 0.4.0
+ */
+void cfsm_profile_report(const cfsm_Profile * profile, FILE * out);
+
+/**
+ * @brief Get the current time of the attached profile clock.
+ *
+ * Used by the CFSM profiling hooks.
+ *
+ * @return Current clock ticks or 0 if no profile is attached.
+ * @since 0.4.0
+ */
+cfsm_ProfileTick cfsm_profile_now(void);
+
+/**
+ * @brief Record the duration of a state operation.
+ *
+ * Used by the CFSM profiling hooks.
+ *
+ * @param state The state that ran the operation.
+ * @param slot Value of cfsm_profile_slot() for state.
+ * @param op The operation.
+ * @param start Value of cfsm_profile_now() before the operation.
+ * @since 0.4.0
+ */
+void cfsm_profile_record(
+    cfsm_TransitionFunction state,
+    uint32_t slot,
+    cfsm_ProfileOp op,
+    cfsm_ProfileTick start);
+
+/**
+ * @brief Record the time an instance stayed in a state.
+ *
+ * Used by the CFSM profiling hooks.
+ *
+ * @param state The state being left.
+ * @param slot Value of cfsm_profile_slot() for state.
+ * @param entered Value of cfsm_profile_now() when the state was entered.
+ * @since 0.4.0
+ */
+void cfsm_profile_dwell(
+    cfsm_TransitionFunction state,
+    uint32_t slot,
+    cfsm_ProfileTick entered);
+
+/**
+ * @brief Find or add the profile table entry of a state.
+ *
+ * Used by the CFSM profiling hooks on every transition, so the operations
+ * of the state skip the table search. A slot that no longer matches the
+ * state, as the profile was attached later or replaced, is searched
+ * again.
+ *
+ * @param state The state being entered.
+ * @return The table index or CFSM_PROFILE_NO_SLOT if no profile is
+ *         attached or the table is full.
+ * @since 0.4.0
+ */
+uint32_t cfsm_profile_slot(cfsm_TransitionFunction state);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SRC_C_FSM_C_FSM_PROFILE_H_ */
+
+/** @} */
@@ -0,0 +1,125 @@
+/* MIT License
+ *
+ * Copyright (C) 2024  Haju Schulz <haju@schulznorbert.de>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*******************************************************************************
+    DESCRIPTION
+*******************************************************************************/
+/**
+ * @brief  CFSM static tracepoint header file
+ *
+ * Minimal USDT (user statically defined tracing) probes, compatible with
+ * the ELF note format of SystemTap's sys/sdt.h, so CFSM needs no extra
+ * dependency. perf, bpftrace, bcc and SystemTap find the probes in the
+ * .note.stapsdt section of the binary.
+ *
+ * A probe compiles to a single nop instruction. Its note records where
+ * the arguments are, so the arguments only cost the instructions needed
+ * to have them in registers or memory at the nop. All arguments are
+ * passed as signed 64 bit values.
+ *
+ * Probes are only emitted for 64 bit x86 and ARM ELF targets with GCC
+ * compatible compilers. Elsewhere the probe macros expand to nothing.
+ *
+ * Repository: https://github.com/nhjschulz/cfsm
+ *
+ * @addtogroup CFSM
+ *
+ * @{
+ */
+
+#ifndef SRC_C_FSM_C_FSM_SDT_H_
+#define SRC_C_FSM_C_FSM_SDT_H_
+
+/******************************************************************************
+ * Includes
+ *****************************************************************************/
+#include <stdint.h>
+
+/******************************************************************************
+ * Macros
+ *****************************************************************************/
+
+#if defined(__ELF__) && defined(__GNUC__) && \
+    (defined(__x86_64__) || defined(__aarch64__))
+
+#define CFSM_SDT_ENABLED 1  /**< Probes are emitted */
+
+/* Note layout as in sys/sdt.h: probe address, base address to detect
+ * prelinking, semaphore address (unused), provider, name and argument
+ * descriptions like "-8@%rdi". The .stapsdt.base symbol is emitted once.
+ */
+#define CFSM_SDT_NOTE(provider, name, args)                                  \
+    "990: nop\n"                                                             \
+    ".pushsection .note.stapsdt,\"?\",\"note\"\n"                            \
+    ".balign 4\n"                                                            \
+    ".4byte 992f-991f, 994f-993f, 3\n"                                       \
+    "991: .asciz \"stapsdt\"\n"                                              \
+    "992: .balign 4\n"                                                       \
+    "993: .8byte 990b\n"                                                     \
+    ".8byte _.stapsdt.base\n"                                                \
+    ".8byte 0\n"                                                             \
+    ".asciz \"" #provider "\"\n"                                             \
+    ".asciz \"" #name "\"\n"                                                 \
+    ".asciz \"" args "\"\n"                                                  \
+    "994: .balign 4\n"                                                       \
+    ".popsection\n"                                                          \
+    ".ifndef _.stapsdt.base\n"                                               \
+    ".pushsection .stapsdt.base,\"aG\",\"progbits\",.stapsdt.base,comdat\n"  \
+    ".weak _.stapsdt.base\n"                                                 \
+    ".hidden _.stapsdt.base\n"                                               \
+    "_.stapsdt.base: .space 1\n"                                             \
+    ".size _.stapsdt.base, 1\n"                                              \
+    ".popsection\n"                                                          \
+    ".endif\n"
+
+/** Probe argument as operand, in a register, memory or as constant. */
+#define CFSM_SDT_ARG(x) "nor" ((int64_t)(x))
+
+/** Probe with one argument. */
+#define CFSM_SDT_PROBE1(provider, name, a1)                                  \
+    __asm__ __volatile__ (CFSM_SDT_NOTE(provider, name, "-8@%0")             \
+        :: CFSM_SDT_ARG(a1))
+
+/** Probe with two arguments. */
+#define CFSM_SDT_PROBE2(provider, name, a1, a2)                              \
+    __asm__ __volatile__ (CFSM_SDT_NOTE(provider, name, "-8@%0 -8@%1")       \
+        :: CFSM_SDT_ARG(a1), CFSM_SDT_ARG(a2))
+
+/** Probe with three arguments. */
+#define CFSM_SDT_PROBE3(provider, name, a1, a2, a3)                          \
+    __asm__ __volatile__ (CFSM_SDT_NOTE(provider, name, "-8@%0 -8@%1 -8@%2") \
+        :: CFSM_SDT_ARG(a1), CFSM_SDT_ARG(a2), CFSM_SDT_ARG(a3))
+
+#else
+
+#define CFSM_SDT_ENABLED 0  /**< Probes are not supported */
+
+#define CFSM_SDT_PROBE1(provider, name, a1)          /**< Probe, 1 argument  */
+#define CFSM_SDT_PROBE2(provider, name, a1, a2)      /**< Probe, 2 arguments */
+#define CFSM_SDT_PROBE3(provider, name, a1, a2, a3)  /**< Probe, 3 arguments */
+
+#endif
+
+#endif /* SRC_C_FSM_C_FSM_SDT_H_ */
+
+/** @} */
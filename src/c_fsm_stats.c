@@ -0,0 +1,691 @@
+/* MIT License
+ *
+ * Copyright (C) 2024  Haju Schulz <haju@schulznorbert.de>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+/*******************************************************************************
+    DESCRIPTION
+*******************************************************************************/
+
+/**
+ * @brief  CFSM live statistics segment implementation
+ *
+ * This file contains the implementation for publishing cfsm statistics
+ * into a sequence locked segment. Shared memory and time stamps are only
+ * available on POSIX systems.
+ *
+ * Repository: https://github.com/nhjschulz/cfsm
+ *
+ */
+
+/******************************************************************************
+ * Includes
+ *****************************************************************************/
+#if (defined(__unix__) || defined(__APPLE__)) && !defined(_POSIX_C_SOURCE)
+#define _POSIX_C_SOURCE 200112L  /* shm_open() in strict C99 */
+#endif
+
+#include "c_fsm.h"
+
+/* Statistics of fleets tell states apart by cfsm_Ctx::state. */
+#if defined(CFSM_ENABLE_STATE_ID)
+
+#include <stdio.h>
+#include <string.h>
+
+#include "c_fsm_stats.h"
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+#define STATS_HAS_SHM 1  /**< POSIX shared memory available */
+#else
+#define STATS_HAS_SHM 0  /**< No shared memory              */
+#endif
+
+/******************************************************************************
+ * Macros
+ *****************************************************************************/
+
+/* Sequence lock accesses. The fences keep row stores and loads between
+ * the two sequence updates. Without GNU builtins, the target is assumed
+ * to be a single core that only needs the compiler to keep the order.
+ */
+#if defined(__GNUC__) && !defined(__AVR__)
+#define STATS_LOAD(seq)         __atomic_load_n((seq), __ATOMIC_ACQUIRE)
+#define STATS_STORE(seq, value) __atomic_store_n((seq), (value), __ATOMIC_RELEASE)
+#define STATS_FENCE_RELEASE()   __atomic_thread_fence(__ATOMIC_RELEASE)
+#define STATS_FENCE_ACQUIRE()   __atomic_thread_fence(__ATOMIC_ACQUIRE)
+#else
+#define STATS_LOAD(seq)         (*(volatile const uint32_t *)(seq))
+#define STATS_STORE(seq, value) (*(volatile uint32_t *)(seq) = (value))
+#define STATS_FENCE_RELEASE()
+#define STATS_FENCE_ACQUIRE()
+#endif
+
+#define STATS_SPINS          16        /**< Attempts without pause     */
+#define STATS_RETRIES        64        /**< Attempts before giving up  */
+#define STATS_BACKOFF_NS     1000L     /**< First pause in ns          */
+#define STATS_BACKOFF_MAX_NS 1000000L  /**< Longest pause in ns        */
+
+/******************************************************************************
+ * Types and Classes
+ *****************************************************************************/
+
+/******************************************************************************
+ * Prototypes
+ *****************************************************************************/
+
+static cfsm_StatsState * stats_stateOf(
+    cfsm_StatsSegment * segment,
+    cfsm_StatsStateName stateName,
+    cfsm_TransitionFunction state);
+static cfsm_StatsQueue * stats_queueRows(cfsm_StatsSegment * segment);
+static cfsm_StatsLatency * stats_latencyRows(cfsm_StatsSegment * segment);
+static void * stats_row(
+    void * rows,
+    size_t rowSize,
+    uint32_t capacity,
+    uint32_t * used,
+    const char * name);
+static int stats_valid(const cfsm_StatsSegment * segment, size_t size);
+static void stats_clamp(cfsm_StatsSegment * copy);
+static void stats_backoff(int attempt);
+
+/******************************************************************************
+ * Variables
+ *****************************************************************************/
+
+/******************************************************************************
+ * External functions
+ *****************************************************************************/
+
+size_t cfsm_stats_size(uint32_t states, uint32_t queues, uint32_t latencies)
+{
+    return sizeof(cfsm_StatsSegment) +
+        ((size_t)states * sizeof(cfsm_StatsState)) +
+        ((size_t)queues * sizeof(cfsm_StatsQueue)) +
+        ((size_t)latencies * sizeof(cfsm_StatsLatency));
+}
+
+cfsm_StatsSegment * cfsm_stats_init(
+    void * memory,
+    uint32_t states,
+    uint32_t queues,
+    uint32_t latencies)
+{
+    cfsm_StatsSegment * segment = (cfsm_StatsSegment *)memory;
+
+    memset(memory, 0, cfsm_stats_size(states, queues, latencies));
+
+    segment->magic           = CFSM_STATS_MAGIC;
+    segment->version         = CFSM_STATS_VERSION;
+    segment->stateCapacity   = states;
+    segment->queueCapacity   = queues;
+    segment->latencyCapacity = latencies;
+
+    return segment;
+}
+
+cfsm_StatsSegment * cfsm_stats_create(
+    const char * name,
+    uint32_t states,
+    uint32_t queues,
+    uint32_t latencies)
+{
+#if STATS_HAS_SHM
+    size_t size = cfsm_stats_size(states, queues, latencies);
+    cfsm_StatsSegment * segment = (cfsm_StatsSegment *)0;
+    void * memory;
+    int fd;
+
+    /* A fresh object, so readers of a replaced segment keep theirs. */
+    (void)shm_unlink(name);
+    fd = shm_open(name, O_CREAT | O_EXCL | O_RDWR, 0644);
+    if (0 > fd)
+    {
+        return segment;
+    }
+
+    if (0 == ftruncate(fd, (off_t)size))
+    {
+        memory = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if (MAP_FAILED != memory)
+        {
+            segment = cfsm_stats_init(memory, states, queues, latencies);
+            segment->pid = (uint32_t)getpid();
+        }
+    }
+    (void)close(fd);
+
+    if ((cfsm_StatsSegment *)0 == segment)
+    {
+        (void)shm_unlink(name);
+    }
+
+    return segment;
+#else
+    (void)name;
+    (void)states;
+    (void)queues;
+    (void)latencies;
+
+    return (cfsm_StatsSegment *)0;
+#endif
+}
+
+const cfsm_StatsSegment * cfsm_stats_open(const char * name)
+{
+#if STATS_HAS_SHM
+    const cfsm_StatsSegment * segment = (const cfsm_StatsSegment *)0;
+    struct stat info;
+    void * memory;
+    int fd;
+
+    fd = shm_open(name, O_RDONLY, 0);
+    if (0 > fd)
+    {
+        return segment;
+    }
+
+    if ((0 == fstat(fd, &info)) && ((size_t)info.st_size >= sizeof(cfsm_StatsSegment)))
+    {
+        memory = mmap(NULL, (size_t)info.st_size, PROT_READ, MAP_SHARED, fd, 0);
+        if (MAP_FAILED != memory)
+        {
+            segment = (const cfsm_StatsSegment *)memory;
+            if (0 == stats_valid(segment, (size_t)info.st_size))
+            {
+                (void)munmap(memory, (size_t)info.st_size);
+                segment = (const cfsm_StatsSegment *)0;
+            }
+        }
+    }
+    (void)close(fd);
+
+    return segment;
+#else
+    (void)name;
+
+    return (const cfsm_StatsSegment *)0;
+#endif
+}
+
+void cfsm_stats_close(const cfsm_StatsSegment * segment)
+{
+#if STATS_HAS_SHM
+    size_t size = cfsm_stats_size(
+        segment->stateCapacity,
+        segment->queueCapacity,
+        segment->latencyCapacity);
+
+    (void)munmap((void *)(uintptr_t)segment, size);
+#else
+    (void)segment;
+#endif
+}
+
+void cfsm_stats_unlink(const char * name)
+{
+#if STATS_HAS_SHM
+    (void)shm_unlink(name);
+#else
+    (void)name;
+#endif
+}
+
+void cfsm_stats_begin(cfsm_StatsSegment * segment)
+{
+    cfsm_StatsState * states = (cfsm_StatsState *)(segment + 1);
+    cfsm_StatsQueue * queues = stats_queueRows(segment);
+    cfsm_StatsLatency * latencies = stats_latencyRows(segment);
+    uint32_t index;
+
+    STATS_STORE(&segment->sequence, segment->sequence + 1u);
+    STATS_FENCE_RELEASE();
+
+    for (index = 0u; index < segment->states; ++index)
+    {
+        states[index].events    = 0u;
+        states[index].unhandled = 0u;
+        states[index].instances = 0u;
+    }
+    for (index = 0u; index < segment->queues; ++index)
+    {
+        queues[index].depth    = 0u;
+        queues[index].capacity = 0u;
+    }
+    for (index = 0u; index < segment->latencies; ++index)
+    {
+        memset(&latencies[index].count, 0,
+            sizeof(cfsm_StatsLatency) - CFSM_STATS_NAME);
+    }
+}
+
+void cfsm_stats_end(cfsm_StatsSegment * segment)
+{
+    const cfsm_StatsState * states = (const cfsm_StatsState *)(segment + 1);
+    uint64_t events = 0u;
+    uint32_t index;
+
+    for (index = 0u; index < segment->states; ++index)
+    {
+        events += states[index].events;
+    }
+
+    segment->events = events;
+    ++segment->publishes;
+
+#if STATS_HAS_SHM
+    {
+        struct timespec now;
+
+        if (0 == clock_gettime(CLOCK_MONOTONIC, &now))
+        {
+            segment->time = ((uint64_t)now.tv_sec * 1000000000u) + (uint64_t)now.tv_nsec;
+        }
+    }
+#endif
+
+    STATS_STORE(&segment->sequence, segment->sequence + 1u);
+}
+
+cfsm_StatsState * cfsm_stats_state(cfsm_StatsSegment * segment, const char * name)
+{
+    return (cfsm_StatsState *)stats_row(
+        segment + 1,
+        sizeof(cfsm_StatsState),
+        segment->stateCapacity,
+        &segment->states,
+        name);
+}
+
+void cfsm_stats_fleet(
+    cfsm_StatsSegment * segment,
+    const cfsm_Fleet * fleet,
+    cfsm_StatsStateName stateName)
+{
+    cfsm_TransitionFunction last = (cfsm_TransitionFunction)0;
+    cfsm_StatsState * row = (cfsm_StatsState *)0;
+    size_t index;
+
+    for (index = 0u; index < fleet->count; ++index)
+    {
+        const cfsm_Ctx * fsm = cfsm_fleet_at(fleet, index);
+
+        if ((const cfsm_Ctx *)0 == fsm)
+        {
+            continue;
+        }
+
+        /* Neighbouring instances are often in the same state. */
+        if (((cfsm_StatsState *)0 == row) || (fsm->state != last))
+        {
+            last = fsm->state;
+            row  = stats_stateOf(segment, stateName, last);
+        }
+        if ((cfsm_StatsState *)0 != row)
+        {
+            ++row->instances;
+        }
+    }
+}
+
+void cfsm_stats_hits(
+    cfsm_StatsSegment * segment,
+    const cfsm_Hits * hits,
+    cfsm_StatsStateName stateName)
+{
+    size_t index;
+
+    for (index = 0u; index < hits->capacity; ++index)
+    {
+        const cfsm_HitCell * cell = &hits->cells[index];
+        cfsm_StatsState * row;
+
+        if (0u == cell->hits)
+        {
+            continue;
+        }
+
+        row = stats_stateOf(segment, stateName, cell->state);
+        if ((cfsm_StatsState *)0 != row)
+        {
+            row->events    += cell->hits;
+            row->unhandled += cell->unhandled;
+        }
+    }
+}
+
+void cfsm_stats_queue(
+    cfsm_StatsSegment * segment,
+    const char * name,
+    uint32_t depth,
+    uint32_t capacity)
+{
+    cfsm_StatsQueue * row = (cfsm_StatsQueue *)stats_row(
+        stats_queueRows(segment),
+        sizeof(cfsm_StatsQueue),
+        segment->queueCapacity,
+        &segment->queues,
+        name);
+
+    if ((cfsm_StatsQueue *)0 != row)
+    {
+        row->depth    = depth;
+        row->capacity = capacity;
+    }
+}
+
+void cfsm_stats_latency(
+    cfsm_StatsSegment * segment,
+    const char * name,
+    const cfsm_Histogram * histogram)
+{
+    cfsm_StatsLatency * row = (cfsm_StatsLatency *)stats_row(
+        stats_latencyRows(segment),
+        sizeof(cfsm_StatsLatency),
+        segment->latencyCapacity,
+        &segment->latencies,
+        name);
+
+    if ((cfsm_StatsLatency *)0 != row)
+    {
+        row->count = histogram->count;
+        row->p50   = cfsm_histogram_percentile(histogram, 50.0);
+        row->p99   = cfsm_histogram_percentile(histogram, 99.0);
+        row->p999  = cfsm_histogram_percentile(histogram, 99.9);
+        row->max   = histogram->max;
+    }
+}
+
+int cfsm_stats_snapshot(
+    const cfsm_StatsSegment * segment,
+    cfsm_StatsSegment * copy,
+    size_t size)
+{
+    uint32_t stateCapacity;
+    uint32_t queueCapacity;
+    uint32_t latencyCapacity;
+    int retries;
+
+    if (0 == stats_valid(segment, size))
+    {
+        return -1;
+    }
+
+    /* The segment is shared with another process, so its header is read
+     * once and the copy is checked against it instead of trusted.
+     */
+    stateCapacity   = segment->stateCapacity;
+    queueCapacity   = segment->queueCapacity;
+    latencyCapacity = segment->latencyCapacity;
+    if (size < cfsm_stats_size(stateCapacity, queueCapacity, latencyCapacity))
+    {
+        return -1;
+    }
+    size = cfsm_stats_size(stateCapacity, queueCapacity, latencyCapacity);
+
+    for (retries = 0; retries < STATS_RETRIES; ++retries)
+    {
+        uint32_t before = STATS_LOAD(&segment->sequence);
+
+        if (0u == (before & 1u))
+        {
+            memcpy(copy, segment, size);
+            STATS_FENCE_ACQUIRE();
+
+            if (before == STATS_LOAD(&segment->sequence))
+            {
+                if ((stateCapacity != copy->stateCapacity) ||
+                    (queueCapacity != copy->queueCapacity) ||
+                    (latencyCapacity != copy->latencyCapacity))
+                {
+                    return -1;
+                }
+
+                stats_clamp(copy);
+                return 0;
+            }
+        }
+
+        stats_backoff(retries);
+    }
+
+    return -2;
+}
+
+const cfsm_StatsState * cfsm_stats_states(const cfsm_StatsSegment * segment)
+{
+    return (const cfsm_StatsState *)(segment + 1);
+}
+
+const cfsm_StatsQueue * cfsm_stats_queues(const cfsm_StatsSegment * segment)
+{
+    return (const cfsm_StatsQueue *)(cfsm_stats_states(segment) + segment->stateCapacity);
+}
+
+const cfsm_StatsLatency * cfsm_stats_latencies(const cfsm_StatsSegment * segment)
+{
+    return (const cfsm_StatsLatency *)(cfsm_stats_queues(segment) + segment->queueCapacity);
+}
+
+/******************************************************************************
+ * Local functions
+ *****************************************************************************/
+
+/**
+ * @brief Get the row of a state by its name.
+ *
+ * @param segment The segment.
+ * @param stateName State name function or NULL.
+ * @param state The state.
+ * @return The row or NULL if all rows are taken.
+ */
+static cfsm_StatsState * stats_stateOf(
+    cfsm_StatsSegment * segment,
+    cfsm_StatsStateName stateName,
+    cfsm_TransitionFunction state)
+{
+    char address[CFSM_STATS_NAME];
+    const char * name = (const char *)0;
+
+    if ((cfsm_TransitionFunction)0 == state)
+    {
+        name = "[*]";
+    }
+    else if ((cfsm_StatsStateName)0 != stateName)
+    {
+        name = stateName(state);
+    }
+
+    if ((const char *)0 == name)
+    {
+        (void)snprintf(address, sizeof(address), "0x%llx",
+            (unsigned long long)(uintptr_t)state);
+        name = address;
+    }
+
+    return cfsm_stats_state(segment, name);
+}
+
+/**
+ * @brief Get the writable queue rows of a segment.
+ *
+ * @param segment The segment.
+ * @return The first queue row.
+ */
+static cfsm_StatsQueue * stats_queueRows(cfsm_StatsSegment * segment)
+{
+    return (cfsm_StatsQueue *)((cfsm_StatsState *)(segment + 1) + segment->stateCapacity);
+}
+
+/**
+ * @brief Get the writable latency rows of a segment.
+ *
+ * @param segment The segment.
+ * @return The first latency row.
+ */
+static cfsm_StatsLatency * stats_latencyRows(cfsm_StatsSegment * segment)
+{
+    return (cfsm_StatsLatency *)(stats_queueRows(segment) + segment->queueCapacity);
+}
+
+/**
+ * @brief Find or claim a named row.
+ *
+ * All row types start with the name buffer.
+ *
+ * @param rows The first row.
+ * @param rowSize Size of a row in bytes.
+ * @param capacity Number of rows.
+ * @param used Rows in use, incremented when a row is claimed.
+ * @param name The row name.
+ * @return The row or NULL if all rows are taken by other names.
+ */
+static void * stats_row(
+    void * rows,
+    size_t rowSize,
+    uint32_t capacity,
+    uint32_t * used,
+    const char * name)
+{
+    char * row = (char *)rows;
+    uint32_t index;
+
+    for (index = 0u; index < *used; ++index, row += rowSize)
+    {
+        if (0 == strncmp(row, name, CFSM_STATS_NAME - 1u))
+        {
+            return row;
+        }
+    }
+
+    if (*used >= capacity)
+    {
+        return (void *)0;
+    }
+
+    ++*used;
+    strncpy(row, name, CFSM_STATS_NAME - 1u);
+    row[CFSM_STATS_NAME - 1u] = '\0';
+
+    return row;
+}
+
+/**
+ * @brief Make a snapshot safe to walk.
+ *
+ * Limits the rows in use to the capacities and terminates all names, so
+ * readers can loop over the used rows and print their names.
+ *
+ * @param copy The snapshot.
+ */
+static void stats_clamp(cfsm_StatsSegment * copy)
+{
+    cfsm_StatsState * states = (cfsm_StatsState *)(copy + 1);
+    cfsm_StatsQueue * queues = stats_queueRows(copy);
+    cfsm_StatsLatency * latencies = stats_latencyRows(copy);
+    uint32_t index;
+
+    if (copy->states > copy->stateCapacity)
+    {
+        copy->states = copy->stateCapacity;
+    }
+    if (copy->queues > copy->queueCapacity)
+    {
+        copy->queues = copy->queueCapacity;
+    }
+    if (copy->latencies > copy->latencyCapacity)
+    {
+        copy->latencies = copy->latencyCapacity;
+    }
+
+    for (index = 0u; index < copy->stateCapacity; ++index)
+    {
+        states[index].name[CFSM_STATS_NAME - 1u] = '\0';
+    }
+    for (index = 0u; index < copy->queueCapacity; ++index)
+    {
+        queues[index].name[CFSM_STATS_NAME - 1u] = '\0';
+    }
+    for (index = 0u; index < copy->latencyCapacity; ++index)
+    {
+        latencies[index].name[CFSM_STATS_NAME - 1u] = '\0';
+    }
+}
+
+/**
+ * @brief Check the header of a segment.
+ *
+ * @param segment The segment.
+ * @param size Bytes accessible at segment.
+ * @return Non zero if the segment is valid and fits into size.
+ */
+static int stats_valid(const cfsm_StatsSegment * segment, size_t size)
+{
+    return (size >= sizeof(cfsm_StatsSegment)) &&
+        (CFSM_STATS_MAGIC == segment->magic) &&
+        (CFSM_STATS_VERSION == segment->version) &&
+        (size >= cfsm_stats_size(
+            segment->stateCapacity,
+            segment->queueCapacity,
+            segment->latencyCapacity));
+}
+
+/**
+ * @brief Pause before the next snapshot attempt.
+ *
+ * The first attempts retry at once, as updates are short. Later ones
+ * sleep with doubling pauses, so a publisher that is preempted in the
+ * middle of an update gets the CPU to finish it.
+ *
+ * @param attempt The number of the failed attempt, starting at 0.
+ */
+static void stats_backoff(int attempt)
+{
+#if STATS_HAS_SHM
+    struct timespec pause;
+    long ns = STATS_BACKOFF_NS;
+
+    if (attempt < STATS_SPINS)
+    {
+        return;
+    }
+
+    for (attempt -= STATS_SPINS; (0 < attempt) && (ns < STATS_BACKOFF_MAX_NS); --attempt)
+    {
+        ns *= 2;
+    }
+
+    pause.tv_sec  = 0;
+    pause.tv_nsec = (ns < STATS_BACKOFF_MAX_NS) ? ns : STATS_BACKOFF_MAX_NS;
+    (void)nanosleep(&pause, (struct timespec *)0);
+#else
+    (void)attempt;
+#endif
+}
+
+#endif /* CFSM_ENABLE_STATE_ID */
@@ -0,0 +1,358 @@
+/* MIT License
+ *
+ * Copyright (C) 2024  Haju Schulz <haju@schulznorbert.de>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*******************************************************************************
+    DESCRIPTION
+*******************************************************************************/
+/**
+ * @brief  CFSM live statistics segment header file
+ *
+ * Publishes the state of a running application into a shared memory
+ * segment, so tools like cfsm-top can watch it without attaching a
+ * debugger. The segment holds rows of per state instance and event
+ * counts, queue depths and latency percentiles.
+ *
+ * The application publishes from its own loop, for example once per
+ * second, using values it already has: fleets, hit matrices and latency
+ * histograms. Event dispatch is not touched. A sequence lock protects
+ * each update. The single publisher never waits for readers, and
+ * readers retry a copy that overlapped an update.
+ *
+ * Shared memory needs POSIX shm_open(). On other targets, a segment
+ * can be placed in any memory with cfsm_stats_init(), for example for
+ * reading through a debug probe.
+ *
+ * Repository: https://github.com/nhjschulz/cfsm
+ *
+ * @addtogroup CFSM
+ *
+ * @{
+ */
+
+#ifndef SRC_C_FSM_C_FSM_STATS_H_
+#define SRC_C_FSM_C_FSM_STATS_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/******************************************************************************
+ * Includes
+ *****************************************************************************/
+#include <stddef.h>
+#include <stdint.h>
+
+#include "c_fsm.h"
+#include "c_fsm_fleet.h"
+#include "c_fsm_hits.h"
+#include "c_fsm_latency.h"
+
+/******************************************************************************
+ * Macros
+ *****************************************************************************/
+
+#define CFSM_STATS_MAGIC   0x54534643u  /**< "CFST" in little endian */
+#define CFSM_STATS_VERSION 1u           /**< Segment layout version  */
+#define CFSM_STATS_NAME    32u          /**< Row name buffer size    */
+
+/******************************************************************************
+ * Types and Classes
+ *****************************************************************************/
+
+/** Segment header, followed by the state, queue and latency rows
+ */
+typedef struct cfsm_StatsSegment {
+    uint32_t magic;           /**< CFSM_STATS_MAGIC                     */
+    uint32_t version;         /**< CFSM_STATS_VERSION                   */
+    uint32_t sequence;        /**< Sequence lock, odd during updates    */
+    uint32_t pid;             /**< Publishing process or 0              */
+    uint32_t stateCapacity;   /**< Number of state rows                 */
+    uint32_t queueCapacity;   /**< Number of queue rows                 */
+    uint32_t latencyCapacity; /**< Number of latency rows               */
+    uint32_t states;          /**< State rows in use                    */
+    uint32_t queues;          /**< Queue rows in use                    */
+    uint32_t latencies;       /**< Latency rows in use                  */
+    uint64_t publishes;       /**< Completed updates                    */
+    uint64_t time;            /**< CLOCK_MONOTONIC ns of the last update,
+                                   0 without clock                      */
+    uint64_t events;          /**< Sum of the state row events          */
+} cfsm_StatsSegment;
+
+/** Published data of one state
+ */
+typedef struct cfsm_StatsState {
+    char     name[CFSM_STATS_NAME]; /**< State name                     */
+    uint64_t events;                /**< Events received so far         */
+    uint64_t unhandled;             /**< Events without handler so far  */
+    uint32_t instances;             /**< Instances in the state         */
+    uint32_t reserved;              /**< Padding, always 0              */
+} cfsm_StatsState;
+
+/** Published data of one event queue
+ */
+typedef struct cfsm_StatsQueue {
+    char     name[CFSM_STATS_NAME]; /**< Queue name                     */
+    uint32_t depth;                 /**< Queued events                  */
+    uint32_t capacity;              /**< Queue size or 0 if unbounded   */
+} cfsm_StatsQueue;
+
+/** Published percentiles of one latency histogram
+ */
+typedef struct cfsm_StatsLatency {
+    char     name[CFSM_STATS_NAME]; /**< Latency name                   */
+    uint64_t count;                 /**< Recorded values                */
+    uint32_t p50;                   /**< Median in clock ticks          */
+    uint32_t p99;                   /**< 99th percentile in clock ticks */
+    uint32_t p999;                  /**< 99.9th percentile              */
+    uint32_t max;                   /**< Largest value                  */
+} cfsm_StatsLatency;
+
+/** State name function, like the generated <prefix>_stateName(). */
+typedef const char * (*cfsm_StatsStateName)(cfsm_TransitionFunction state);
+
+/******************************************************************************
+ * Functions
+ *****************************************************************************/
+
+/**
+ * @brief Get the size of a segment.
+ *
+ * @param states Number of state rows.
+ * @param queues Number of queue rows.
+ * @param latencies Number of latency rows.
+ * @return Segment size in bytes.
+ * @since 0.4.0
+ */
+size_t cfsm_stats_size(uint32_t states, uint32_t queues, uint32_t latencies);
+
+/**
+ * @brief Initialize a segment in application provided memory.
+ *
+ * @param memory 8 byte aligned storage of cfsm_stats_size() bytes.
+ * @param states Number of state rows.
+ * @param queues Number of queue rows.
+ * @param latencies Number of latency rows.
+ * @return The segment at memory.
+ * @since 0.4.0
+ */
+cfsm_StatsSegment * cfsm_stats_init(
+    void * memory,
+    uint32_t states,
+    uint32_t queues,
+    uint32_t latencies);
+
+/**
+ * @brief Create a segment in POSIX shared memory.
+ *
+ * An existing segment of the same name is replaced. The segment stays
+ * until cfsm_stats_unlink(), so readers can still look at the last
+ * update of a crashed process.
+ *
+ * @param name Shared memory object name, like "/myapp".
+ * @param states Number of state rows.
+ * @param queues Number of queue rows.
+ * @param latencies Number of latency rows.
+ * @return The mapped segment or NULL on error or without shared memory.
+ * @since 0.4.0
+ */
+cfsm_StatsSegment * cfsm_stats_create(
+    const char * name,
+    uint32_t states,
+    uint32_t queues,
+    uint32_t latencies);
+
+/**
+ * @brief Map an existing shared memory segment read only.
+ *
+ * @param name Shared memory object name given to cfsm_stats_create().
+ * @return The mapped segment or NULL if it does not exist or is no
+ *         segment of this version.
+ * @since 0.4.0
+ */
+const cfsm_StatsSegment * cfsm_stats_open(const char * name);
+
+/**
+ * @brief Unmap a segment of cfsm_stats_create() or cfsm_stats_open().
+ *
+ * @param segment The segment.
+ * @since 0.4.0
+ */
+void cfsm_stats_close(const cfsm_StatsSegment * segment);
+
+/**
+ * @brief Remove a shared memory segment name.
+ *
+ * @param name Shared memory object name given to cfsm_stats_create().
+ * @since 0.4.0
+ */
+void cfsm_stats_unlink(const char * name);
+
+/**
+ * @brief Start an update.
+ *
+ * Makes the sequence odd and clears all row values. Row names stay, so
+ * rows keep their order across updates. Each update must be finished
+ * with cfsm_stats_end(). Only one thread may publish.
+ *
+ * @param segment The segment.
+ * @since 0.4.0
+ */
+void cfsm_stats_begin(cfsm_StatsSegment * segment);
+
+/**
+ * @brief Finish an update.
+ *
+ * Sums the state events, stores the time stamp and makes the sequence
+ * even again.
+ *
+ * @param segment The segment.
+ * @since 0.4.0
+ */
+void cfsm_stats_end(cfsm_StatsSegment * segment);
+
+/**
+ * @brief Get the row of a state during an update.
+ *
+ * @param segment The segment.
+ * @param name The state name, truncated to CFSM_STATS_NAME - 1 chars.
+ * @return The row or NULL if all rows are taken by other names.
+ * @since 0.4.0
+ */
+cfsm_StatsState * cfsm_stats_state(cfsm_StatsSegment * segment, const char * name);
+
+/**
+ * @brief Add the instances of a fleet to the state rows.
+ *
+ * Walks all fleet entries. Publish fleets of other threads only while
+ * they do not run, or accept slightly inconsistent counts.
+ *
+ * @param segment The segment.
+ * @param fleet The fleet.
+ * @param stateName State name function or NULL to use addresses.
+ * @since 0.4.0
+ */
+void cfsm_stats_fleet(
+    cfsm_StatsSegment * segment,
+    const cfsm_Fleet * fleet,
+    cfsm_StatsStateName stateName);
+
+/**
+ * @brief Add the event counts of a hit matrix to the state rows.
+ *
+ * Rates follow from the change of these totals between updates.
+ *
+ * @param segment The segment.
+ * @param hits The hit matrix, see c_fsm_hits.h.
+ * @param stateName State name function or NULL to use addresses.
+ * @since 0.4.0
+ */
+void cfsm_stats_hits(
+    cfsm_StatsSegment * segment,
+    const cfsm_Hits * hits,
+    cfsm_StatsStateName stateName);
+
+/**
+ * @brief Publish the depth of an event queue.
+ *
+ * @param segment The segment.
+ * @param name The queue name.
+ * @param depth Queued events.
+ * @param capacity Queue size or 0 if unbounded.
+ * @since 0.4.0
+ */
+void cfsm_stats_queue(
+    cfsm_StatsSegment * segment,
+    const char * name,
+    uint32_t depth,
+    uint32_t capacity);
+
+/**
+ * @brief Publish the percentiles of a latency histogram.
+ *
+ * @param segment The segment.
+ * @param name The latency name.
+ * @param histogram The histogram, see c_fsm_latency.h.
+ * @since 0.4.0
+ */
+void cfsm_stats_latency(
+    cfsm_StatsSegment * segment,
+    const char * name,
+    const cfsm_Histogram * histogram);
+
+/**
+ * @brief Copy a consistent snapshot of a segment.
+ *
+ * Retries while the copy overlaps an update, at first at once and then
+ * with doubling pauses of up to 1 ms, for about 40 ms in total on POSIX
+ * systems. The rows in use of the copy are limited to its capacities and
+ * all row names are terminated, as the segment may be written by another
+ * process.
+ *
+ * @param segment The segment, usually of cfsm_stats_open().
+ * @param copy Receives the snapshot.
+ * @param size Size of copy in bytes.
+ * @return 0 on success, -1 if copy is too small or the segment is
+ *         invalid, -2 if no update finished during the retries. A
+ *         sequence that is still odd then hints at a publisher that
+ *         died during an update.
+ * @since 0.4.0
+ */
+int cfsm_stats_snapshot(
+    const cfsm_StatsSegment * segment,
+    cfsm_StatsSegment * copy,
+    size_t size);
+
+/**
+ * @brief Get the state rows of a segment.
+ *
+ * @param segment The segment or snapshot.
+ * @return The first of segment->stateCapacity rows.
+ * @since 0.4.0
+ */
+const cfsm_StatsState * cfsm_stats_states(const cfsm_StatsSegment * segment);
+
+/**
+ * @brief Get the queue rows of a segment.
+ *
+ * @param segment The segment or snapshot.
+ * @return The first of segment->queueCapacity rows.
+ * @since 0.4.0
+ */
+const cfsm_StatsQueue * cfsm_stats_queues(const cfsm_StatsSegment * segment);
+
+/**
+ * @brief Get the latency rows of a segment.
+ *
+ * @param segment The segment or snapshot.
+ * @return The first of segment->latencyCapacity rows.
+ * @since 0.4.0
+ */
+const cfsm_StatsLatency * cfsm_stats_latencies(const cfsm_StatsSegment * segment);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SRC_C_FSM_C_FSM_STATS_H_ */
+
+/** @} */
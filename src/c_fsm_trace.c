@@ -0,0 +1,396 @@
+/* MIT License
+ *
+ * Copyright (C) 2024  Haju Schulz <haju@schulznorbert.de>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+/*******************************************************************************
+    DESCRIPTION
+*******************************************************************************/
+
+/**
+ * @brief  CFSM trace recorder implementation
+ *
+ * This file contains the implementation for recording cfsm transitions
+ * and events and exporting them as Chrome Trace Event JSON.
+ *
+ * Repository: https://github.com/nhjschulz/cfsm
+ *
+ */
+
+/******************************************************************************
+ * Includes
+ *****************************************************************************/
+#if (defined(__unix__) || defined(__APPLE__)) && !defined(_POSIX_C_SOURCE)
+#define _POSIX_C_SOURCE 199309L  /* clock_gettime() in strict C99 */
+#endif
+
+#include "c_fsm.h"
+
+/* Trace records tell states apart by cfsm_Ctx::state. */
+#if defined(CFSM_ENABLE_STATE_ID)
+
+#include "c_fsm_trace.h"
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <time.h>
+#endif
+
+/******************************************************************************
+ * Macros
+ *****************************************************************************/
+
+#define TRACE_FILE_CHUNK 64u  /**< Records read at once by cfsm_trace_exportFile() */
+
+/* Thread local storage class of the attached trace. Targets without
+ * threads fall back to a plain static variable.
+ */
+#if defined(__STDC_VERSION__) && (__STDC_VERSION__ >= 201112L) && \
+    !defined(__STDC_NO_THREADS__)
+#define TRACE_THREAD_LOCAL _Thread_local
+#elif defined(__GNUC__) && !defined(__AVR__)
+#define TRACE_THREAD_LOCAL __thread
+#elif defined(_MSC_VER)
+#define TRACE_THREAD_LOCAL __declspec(thread)
+#else
+#define TRACE_THREAD_LOCAL
+#endif
+
+/******************************************************************************
+ * Types and Classes
+ *****************************************************************************/
+
+/******************************************************************************
+ * Prototypes
+ *****************************************************************************/
+
+static uint64_t trace_defaultClock(void);
+static void trace_writeEvent(
+    cfsm_TraceExport * exporter,
+    const cfsm_TraceRecord * record,
+    char phase);
+static void trace_writeStateName(
+    FILE * out,
+    cfsm_TraceStateName stateName,
+    cfsm_TransitionFunction state);
+static void trace_writeString(FILE * out, const char * text);
+
+/******************************************************************************
+ * Variables
+ *****************************************************************************/
+
+static TRACE_THREAD_LOCAL cfsm_Trace * activeTrace; /**< Trace of this thread */
+
+/******************************************************************************
+ * External functions
+ *****************************************************************************/
+
+int cfsm_trace_init(
+    cfsm_Trace * trace,
+    cfsm_TraceRecord * records,
+    size_t capacity,
+    cfsm_TraceClock clock,
+    cfsm_TraceSink sink,
+    void * sinkData)
+{
+    int valid = ((cfsm_TraceRecord *)0 != records) && (0u != capacity);
+
+    /* An invalid buffer leaves an inert trace, which records nothing. */
+    trace->records  = valid ? records : (cfsm_TraceRecord *)0;
+    trace->capacity = valid ? capacity : 0u;
+    trace->head     = 0u;
+    trace->count    = 0u;
+    trace->lost     = 0u;
+    trace->clock    = ((cfsm_TraceClock)0 != clock) ? clock : trace_defaultClock;
+    trace->sink     = sink;
+    trace->sinkData = sinkData;
+
+    return valid ? 0 : -1;
+}
+
+void cfsm_trace_attach(cfsm_Trace * trace)
+{
+    activeTrace = trace;
+}
+
+void cfsm_trace_drain(cfsm_Trace * trace, cfsm_TraceSink sink, void * sinkData)
+{
+    size_t tail;
+
+    if (0u == trace->count)
+    {
+        return;
+    }
+
+    /* The records may wrap around the end of the ring buffer. */
+    tail = (trace->head + trace->capacity - trace->count) % trace->capacity;
+    if ((tail + trace->count) > trace->capacity)
+    {
+        sink(sinkData, &trace->records[tail], trace->capacity - tail);
+        sink(sinkData, trace->records, trace->head);
+    }
+    else
+    {
+        sink(sinkData, &trace->records[tail], trace->count);
+    }
+
+    trace->count = 0u;
+}
+
+void cfsm_trace_record(cfsm_TraceKind kind, const struct cfsm_Ctx * fsm, int eventId)
+{
+    cfsm_Trace * trace = activeTrace;
+    cfsm_TraceRecord * record;
+
+    if (((cfsm_Trace *)0 == trace) || (0u == trace->capacity))
+    {
+        return;
+    }
+
+    if (trace->count == trace->capacity)
+    {
+        if ((cfsm_TraceSink)0 != trace->sink)
+        {
+            cfsm_trace_drain(trace, trace->sink, trace->sinkData);
+        }
+        else
+        {
+            /* Flight recorder, the oldest record is overwritten. */
+            trace->count--;
+            trace->lost++;
+        }
+    }
+
+    record = &trace->records[trace->head];
+    record->time    = trace->clock();
+    record->fsm     = fsm;
+    record->state   = fsm->state;
+    record->eventId = (int32_t)eventId;
+    record->kind    = (uint32_t)kind;
+
+    if (++trace->head == trace->capacity)
+    {
+        trace->head = 0u;
+    }
+    trace->count++;
+}
+
+void cfsm_trace_fileSink(void * file, const cfsm_TraceRecord * records, size_t count)
+{
+    (void)fwrite(records, sizeof(*records), count, (FILE *)file);
+}
+
+void cfsm_trace_exportBegin(
+    cfsm_TraceExport * exporter,
+    FILE * out,
+    cfsm_TraceStateName stateName,
+    cfsm_TraceEventName eventName,
+    double ticksPerUs)
+{
+    exporter->out        = out;
+    exporter->stateName  = stateName;
+    exporter->eventName  = eventName;
+    exporter->ticksPerUs = ticksPerUs;
+    exporter->written    = 0u;
+
+    fprintf(out, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[");
+}
+
+void cfsm_trace_exportSink(void * exporter, const cfsm_TraceRecord * records, size_t count)
+{
+    cfsm_TraceExport * exp = (cfsm_TraceExport *)exporter;
+
+    for (size_t i = 0u; i < count; ++i)
+    {
+        const cfsm_TraceRecord * record = &records[i];
+
+        if ((cfsm_TransitionFunction)0 == record->state)
+        {
+            continue;
+        }
+
+        switch ((cfsm_TraceKind)record->kind)
+        {
+        case CFSM_TRACE_ENTER:
+            trace_writeEvent(exp, record, 'B');
+            break;
+
+        case CFSM_TRACE_LEAVE:
+            trace_writeEvent(exp, record, 'E');
+            break;
+
+        case CFSM_TRACE_EVENT:
+            trace_writeEvent(exp, record, 'i');
+            break;
+
+        default:
+            break;
+        }
+    }
+}
+
+uint64_t cfsm_trace_exportFile(cfsm_TraceExport * exporter, FILE * in)
+{
+    cfsm_TraceRecord chunk[TRACE_FILE_CHUNK];
+    uint64_t total = 0u;
+    size_t count;
+
+    while (0u != (count = fread(chunk, sizeof(chunk[0]), TRACE_FILE_CHUNK, in)))
+    {
+        cfsm_trace_exportSink(exporter, chunk, count);
+        total += count;
+    }
+
+    return total;
+}
+
+void cfsm_trace_exportEnd(cfsm_TraceExport * exporter)
+{
+    fprintf(exporter->out, "\n]}\n");
+}
+
+/******************************************************************************
+ * Local functions
+ *****************************************************************************/
+
+/**
+ * @brief Default clock, CLOCK_MONOTONIC nanoseconds on POSIX systems.
+ *
+ * @return Current ticks or 0 if no clock is available.
+ */
+static uint64_t trace_defaultClock(void)
+{
+#if defined(__unix__) || defined(__APPLE__)
+    struct timespec now;
+
+    (void)clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return ((uint64_t)now.tv_sec * 1000000000u) + (uint64_t)now.tv_nsec;
+#else
+    return 0u;
+#endif
+}
+
+/**
+ * @brief Write a record as trace event.
+ *
+ * @param exporter The exporter.
+ * @param record The record.
+ * @param phase The trace event type, B(egin), E(nd) or i(nstant).
+ */
+static void trace_writeEvent(
+    cfsm_TraceExport * exporter,
+    const cfsm_TraceRecord * record,
+    char phase)
+{
+    FILE * out = exporter->out;
+
+    fprintf(out, "%s\n{\"ph\":\"%c\",\"pid\":1,\"tid\":%llu,\"ts\":%.3f",
+        (0u != exporter->written) ? "," : "",
+        phase,
+        (unsigned long long)(uintptr_t)record->fsm,
+        (double)record->time / exporter->ticksPerUs);
+
+    if ('B' == phase)
+    {
+        fprintf(out, ",\"name\":");
+        trace_writeStateName(out, exporter->stateName, record->state);
+    }
+    else if ('i' == phase)
+    {
+        const char * name = ((cfsm_TraceEventName)0 != exporter->eventName) ?
+            exporter->eventName((int)record->eventId) : (const char *)0;
+
+        fprintf(out, ",\"s\":\"t\",\"name\":");
+        if ((const char *)0 != name)
+        {
+            trace_writeString(out, name);
+        }
+        else
+        {
+            fprintf(out, "\"event %ld\"", (long)record->eventId);
+        }
+
+        fprintf(out, ",\"args\":{\"id\":%ld,\"state\":", (long)record->eventId);
+        trace_writeStateName(out, exporter->stateName, record->state);
+        fprintf(out, "}");
+    }
+
+    fprintf(out, "}");
+    exporter->written++;
+}
+
+/**
+ * @brief Write a state name as JSON string.
+ *
+ * @param out The output stream.
+ * @param stateName State name function or NULL.
+ * @param state The state.
+ */
+static void trace_writeStateName(
+    FILE * out,
+    cfsm_TraceStateName stateName,
+    cfsm_TransitionFunction state)
+{
+    const char * name = ((cfsm_TraceStateName)0 != stateName) ?
+        stateName(state) : (const char *)0;
+
+    if ((const char *)0 != name)
+    {
+        trace_writeString(out, name);
+    }
+    else
+    {
+        fprintf(out, "\"0x%llx\"", (unsigned long long)(uintptr_t)state);
+    }
+}
+
+/**
+ * @brief Write text as JSON string.
+ *
+ * @param out The output stream.
+ * @param text The text.
+ */
+static void trace_writeString(FILE * out, const char * text)
+{
+    fputc('"', out);
+
+    for (; '\0' != *text; ++text)
+    {
+        if (('"' == *text) || ('\\' == *text))
+        {
+            fputc('\\', out);
+            fputc(*text, out);
+        }
+        else if ((unsigned char)*text < 0x20u)
+        {
+            fprintf(out, "\\u%04x", (unsigned int)(unsigned char)*text);
+        }
+        else
+        {
+            fputc(*text, out);
+        }
+    }
+
+    fputc('"', out);
+}
+
+#endif /* CFSM_ENABLE_STATE_ID */
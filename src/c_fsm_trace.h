@@ -0,0 +1,281 @@
+/* MIT License
+ *
+ * Copyright (C) 2024  Haju Schulz <haju@schulznorbert.de>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+/*******************************************************************************
+    DESCRIPTION
+*******************************************************************************/
+/**
+ * @brief  CFSM trace recorder header file
+ *
+ * The trace recorder writes state transitions and events into a ring
+ * buffer, for viewing instance timelines in chrome://tracing or Perfetto.
+ * It is compiled into the CFSM functions only if CFSM_ENABLE_TRACE is
+ * defined for the library and the application.
+ *
+ * When the ring buffer is full, the records are passed to a sink. A file
+ * sink streams them in binary form to disk, so the trace length is only
+ * limited by disk space. Without sink, the oldest records are overwritten,
+ * which keeps the most recent history like a flight recorder.
+ *
+ * The exporter converts records to Chrome Trace Event JSON, either from
+ * a binary trace file or directly as sink. It writes each record as it
+ * comes and holds no trace data itself. Each instance gets a track,
+ * each state stay a slice and each event an instant marker.
+ *
+ * The recorder is not thread safe. Multi threaded applications trace
+ * one worker thread only.
+ *
+ * Repository: https://github.com/nhjschulz/cfsm
+ *
+ * @addtogroup CFSM
+ *
+ * @{
+ */
+
+/* Outside of the include guard, as the header only c_fsm.h includes this
+ * file before its implementation.
+ */
+#include "c_fsm.h"
+
+#if !defined(CFSM_ENABLE_STATE_ID)
+#error "c_fsm_trace.h requires CFSM_ENABLE_STATE_ID"
+#endif
+
+#ifndef SRC_C_FSM_C_FSM_TRACE_H_
+#define SRC_C_FSM_C_FSM_TRACE_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/******************************************************************************
+ * Includes
+ *****************************************************************************/
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+/******************************************************************************
+ * Macros
+ *****************************************************************************/
+
+/******************************************************************************
+ * Types and Classes
+ *****************************************************************************/
+
+/** Recorded operations */
+typedef enum cfsm_TraceKind {
+    CFSM_TRACE_ENTER = 0,   /**< Transition entered state          */
+    CFSM_TRACE_LEAVE,       /**< Transition left state             */
+    CFSM_TRACE_EVENT        /**< Event signaled to state           */
+} cfsm_TraceKind;
+
+/** A trace record
+ *
+ * Instance and state are addresses, which are only meaningful inside the
+ * recording process.
+ */
+typedef struct cfsm_TraceRecord {
+    uint64_t                 time;    /**< Clock ticks                   */
+    const struct cfsm_Ctx *  fsm;     /**< Instance, used as track       */
+    cfsm_TransitionFunction  state;   /**< State entered, left or active */
+    int32_t                  eventId; /**< Event ID or 0                 */
+    uint32_t                 kind;    /**< cfsm_TraceKind                */
+} cfsm_TraceRecord;
+
+/** Trace clock function. */
+typedef uint64_t (*cfsm_TraceClock)(void);
+
+/** Trace sink receiving records in recording order. */
+typedef void (*cfsm_TraceSink)(
+    void * sinkData,
+    const cfsm_TraceRecord * records,
+    size_t count);
+
+/** State name function, like the generated <prefix>_stateName(). */
+typedef const char * (*cfsm_TraceStateName)(cfsm_TransitionFunction state);
+
+/** Event name function, like the generated <prefix>_eventName(). */
+typedef const char * (*cfsm_TraceEventName)(int eventId);
+
+/** The CFSM trace recorder data structure
+ */
+typedef struct cfsm_Trace {
+    cfsm_TraceRecord * records;  /**< Application provided ring buffer  */
+    size_t             capacity; /**< Number of elements in records     */
+    size_t             head;     /**< Index of next record to write     */
+    size_t             count;    /**< Records in the ring buffer        */
+    uint64_t           lost;     /**< Records overwritten without sink  */
+    cfsm_TraceClock    clock;    /**< Time source                       */
+    cfsm_TraceSink     sink;     /**< Receiver of full buffers or NULL  */
+    void *             sinkData; /**< Passed to sink                    */
+} cfsm_Trace;
+
+/** Chrome Trace Event JSON exporter state
+ */
+typedef struct cfsm_TraceExport {
+    FILE *              out;       /**< JSON output stream              */
+    cfsm_TraceStateName stateName; /**< State names or NULL             */
+    cfsm_TraceEventName eventName; /**< Event names or NULL             */
+    double              ticksPerUs; /**< Clock ticks per microsecond    */
+    uint64_t            written;   /**< Trace events written so far     */
+} cfsm_TraceExport;
+
+/******************************************************************************
+ * Functions
+ *****************************************************************************/
+
+/**
+ * @brief Initialize a trace recorder.
+ *
+ * @param trace The trace data structure to initialize.
+ * @param records Ring buffer storage.
+ * @param capacity Number of elements in records.
+ * @param clock Time source or NULL for CLOCK_MONOTONIC nanoseconds,
+ *              which is only available on POSIX systems.
+ * @param sink Receiver of the records when the buffer is full or NULL
+ *             to overwrite the oldest records.
+ * @param sinkData Passed to sink.
+ * @return 0 on success, -1 if records is NULL or capacity is 0. The
+ *         trace then records nothing.
+ * @since 0.4.0
+ */
+int cfsm_trace_init(
+    cfsm_Trace * trace,
+    cfsm_TraceRecord * records,
+    size_t capacity,
+    cfsm_TraceClock clock,
+    cfsm_TraceSink sink,
+    void * sinkData);
+
+/**
+ * @brief Make a trace the target of all CFSM operations.
+ *
+ * @param trace The trace to record into or NULL to stop recording.
+ * @since 0.4.0
+ */
+void cfsm_trace_attach(cfsm_Trace * trace);
+
+/**
+ * @brief Pass all buffered records to a sink and empty the buffer.
+ *
+ * Use the trace's own sink at the end of a recording, or an exporter
+ * sink to save the history of a recording without sink.
+ *
+ * @param trace The trace data structure.
+ * @param sink The receiver of the records.
+ * @param sinkData Passed to sink.
+ * @since 0.4.0
+ */
+void cfsm_trace_drain(cfsm_Trace * trace, cfsm_TraceSink sink, void * sinkData);
+
+/**
+ * @brief Record an operation into the attached trace.
+ *
+ * Used by the CFSM tracing hooks.
+ *
+ * @param kind The operation.
+ * @param fsm The instance, whose active state is recorded.
+ * @param eventId The event ID or 0.
+ * @since 0.4.0
+ */
+void cfsm_trace_record(cfsm_TraceKind kind, const struct cfsm_Ctx * fsm, int eventId);
+
+/**
+ * @brief Sink writing records in binary form to a file.
+ *
+ * The file holds native records with instance and state addresses. It
+ * can only be exported by the recording process, or by a run of the same
+ * executable at the same load address, as position independent
+ * executables with address space layout randomization move the states
+ * on every start and the state names no longer resolve.
+ *
+ * @param file The FILE * to write to.
+ * @param records The records.
+ * @param count Number of records.
+ * @since 0.4.0
+ */
+void cfsm_trace_fileSink(void * file, const cfsm_TraceRecord * records, size_t count);
+
+/**
+ * @brief Start a Chrome Trace Event JSON export.
+ *
+ * @param exporter The exporter data structure to initialize.
+ * @param out The JSON output stream.
+ * @param stateName State name function or NULL to show addresses.
+ * @param eventName Event name function or NULL to show IDs.
+ * @param ticksPerUs Clock ticks per microsecond, 1000 for the default
+ *                   clock.
+ * @since 0.4.0
+ */
+void cfsm_trace_exportBegin(
+    cfsm_TraceExport * exporter,
+    FILE * out,
+    cfsm_TraceStateName stateName,
+    cfsm_TraceEventName eventName,
+    double ticksPerUs);
+
+/**
+ * @brief Sink exporting records as Chrome Trace Event JSON.
+ *
+ * Enter records start a slice on the instance track, leave records end
+ * it and event records become instant markers. Records without state,
+ * like the leave record of the first transition, are skipped.
+ *
+ * @param exporter The cfsm_TraceExport * started by
+ *                 cfsm_trace_exportBegin().
+ * @param records The records.
+ * @param count Number of records.
+ * @since 0.4.0
+ */
+void cfsm_trace_exportSink(void * exporter, const cfsm_TraceRecord * records, size_t count);
+
+/**
+ * @brief Export all records of a binary trace file.
+ *
+ * The file is read in small chunks, so its size is not limited by memory.
+ * The state names only resolve inside the recording process, see
+ * cfsm_trace_fileSink().
+ *
+ * @param exporter The exporter started by cfsm_trace_exportBegin().
+ * @param in A file written by cfsm_trace_fileSink().
+ * @return Number of records read.
+ * @since 0.4.0
+ */
+uint64_t cfsm_trace_exportFile(cfsm_TraceExport * exporter, FILE * in);
+
+/**
+ * @brief Finish a Chrome Trace Event JSON export.
+ *
+ * @param exporter The exporter data structure.
+ * @since 0.4.0
+ */
+void cfsm_trace_exportEnd(cfsm_TraceExport * exporter);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SRC_C_FSM_C_FSM_TRACE_H_ */
+
+/** @} */
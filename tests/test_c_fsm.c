@@ -45,6 +45,18 @@
  * Macros
  *****************************************************************************/
 
+#define EVENT_GOTO_B 100  /**< event id causing State A to enter State B */
+#define EVENT_STOP   101  /**< event id causing State B to enter State only */
+
+#if defined(CFSM_ENABLE_STATE_ID)
+/** Check the state identity of the test fsm */
+#define ASSERT_STATE(expected) TEST_ASSERT_EQUAL_PTR((expected), fsmInstance.state)
+#define CTX_POINTERS 5u  /**< Handlers, instance data and state */
+#else
+#define ASSERT_STATE(expected)
+#define CTX_POINTERS 4u  /**< Handlers and instance data        */
+#endif
+
 /******************************************************************************
  * Types and Classes
  *****************************************************************************/
@@ -55,6 +67,9 @@ typedef struct StateOperationCounter_
     int eventCalls;
     int processCalls;
     int lastEventId;
+    const void * lastData;
+    size_t lastSize;
+    const void * nestedData;
 } StateOperationCounter;
 
 /******************************************************************************
@@ -72,6 +87,9 @@ static void State_B_onProcess(cfsm_Ctx * fsm);
 static void State_B_onLeave(cfsm_Ctx * fsm);
 static void State_B_onEnter(cfsm_Ctx * fsm);
 
+static void State_C_onEvent(cfsm_Ctx * fsm, int eventId);
+static void State_C_onEnter(cfsm_Ctx * fsm);
+
 /******************************************************************************
  * Variables
  *****************************************************************************/
@@ -79,6 +97,7 @@ static void State_B_onEnter(cfsm_Ctx * fsm);
 static cfsm_Ctx fsmInstance;  /**< fsm instance used in tests */
 static StateOperationCounter state_A;
 static StateOperationCounter state_B;
+static StateOperationCounter state_C;
 static uint8_t dummyInstanceData = 42u;
 
 /******************************************************************************
@@ -91,6 +110,7 @@ void setUp(void)
 
     memset(&state_A, 0, sizeof(state_A));
     memset(&state_B, 0, sizeof(state_A));
+    memset(&state_C, 0, sizeof(state_C));
 }
 
 void tearDown(void)
@@ -110,14 +130,23 @@ void test_cfsm_init_should_clear_handler(void)
 
     cfsm_init(&fsmInstance, &dummyInstanceData);
 
-    TEST_ASSERT_EQUAL_PTR(NULL, fsmInstance.onEvent);
-    TEST_ASSERT_EQUAL_PTR(NULL, fsmInstance.onProcess);
-    TEST_ASSERT_EQUAL_PTR(NULL, fsmInstance.onLeave);
+    TEST_ASSERT_EQUAL_PTR(CFSM_NO_EVENT, fsmInstance.onEvent);
+    TEST_ASSERT_EQUAL_PTR(CFSM_NO_PROCESS, fsmInstance.onProcess);
+    TEST_ASSERT_EQUAL_PTR(CFSM_NO_LEAVE, fsmInstance.onLeave);
+    ASSERT_STATE(NULL);
 
     TEST_ASSERT_EQUAL_PTR(&dummyInstanceData, fsmInstance.ctxPtr);
 
 }
 
+void test_cfsm_padded_ctx_should_fill_cache_lines(void)
+{
+    cfsm_PaddedCtx padded[2];
+
+    TEST_ASSERT_EQUAL_UINT(0u, sizeof(cfsm_PaddedCtx) % CFSM_CACHE_LINE);
+    TEST_ASSERT_EQUAL_PTR((char *)&padded[0] + sizeof(cfsm_PaddedCtx), &padded[1].fsm);
+}
+
 void test_cfsm_init_is_safe_to_use(void)
 {
     cfsm_init(&fsmInstance, NULL);
@@ -125,14 +154,15 @@ void test_cfsm_init_is_safe_to_use(void)
     /* should not crash */
     cfsm_process(&fsmInstance);
     cfsm_event(&fsmInstance, 0x12345678);
+    cfsm_eventData(&fsmInstance, 0x12345678, NULL, 0u);
 }
 
 void test_cfsm_transition_should_set_enter_handler_only(void)
 {
     cfsm_transition(&fsmInstance, State_only_onEnter);
-    TEST_ASSERT_EQUAL_PTR(fsmInstance.onEvent, NULL);
-    TEST_ASSERT_EQUAL_PTR(fsmInstance.onProcess, NULL);
-    TEST_ASSERT_EQUAL_PTR(fsmInstance.onLeave, NULL);
+    TEST_ASSERT_EQUAL_PTR(fsmInstance.onEvent, CFSM_NO_EVENT);
+    TEST_ASSERT_EQUAL_PTR(fsmInstance.onProcess, CFSM_NO_PROCESS);
+    TEST_ASSERT_EQUAL_PTR(fsmInstance.onLeave, CFSM_NO_LEAVE);
 }
 
 void test_cfs_process()
@@ -226,14 +256,138 @@ void test_cfs_transition_A_B_A(void)
     TEST_ASSERT_EQUAL_INT(state_B.eventCalls, 0);
 }
 
+void test_cfsm_transition_should_track_state(void)
+{
+    cfsm_transition(&fsmInstance, State_A_onEnter);
+    ASSERT_STATE(State_A_onEnter);
+
+    cfsm_transition(&fsmInstance, State_B_onEnter);
+    ASSERT_STATE(State_B_onEnter);
+
+    cfsm_transition(&fsmInstance, NULL);
+    ASSERT_STATE(NULL);
+}
+
+void test_cfsm_ctx_should_hold_handlers_only(void)
+{
+    TEST_ASSERT_EQUAL_UINT(CTX_POINTERS * sizeof(void *), sizeof(cfsm_Ctx));
+}
+
+void test_cfsm_eventData_should_pass_payload_without_copy(void)
+{
+    static const char packet[] = "payload";
+    size_t size = 1u;
+
+    cfsm_transition(&fsmInstance, State_C_onEnter);
+    cfsm_eventData(&fsmInstance, 3, packet, sizeof(packet));
+
+    TEST_ASSERT_EQUAL_INT(1, state_C.eventCalls);
+    TEST_ASSERT_EQUAL_INT(3, state_C.lastEventId);
+    TEST_ASSERT_EQUAL_PTR(packet, state_C.lastData);
+    TEST_ASSERT_EQUAL_UINT(sizeof(packet), state_C.lastSize);
+
+    /* The payload is only available during the call. */
+    TEST_ASSERT_NULL(cfsm_eventPayload(&fsmInstance, &size));
+    TEST_ASSERT_EQUAL_UINT(0u, size);
+}
+
+void test_cfsm_eventPayload_should_be_null_for_plain_events(void)
+{
+    cfsm_transition(&fsmInstance, State_C_onEnter);
+    cfsm_event(&fsmInstance, 3);
+
+    TEST_ASSERT_EQUAL_INT(1, state_C.eventCalls);
+    TEST_ASSERT_NULL(state_C.lastData);
+    TEST_ASSERT_EQUAL_UINT(0u, state_C.lastSize);
+}
+
+#if !defined(CFSM_HEADER_ONLY)
+void test_cfsm_eventPayload_should_be_hidden_from_nested_plain_events(void)
+{
+    static const char packet[] = "payload";
+
+    /* Event 5 signals the plain event 3 from within its handler. */
+    cfsm_transition(&fsmInstance, State_C_onEnter);
+    cfsm_eventData(&fsmInstance, 5, packet, sizeof(packet));
+
+    TEST_ASSERT_EQUAL_INT(2, state_C.eventCalls);
+    TEST_ASSERT_NULL(state_C.nestedData);
+    TEST_ASSERT_EQUAL_PTR(packet, state_C.lastData);
+    TEST_ASSERT_EQUAL_UINT(sizeof(packet), state_C.lastSize);
+}
+#endif
+
+void test_cfsm_eventData_should_call_onEvent(void)
+{
+    cfsm_transition(&fsmInstance, State_A_onEnter);
+    cfsm_eventData(&fsmInstance, 3, "x", 1u);
+
+    TEST_ASSERT_EQUAL_INT(1, state_A.eventCalls);
+}
+
+void test_cfsm_eventBatch_should_follow_transitions(void)
+{
+    static const int events[] = { 1, 2, EVENT_GOTO_B, 3, 4 };
+
+    cfsm_transition(&fsmInstance, State_A_onEnter);
+    cfsm_eventBatch(&fsmInstance, events, sizeof(events) / sizeof(events[0]));
+
+    TEST_ASSERT_EQUAL_INT(3, state_A.eventCalls);
+    TEST_ASSERT_EQUAL_INT(2, state_B.eventCalls);
+}
+
+void test_cfsm_eventBatch_should_drop_without_handler(void)
+{
+    static const int events[] = { 1, 2, 3 };
+
+    cfsm_transition(&fsmInstance, State_only_onEnter);
+    TEST_ASSERT_EQUAL_UINT(0u, cfsm_eventBatch(&fsmInstance, events, 3u));
+    TEST_ASSERT_EQUAL_UINT(0u, cfsm_eventBatch(&fsmInstance, NULL, 0u));
+
+    TEST_ASSERT_EQUAL_INT(0, state_A.eventCalls);
+    ASSERT_STATE(State_only_onEnter);
+    TEST_ASSERT_EQUAL_PTR(CFSM_NO_EVENT, fsmInstance.onEvent);
+    TEST_ASSERT_EQUAL_PTR(CFSM_NO_PROCESS, fsmInstance.onProcess);
+    TEST_ASSERT_EQUAL_PTR(CFSM_NO_LEAVE, fsmInstance.onLeave);
+}
+
+void test_cfsm_eventBatch_should_drop_rest_after_transition(void)
+{
+    static const int events[] = { EVENT_GOTO_B, 1, EVENT_STOP, 2, 3 };
+
+    cfsm_transition(&fsmInstance, State_A_onEnter);
+    TEST_ASSERT_EQUAL_UINT(3u,
+        cfsm_eventBatch(&fsmInstance, events, sizeof(events) / sizeof(events[0])));
+
+    TEST_ASSERT_EQUAL_INT(1, state_A.eventCalls);
+    TEST_ASSERT_EQUAL_INT(2, state_B.eventCalls);
+    TEST_ASSERT_EQUAL_INT(1, state_B.leaveCalls);
+    ASSERT_STATE(State_only_onEnter);
+    TEST_ASSERT_EQUAL_PTR(CFSM_NO_EVENT, fsmInstance.onEvent);
+    TEST_ASSERT_EQUAL_PTR(CFSM_NO_PROCESS, fsmInstance.onProcess);
+    TEST_ASSERT_EQUAL_PTR(CFSM_NO_LEAVE, fsmInstance.onLeave);
+}
+
 int main(void)
 {
     UNITY_BEGIN();
 
     RUN_TEST(test_cfsm_init_is_safe_to_use);
+    RUN_TEST(test_cfsm_padded_ctx_should_fill_cache_lines);
     RUN_TEST(test_cfsm_init_should_clear_handler);
     RUN_TEST(test_cfsm_transition_should_set_enter_handler_only);
     RUN_TEST(test_cfs_transition_A_B_A);
+    RUN_TEST(test_cfsm_transition_should_track_state);
+    RUN_TEST(test_cfsm_ctx_should_hold_handlers_only);
+    RUN_TEST(test_cfsm_eventData_should_pass_payload_without_copy);
+    RUN_TEST(test_cfsm_eventPayload_should_be_null_for_plain_events);
+#if !defined(CFSM_HEADER_ONLY)
+    RUN_TEST(test_cfsm_eventPayload_should_be_hidden_from_nested_plain_events);
+#endif
+    RUN_TEST(test_cfsm_eventData_should_call_onEvent);
+    RUN_TEST(test_cfsm_eventBatch_should_follow_transitions);
+    RUN_TEST(test_cfsm_eventBatch_should_drop_without_handler);
+    RUN_TEST(test_cfsm_eventBatch_should_drop_rest_after_transition);
 
     return UNITY_END();
 }
@@ -257,10 +411,12 @@ static void State_A_onEnter(cfsm_Ctx * fsm)
 
 static void State_A_onEvent(cfsm_Ctx * fsm, int eventId)
 {
-    (void)fsm;
-    (void)eventId;
-
     state_A.eventCalls++;
+
+    if (EVENT_GOTO_B == eventId)
+    {
+        cfsm_transition(fsm, State_B_onEnter);
+    }
 }
 
 static void State_A_onProcess(cfsm_Ctx * fsm)
@@ -287,10 +443,12 @@ static void State_B_onEnter(cfsm_Ctx * fsm)
 
 static void State_B_onEvent(cfsm_Ctx * fsm, int eventId)
 {
-    (void)fsm;
-    (void)eventId;
-
     state_B.eventCalls++;
+
+    if (EVENT_STOP == eventId)
+    {
+        cfsm_transition(fsm, State_only_onEnter);
+    }
 }
 
 static void State_B_onProcess(cfsm_Ctx * fsm)
@@ -306,3 +464,24 @@ static void State_B_onLeave(cfsm_Ctx * fsm)
 
     state_B.leaveCalls++;
 }
+
+static void State_C_onEnter(cfsm_Ctx * fsm)
+{
+    fsm->onEvent = State_C_onEvent;
+    state_C.enterCalls++;
+}
+
+static void State_C_onEvent(cfsm_Ctx * fsm, int eventId)
+{
+    state_C.eventCalls++;
+    state_C.lastEventId = eventId;
+    state_C.lastData = cfsm_eventPayload(fsm, &state_C.lastSize);
+
+    if (5 == eventId)
+    {
+        /* The payload is shown again after the nested plain event. */
+        cfsm_event(fsm, 3);
+        state_C.nestedData = state_C.lastData;
+        state_C.lastData = cfsm_eventPayload(fsm, &state_C.lastSize);
+    }
+}
@@ -0,0 +1,348 @@
+/* MIT License
+ *
+ * Copyright (C) 2024  Haju Schulz <haju@schulznorbert.de>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+/*******************************************************************************
+    DESCRIPTION
+*******************************************************************************/
+/**
+ * @brief  CFSM compact fleet test suite
+ *
+ * @addtogroup tests
+ *
+ * @{
+ */
+
+/******************************************************************************
+ * Includes
+ *****************************************************************************/
+
+#include <string.h>
+#include <unity.h>
+
+#include "c_fsm_compact.h"
+#include "c_fsm_fleet.h"
+
+/******************************************************************************
+ * Macros
+ *****************************************************************************/
+
+#define FLEET_SIZE  4   /**< Number of instances in test fleet */
+#define EVENT_START 1   /**< Moves Idle instances to Busy      */
+#define BUSY_CYCLES 3   /**< Process cycles until Busy is done */
+#define EVENT_MUTE  2   /**< Idle drops its event handler      */
+#define EVENT_FLEET 3   /**< Idle calls fleet only functions   */
+
+/******************************************************************************
+ * Types and Classes
+ *****************************************************************************/
+
+/** Per instance test data */
+typedef struct InstanceCounter_
+{
+    int processCalls;
+    int leaveCalls;
+    int lastEventId;
+    size_t lastIndex;
+    void * local;
+} InstanceCounter;
+
+/******************************************************************************
+ * Prototypes
+ *****************************************************************************/
+
+static void State_Idle_onEnter(cfsm_Ctx * fsm);
+static void State_Idle_onEvent(cfsm_Ctx * fsm, int eventId);
+static void State_Busy_onEnter(cfsm_Ctx * fsm);
+static void State_Busy_onProcess(cfsm_Ctx * fsm);
+static void State_Busy_onLeave(cfsm_Ctx * fsm);
+static void State_Unknown_onEnter(cfsm_Ctx * fsm);
+
+/******************************************************************************
+ * Variables
+ *****************************************************************************/
+
+static cfsm_CompactFleet fleet;                  /**< fleet under test  */
+static cfsm_CompactCtx contexts[FLEET_SIZE];     /**< fleet storage     */
+static cfsm_CompactState states[2];              /**< fleet state table */
+static InstanceCounter counters[FLEET_SIZE];     /**< per instance data */
+
+/******************************************************************************
+ * External functions
+ *****************************************************************************/
+
+void setUp(void)
+{
+    memset(counters, 0, sizeof(counters));
+
+    states[0].enter = State_Idle_onEnter;
+    states[1].enter = State_Busy_onEnter;
+
+    cfsm_compact_init(
+        &fleet,
+        contexts,
+        FLEET_SIZE,
+        states,
+        2u,
+        counters,
+        sizeof(counters[0]));
+}
+
+void tearDown(void)
+{
+}
+
+void test_cfsm_compact_ctx_should_be_8_bytes(void)
+{
+    TEST_ASSERT_EQUAL_UINT(8u, sizeof(cfsm_CompactCtx));
+}
+
+void test_cfsm_compact_init_should_stop_all(void)
+{
+    for (int i = 0; i < FLEET_SIZE; ++i)
+    {
+        TEST_ASSERT_EQUAL_UINT16(CFSM_COMPACT_NO_STATE, contexts[i].state);
+        TEST_ASSERT_EQUAL_UINT32(i, contexts[i].instance);
+    }
+
+    /* should not crash */
+    cfsm_compact_processAll(&fleet);
+    cfsm_compact_event(&fleet, 0u, EVENT_START);
+    cfsm_compact_eventData(&fleet, 0u, EVENT_START, NULL, 0u);
+}
+
+void test_cfsm_compact_transition_should_store_state_index(void)
+{
+    cfsm_compact_transition(&fleet, 2u, State_Busy_onEnter);
+
+    TEST_ASSERT_EQUAL_UINT16(1u, contexts[2].state);
+    TEST_ASSERT_EQUAL_PTR(State_Busy_onProcess, states[1].onProcess);
+    TEST_ASSERT_EQUAL_PTR(State_Busy_onLeave, states[1].onLeave);
+}
+
+void test_cfsm_compact_handlers_should_see_instance(void)
+{
+    cfsm_compact_transition(&fleet, 3u, State_Idle_onEnter);
+    cfsm_compact_event(&fleet, 3u, 42);
+
+    TEST_ASSERT_EQUAL_INT(42, counters[3].lastEventId);
+    TEST_ASSERT_EQUAL_UINT(3u, counters[3].lastIndex);
+    TEST_ASSERT_EQUAL_INT(0, counters[0].lastEventId);
+}
+
+void test_cfsm_compact_should_follow_handler_transitions(void)
+{
+    for (size_t i = 0u; i < FLEET_SIZE; ++i)
+    {
+        cfsm_compact_transition(&fleet, i, State_Idle_onEnter);
+    }
+    cfsm_compact_event(&fleet, 1u, EVENT_START);
+    TEST_ASSERT_EQUAL_UINT16(1u, contexts[1].state);
+
+    for (int cycle = 0; cycle < BUSY_CYCLES + 2; ++cycle)
+    {
+        cfsm_compact_processAll(&fleet);
+    }
+
+    TEST_ASSERT_EQUAL_INT(BUSY_CYCLES, counters[1].processCalls);
+    TEST_ASSERT_EQUAL_INT(1, counters[1].leaveCalls);
+    TEST_ASSERT_EQUAL_UINT16(0u, contexts[1].state);
+    TEST_ASSERT_EQUAL_INT(0, counters[0].processCalls);
+}
+
+void test_cfsm_compact_should_remember_successor_index(void)
+{
+    cfsm_compact_transition(&fleet, 0u, State_Idle_onEnter);
+    TEST_ASSERT_EQUAL_UINT16(0u, fleet.start);
+
+    cfsm_compact_event(&fleet, 0u, EVENT_START);
+    TEST_ASSERT_EQUAL_UINT16(1u, states[0].next);
+
+    /* Busy returns to Idle by itself after its process cycles. */
+    for (int cycle = 0; cycle < BUSY_CYCLES; ++cycle)
+    {
+        cfsm_compact_process(&fleet, 0u);
+    }
+    TEST_ASSERT_EQUAL_UINT16(0u, contexts[0].state);
+    TEST_ASSERT_EQUAL_UINT16(0u, states[1].next);
+
+    /* A stale hint is searched again. */
+    states[0].next = 0u;
+    cfsm_compact_event(&fleet, 0u, EVENT_START);
+    TEST_ASSERT_EQUAL_UINT16(1u, contexts[0].state);
+    TEST_ASSERT_EQUAL_UINT16(1u, states[0].next);
+}
+
+void test_cfsm_compact_transition_to_null_should_leave(void)
+{
+    cfsm_compact_transition(&fleet, 0u, State_Busy_onEnter);
+    cfsm_compact_transition(&fleet, 0u, NULL);
+
+    TEST_ASSERT_EQUAL_INT(1, counters[0].leaveCalls);
+    TEST_ASSERT_EQUAL_UINT16(CFSM_COMPACT_NO_STATE, contexts[0].state);
+}
+
+void test_cfsm_compact_unknown_state_should_stop(void)
+{
+    cfsm_compact_transition(&fleet, 0u, State_Unknown_onEnter);
+
+    TEST_ASSERT_EQUAL_UINT16(CFSM_COMPACT_NO_STATE, contexts[0].state);
+}
+
+void test_cfsm_compact_should_write_back_changed_handlers(void)
+{
+    cfsm_compact_transition(&fleet, 0u, State_Idle_onEnter);
+    cfsm_compact_transition(&fleet, 1u, State_Idle_onEnter);
+    TEST_ASSERT_EQUAL_UINT32(0u, fleet.mismatches);
+
+    /* Instance 0 changes its handlers without a transition. */
+    cfsm_compact_event(&fleet, 0u, EVENT_MUTE);
+    TEST_ASSERT_EQUAL_PTR(CFSM_NO_EVENT, states[0].onEvent);
+    TEST_ASSERT_EQUAL_UINT32(1u, fleet.mismatches);
+
+    /* The change applies to all instances in the state. */
+    cfsm_compact_event(&fleet, 1u, 42);
+    TEST_ASSERT_EQUAL_INT(0, counters[1].lastEventId);
+
+    /* A fresh enter installs the original handlers again. */
+    cfsm_compact_transition(&fleet, 1u, State_Idle_onEnter);
+    TEST_ASSERT_EQUAL_PTR(State_Idle_onEvent, states[0].onEvent);
+    TEST_ASSERT_EQUAL_UINT32(2u, fleet.mismatches);
+}
+
+void test_cfsm_compact_should_ignore_fleet_only_calls(void)
+{
+    cfsm_compact_transition(&fleet, 2u, State_Idle_onEnter);
+    counters[2].local = &counters[2];
+
+    cfsm_compact_event(&fleet, 2u, EVENT_FLEET);
+
+    TEST_ASSERT_NULL(counters[2].local);
+    TEST_ASSERT_EQUAL_UINT16(0u, contexts[2].state);
+    TEST_ASSERT_EQUAL_UINT16(0u, contexts[2].flags);
+    TEST_ASSERT_EQUAL_UINT32(2u, contexts[2].instance);
+}
+
+void test_cfsm_compact_indexOf_should_detect_fleet_instance(void)
+{
+    cfsm_Fleet other;
+    cfsm_FleetEntry entries[1];
+    cfsm_Ctx * fsm;
+
+    cfsm_fleet_init(&other, entries, 1u);
+    fsm = cfsm_fleet_add(&other, NULL);
+
+    TEST_ASSERT_NOT_NULL(fsm);
+    TEST_ASSERT_EQUAL_UINT(CFSM_COMPACT_NO_INDEX, cfsm_compact_indexOf(fsm));
+}
+
+void test_cfsm_compact_instances_may_share_data(void)
+{
+    contexts[1].instance = 0u;
+
+    cfsm_compact_transition(&fleet, 1u, State_Busy_onEnter);
+    cfsm_compact_process(&fleet, 1u);
+
+    TEST_ASSERT_EQUAL_INT(1, counters[0].processCalls);
+    TEST_ASSERT_EQUAL_INT(0, counters[1].processCalls);
+}
+
+int main(void)
+{
+    UNITY_BEGIN();
+
+    RUN_TEST(test_cfsm_compact_ctx_should_be_8_bytes);
+    RUN_TEST(test_cfsm_compact_init_should_stop_all);
+    RUN_TEST(test_cfsm_compact_transition_should_store_state_index);
+    RUN_TEST(test_cfsm_compact_handlers_should_see_instance);
+    RUN_TEST(test_cfsm_compact_should_follow_handler_transitions);
+    RUN_TEST(test_cfsm_compact_should_remember_successor_index);
+    RUN_TEST(test_cfsm_compact_transition_to_null_should_leave);
+    RUN_TEST(test_cfsm_compact_unknown_state_should_stop);
+    RUN_TEST(test_cfsm_compact_should_write_back_changed_handlers);
+    RUN_TEST(test_cfsm_compact_should_ignore_fleet_only_calls);
+    RUN_TEST(test_cfsm_compact_indexOf_should_detect_fleet_instance);
+    RUN_TEST(test_cfsm_compact_instances_may_share_data);
+
+    return UNITY_END();
+}
+
+/******************************************************************************
+ * Local functions
+ *****************************************************************************/
+
+static void State_Idle_onEnter(cfsm_Ctx * fsm)
+{
+    fsm->onEvent = State_Idle_onEvent;
+}
+
+static void State_Idle_onEvent(cfsm_Ctx * fsm, int eventId)
+{
+    InstanceCounter * counter = (InstanceCounter *)fsm->ctxPtr;
+
+    counter->lastEventId = eventId;
+    counter->lastIndex = cfsm_compact_indexOf(fsm);
+
+    if (EVENT_START == eventId)
+    {
+        cfsm_transition(fsm, State_Busy_onEnter);
+    }
+    else if (EVENT_MUTE == eventId)
+    {
+        fsm->onEvent = CFSM_NO_EVENT;
+    }
+    else if (EVENT_FLEET == eventId)
+    {
+        cfsm_sleepUntil(fsm, 0u);
+        cfsm_sleepUntilEvent(fsm);
+        counter->local = cfsm_enterLocal(fsm, 1u);
+    }
+}
+
+static void State_Busy_onEnter(cfsm_Ctx * fsm)
+{
+    fsm->onProcess = State_Busy_onProcess;
+    fsm->onLeave = State_Busy_onLeave;
+}
+
+static void State_Busy_onProcess(cfsm_Ctx * fsm)
+{
+    InstanceCounter * counter = (InstanceCounter *)fsm->ctxPtr;
+
+    if (BUSY_CYCLES == ++counter->processCalls)
+    {
+        cfsm_transition(fsm, State_Idle_onEnter);
+    }
+}
+
+static void State_Busy_onLeave(cfsm_Ctx * fsm)
+{
+    ((InstanceCounter *)fsm->ctxPtr)->leaveCalls++;
+}
+
+static void State_Unknown_onEnter(cfsm_Ctx * fsm)
+{
+    (void)fsm;
+}
+
+/** @} */
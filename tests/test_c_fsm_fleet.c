@@ -0,0 +1,907 @@
+/* MIT License
+ *
+ * Copyright (C) 2024  Haju Schulz <haju@schulznorbert.de>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+/*******************************************************************************
+    DESCRIPTION
+*******************************************************************************/
+/**
+ * @brief  CFSM fleet test suite
+ *
+ * @addtogroup tests
+ *
+ * @{
+ */
+
+/******************************************************************************
+ * Includes
+ *****************************************************************************/
+
+#include <string.h>
+#include <unity.h>
+
+#include "c_fsm_fleet.h"
+
+/******************************************************************************
+ * Macros
+ *****************************************************************************/
+
+#define FLEET_SIZE 4    /**< Number of instances in test fleet */
+#define BIG_FLEET_SIZE 70 /**< Fleet size with full expire blocks */
+#define EVENT_TIMEOUT 7 /**< Timeout event ID */
+
+/******************************************************************************
+ * Types and Classes
+ *****************************************************************************/
+
+/** State local data of the retry state */
+typedef struct RetryLocal_
+{
+    int retries;
+    char buffer[13];
+} RetryLocal;
+
+/** Per instance test data */
+typedef struct InstanceCounter_
+{
+    int processCalls;
+    int eventCalls;
+    int lastEventId;
+} InstanceCounter;
+
+/******************************************************************************
+ * Prototypes
+ *****************************************************************************/
+
+static void State_Worker_onEnter(cfsm_Ctx * fsm);
+static void State_Worker_onProcess(cfsm_Ctx * fsm);
+static void State_Worker_onEvent(cfsm_Ctx * fsm, int eventId);
+static void State_Recovery_onEnter(cfsm_Ctx * fsm);
+static void State_Retry_onEnter(cfsm_Ctx * fsm);
+static void State_Retry_onProcess(cfsm_Ctx * fsm);
+
+/******************************************************************************
+ * Variables
+ *****************************************************************************/
+
+static cfsm_Fleet fleet;                           /**< fleet under test    */
+static cfsm_FleetEntry fleetEntries[FLEET_SIZE];   /**< fleet storage       */
+static InstanceCounter counters[FLEET_SIZE];       /**< per instance data   */
+static cfsm_Ctx * instances[FLEET_SIZE];           /**< added instances     */
+static cfsm_Time deadlines[FLEET_SIZE];           /**< timeout column      */
+static uint32_t armed[CFSM_FLEET_ARMED_WORDS(FLEET_SIZE)]; /**< armed bitmap */
+static double localArena[                          /**< state local storage */
+    CFSM_FLEET_LOCAL_ARENA_SIZE(FLEET_SIZE, sizeof(RetryLocal)) / sizeof(double)];
+
+/******************************************************************************
+ * External functions
+ *****************************************************************************/
+
+void setUp(void)
+{
+    memset(counters, 0, sizeof(counters));
+
+    cfsm_fleet_init(&fleet, fleetEntries, FLEET_SIZE);
+
+    for (int i = 0; i < FLEET_SIZE; ++i)
+    {
+        instances[i] = cfsm_fleet_add(&fleet, &counters[i]);
+        cfsm_transition(instances[i], State_Worker_onEnter);
+    }
+}
+
+void tearDown(void)
+{
+}
+
+void test_cfsm_fleet_add_should_fail_if_full(void)
+{
+    TEST_ASSERT_EQUAL_PTR(NULL, cfsm_fleet_add(&fleet, NULL));
+}
+
+void test_cfsm_fleet_add_should_init_fsm(void)
+{
+    cfsm_fleet_init(&fleet, fleetEntries, FLEET_SIZE);
+    memset(fleetEntries, -1, sizeof(fleetEntries));  /* corrupt content */
+
+    cfsm_Ctx * fsm = cfsm_fleet_add(&fleet, &counters[0]);
+
+    TEST_ASSERT_EQUAL_PTR(&fleetEntries[0].fsm, fsm);
+    TEST_ASSERT_EQUAL_PTR(&counters[0], fsm->ctxPtr);
+    TEST_ASSERT_EQUAL_PTR(NULL, fsm->onEvent);
+    TEST_ASSERT_EQUAL_PTR(NULL, fsm->onProcess);
+    TEST_ASSERT_EQUAL_PTR(NULL, fsm->onLeave);
+}
+
+void test_cfsm_fleet_process_should_process_all_runnable(void)
+{
+    cfsm_fleet_process(&fleet, 0u);
+    cfsm_fleet_process(&fleet, 1u);
+
+    for (int i = 0; i < FLEET_SIZE; ++i)
+    {
+        TEST_ASSERT_EQUAL_INT(2, counters[i].processCalls);
+    }
+}
+
+void test_cfsm_sleepUntilEvent_should_skip_process_until_event(void)
+{
+    cfsm_sleepUntilEvent(instances[1]);
+
+    cfsm_fleet_process(&fleet, 0u);
+    cfsm_fleet_process(&fleet, 1000u);
+
+    TEST_ASSERT_EQUAL_INT(2, counters[0].processCalls);
+    TEST_ASSERT_EQUAL_INT(0, counters[1].processCalls);
+
+    cfsm_fleet_event(&fleet, instances[1], 7);
+    cfsm_fleet_process(&fleet, 1001u);
+
+    TEST_ASSERT_EQUAL_INT(1, counters[1].eventCalls);
+    TEST_ASSERT_EQUAL_INT(7, counters[1].lastEventId);
+    TEST_ASSERT_EQUAL_INT(1, counters[1].processCalls);
+}
+
+void test_cfsm_sleepUntil_should_wake_on_deadline(void)
+{
+    cfsm_sleepUntil(instances[2], 10u);
+
+    cfsm_fleet_process(&fleet, 0u);
+    cfsm_fleet_process(&fleet, 9u);
+    TEST_ASSERT_EQUAL_INT(0, counters[2].processCalls);
+
+    cfsm_fleet_process(&fleet, 10u);
+    cfsm_fleet_process(&fleet, 11u);
+    TEST_ASSERT_EQUAL_INT(2, counters[2].processCalls);
+    TEST_ASSERT_EQUAL_INT(4, counters[0].processCalls);
+}
+
+void test_cfsm_sleepUntil_should_wake_on_event(void)
+{
+    cfsm_sleepUntil(instances[0], 100u);
+
+    cfsm_fleet_process(&fleet, 0u);
+    cfsm_fleet_event(&fleet, instances[0], 1);
+    cfsm_fleet_process(&fleet, 1u);
+
+    TEST_ASSERT_EQUAL_INT(1, counters[0].processCalls);
+}
+
+void test_cfsm_fleet_eventData_should_wake_sleeper(void)
+{
+    cfsm_sleepUntilEvent(instances[1]);
+    cfsm_fleet_process(&fleet, 0u);
+
+    cfsm_fleet_eventData(&fleet, instances[1], 9, "abc", 3u);
+    cfsm_fleet_process(&fleet, 1u);
+
+    TEST_ASSERT_EQUAL_INT(9, counters[1].lastEventId);
+    TEST_ASSERT_EQUAL_INT(1, counters[1].processCalls);
+}
+
+void test_cfsm_fleet_eventBatch_should_deliver_all(void)
+{
+    static const int events[] = { 4, 5, 6 };
+
+    cfsm_sleepUntilEvent(instances[2]);
+    cfsm_fleet_process(&fleet, 0u);
+
+    TEST_ASSERT_EQUAL_UINT(3u, cfsm_fleet_eventBatch(&fleet, instances[2], events, 3u));
+    cfsm_fleet_process(&fleet, 1u);
+
+    TEST_ASSERT_EQUAL_INT(3, counters[2].eventCalls);
+    TEST_ASSERT_EQUAL_INT(6, counters[2].lastEventId);
+    TEST_ASSERT_EQUAL_INT(1, counters[2].processCalls);
+}
+
+void test_cfsm_sleepUntil_should_order_sleepers_by_deadline(void)
+{
+    cfsm_Time delay = 0u;
+
+    cfsm_sleepUntil(instances[0], 30u);
+    cfsm_sleepUntil(instances[1], 10u);
+    cfsm_sleepUntil(instances[2], 20u);
+    cfsm_sleepUntil(instances[3], 10u);
+    cfsm_fleet_process(&fleet, 0u);
+
+    TEST_ASSERT_EQUAL_INT(1, cfsm_fleet_nextProcess(&fleet, 0u, &delay));
+    TEST_ASSERT_EQUAL_UINT32(10u, delay);
+
+    /* Rescheduling a sleeper takes effect without a process cycle. */
+    cfsm_sleepUntil(instances[1], 40u);
+    cfsm_sleepUntil(instances[3], 5u);
+    TEST_ASSERT_EQUAL_INT(1, cfsm_fleet_nextProcess(&fleet, 0u, &delay));
+    TEST_ASSERT_EQUAL_UINT32(5u, delay);
+
+    cfsm_fleet_process(&fleet, 19u);
+    TEST_ASSERT_EQUAL_INT(0, counters[0].processCalls);
+    TEST_ASSERT_EQUAL_INT(0, counters[1].processCalls);
+    TEST_ASSERT_EQUAL_INT(0, counters[2].processCalls);
+    TEST_ASSERT_EQUAL_INT(1, counters[3].processCalls);
+
+    cfsm_fleet_process(&fleet, 30u);
+    TEST_ASSERT_EQUAL_INT(1, counters[0].processCalls);
+    TEST_ASSERT_EQUAL_INT(0, counters[1].processCalls);
+    TEST_ASSERT_EQUAL_INT(1, counters[2].processCalls);
+    TEST_ASSERT_EQUAL_INT(2, counters[3].processCalls);
+
+    cfsm_sleepUntilEvent(instances[1]);
+    cfsm_fleet_process(&fleet, 40u);
+    TEST_ASSERT_EQUAL_INT(0, counters[1].processCalls);
+}
+
+void test_cfsm_fleet_process_should_wake_unordered_sleepers_in_time(void)
+{
+    static cfsm_FleetEntry bigEntries[BIG_FLEET_SIZE];
+    static InstanceCounter bigCounters[BIG_FLEET_SIZE];
+    cfsm_Fleet bigFleet;
+    cfsm_FleetStats stats;
+
+    memset(bigCounters, 0, sizeof(bigCounters));
+    cfsm_fleet_init(&bigFleet, bigEntries, BIG_FLEET_SIZE);
+
+    /* Deadlines are a permutation of 1..BIG_FLEET_SIZE. */
+    for (int i = 0; i < BIG_FLEET_SIZE; ++i)
+    {
+        cfsm_Ctx * fsm = cfsm_fleet_add(&bigFleet, &bigCounters[i]);
+
+        cfsm_transition(fsm, State_Worker_onEnter);
+        cfsm_sleepUntil(fsm, (cfsm_Time)(1 + ((i * 37) % BIG_FLEET_SIZE)));
+    }
+    cfsm_fleet_process(&bigFleet, 0u);
+
+    for (cfsm_Time now = 1u; now <= BIG_FLEET_SIZE; ++now)
+    {
+        cfsm_fleet_process(&bigFleet, now);
+        cfsm_fleet_stats(&bigFleet, &stats);
+        TEST_ASSERT_EQUAL_UINT(BIG_FLEET_SIZE - now, stats.sleeping);
+    }
+
+    for (int i = 0; i < BIG_FLEET_SIZE; ++i)
+    {
+        int deadline = 1 + ((i * 37) % BIG_FLEET_SIZE);
+
+        TEST_ASSERT_EQUAL_INT(BIG_FLEET_SIZE + 1 - deadline, bigCounters[i].processCalls);
+    }
+}
+
+void test_cfsm_sleepUntil_should_handle_time_wrap_around(void)
+{
+    cfsm_sleepUntil(instances[3], 5u);
+
+    cfsm_fleet_process(&fleet, 0xFFFFFFF0u);
+    TEST_ASSERT_EQUAL_INT(0, counters[3].processCalls);
+
+    cfsm_fleet_process(&fleet, 5u);
+    TEST_ASSERT_EQUAL_INT(1, counters[3].processCalls);
+}
+
+void test_cfsm_sleepUntil_from_handler(void)
+{
+    /* Event id 1 requests sleep from inside the process handler. */
+    cfsm_fleet_event(&fleet, instances[0], 1);
+    cfsm_fleet_event(&fleet, instances[2], 1);
+
+    cfsm_fleet_process(&fleet, 0u);
+    cfsm_fleet_process(&fleet, 1u);
+
+    TEST_ASSERT_EQUAL_INT(1, counters[0].processCalls);
+    TEST_ASSERT_EQUAL_INT(2, counters[1].processCalls);
+    TEST_ASSERT_EQUAL_INT(1, counters[2].processCalls);
+    TEST_ASSERT_EQUAL_INT(2, counters[3].processCalls);
+
+    cfsm_fleet_process(&fleet, 50u);
+    TEST_ASSERT_EQUAL_INT(2, counters[0].processCalls);
+    TEST_ASSERT_EQUAL_INT(2, counters[2].processCalls);
+}
+
+void test_cfsm_fleet_transitionAll_should_move_matching_only(void)
+{
+    cfsm_transition(instances[1], State_Recovery_onEnter);
+
+    size_t moved = cfsm_fleet_transitionAll(
+        &fleet, State_Worker_onEnter, State_Recovery_onEnter);
+
+    TEST_ASSERT_EQUAL_UINT(FLEET_SIZE - 1, moved);
+    for (int i = 0; i < FLEET_SIZE; ++i)
+    {
+        TEST_ASSERT_EQUAL_PTR(State_Recovery_onEnter, instances[i]->state);
+    }
+
+    moved = cfsm_fleet_transitionAll(
+        &fleet, State_Worker_onEnter, State_Recovery_onEnter);
+    TEST_ASSERT_EQUAL_UINT(0, moved);
+}
+
+void test_cfsm_fleet_transitionAll_should_wake_sleepers(void)
+{
+    cfsm_sleepUntilEvent(instances[0]);
+    cfsm_fleet_process(&fleet, 0u);
+    TEST_ASSERT_EQUAL_INT(0, counters[0].processCalls);
+
+    cfsm_fleet_transitionAll(&fleet, State_Worker_onEnter, State_Worker_onEnter);
+    cfsm_fleet_process(&fleet, 1u);
+
+    TEST_ASSERT_EQUAL_INT(1, counters[0].processCalls);
+}
+
+void test_cfsm_fleet_transitionAll_should_walk_state_list(void)
+{
+    static cfsm_FleetStateList lists[2];
+    static cfsm_FleetMember members[FLEET_SIZE];
+
+    lists[0].state = State_Worker_onEnter;
+    lists[1].state = State_Recovery_onEnter;
+    cfsm_fleet_attachStates(&fleet, lists, 2u, members);
+    TEST_ASSERT_EQUAL_UINT32(FLEET_SIZE, lists[0].count);
+
+    TEST_ASSERT_EQUAL_UINT(FLEET_SIZE,
+        cfsm_fleet_transitionAll(&fleet, State_Worker_onEnter, State_Recovery_onEnter));
+    TEST_ASSERT_EQUAL_UINT32(0u, lists[0].count);
+    TEST_ASSERT_EQUAL_UINT32(FLEET_SIZE, lists[1].count);
+
+    /* Transitions outside of the fleet are tracked when seen. */
+    cfsm_transition(instances[2], State_Worker_onEnter);
+    TEST_ASSERT_EQUAL_UINT(FLEET_SIZE - 1,
+        cfsm_fleet_transitionAll(&fleet, State_Recovery_onEnter, State_Worker_onEnter));
+    TEST_ASSERT_EQUAL_UINT32(FLEET_SIZE, lists[0].count);
+    TEST_ASSERT_EQUAL_UINT32(0u, lists[1].count);
+
+    cfsm_fleet_transition(&fleet, instances[1], State_Recovery_onEnter);
+    cfsm_fleet_remove(&fleet, instances[3]);
+    TEST_ASSERT_EQUAL_UINT32(FLEET_SIZE - 2, lists[0].count);
+    TEST_ASSERT_EQUAL_UINT32(1u, lists[1].count);
+
+    TEST_ASSERT_EQUAL_UINT(1u,
+        cfsm_fleet_transitionAll(&fleet, State_Recovery_onEnter, State_Worker_onEnter));
+    TEST_ASSERT_EQUAL_PTR(State_Worker_onEnter, instances[1]->state);
+    TEST_ASSERT_EQUAL_PTR(NULL, instances[3]->state);
+}
+
+void test_cfsm_fleet_handle_lookup(void)
+{
+    cfsm_Handle handle = cfsm_fleet_handleOf(&fleet, instances[2]);
+
+    TEST_ASSERT_NOT_EQUAL(CFSM_FLEET_INVALID_HANDLE, handle);
+    TEST_ASSERT_EQUAL_PTR(instances[2], cfsm_fleet_lookup(&fleet, handle));
+    TEST_ASSERT_EQUAL_PTR(NULL, cfsm_fleet_lookup(&fleet, CFSM_FLEET_INVALID_HANDLE));
+    TEST_ASSERT_EQUAL_PTR(NULL, cfsm_fleet_lookup(&fleet, 0xFFFFFFFFu));
+}
+
+void test_cfsm_fleet_remove_should_reuse_entry_with_new_handle(void)
+{
+    cfsm_Handle stale = cfsm_fleet_handleOf(&fleet, instances[1]);
+
+    cfsm_fleet_remove(&fleet, instances[1]);
+    cfsm_fleet_remove(&fleet, instances[1]); /* ignored */
+    TEST_ASSERT_EQUAL_PTR(NULL, cfsm_fleet_lookup(&fleet, stale));
+
+    cfsm_Ctx * fsm = cfsm_fleet_add(&fleet, &counters[1]);
+    TEST_ASSERT_EQUAL_PTR(instances[1], fsm);
+    TEST_ASSERT_EQUAL_PTR(NULL, cfsm_fleet_add(&fleet, NULL));
+
+    cfsm_Handle fresh = cfsm_fleet_handleOf(&fleet, fsm);
+    TEST_ASSERT_NOT_EQUAL(stale, fresh);
+    TEST_ASSERT_EQUAL_PTR(NULL, cfsm_fleet_lookup(&fleet, stale));
+    TEST_ASSERT_EQUAL_PTR(fsm, cfsm_fleet_lookup(&fleet, fresh));
+}
+
+void test_cfsm_fleet_remove_should_reuse_oldest_entry_first(void)
+{
+    cfsm_fleet_remove(&fleet, instances[2]);
+    cfsm_fleet_remove(&fleet, instances[0]);
+
+    TEST_ASSERT_EQUAL_PTR(instances[2], cfsm_fleet_add(&fleet, NULL));
+    TEST_ASSERT_EQUAL_PTR(instances[0], cfsm_fleet_add(&fleet, NULL));
+    TEST_ASSERT_EQUAL_PTR(NULL, cfsm_fleet_add(&fleet, NULL));
+}
+
+void test_cfsm_fleet_remove_should_wrap_generation_and_skip_zero(void)
+{
+    cfsm_Handle first = cfsm_fleet_handleOf(&fleet, instances[1]);
+    cfsm_Handle previous = first;
+    cfsm_Ctx * fsm = instances[1];
+
+    /* 8 generation bits, generation 0 is never used. */
+    for (size_t reuses = 1u; reuses <= 300u; ++reuses)
+    {
+        cfsm_Handle handle;
+
+        cfsm_fleet_remove(&fleet, fsm);
+        fsm = cfsm_fleet_add(&fleet, NULL);
+        TEST_ASSERT_EQUAL_PTR(instances[1], fsm);
+
+        handle = cfsm_fleet_handleOf(&fleet, fsm);
+        TEST_ASSERT_NOT_EQUAL(0u, handle >> CFSM_FLEET_INDEX_BITS);
+        TEST_ASSERT_NOT_EQUAL(previous, handle);
+        TEST_ASSERT_EQUAL_PTR(NULL, cfsm_fleet_lookup(&fleet, previous));
+        TEST_ASSERT_EQUAL_PTR(fsm, cfsm_fleet_lookup(&fleet, handle));
+        if (255u == reuses)
+        {
+            TEST_ASSERT_EQUAL_UINT32(first, handle);
+        }
+        previous = handle;
+    }
+
+    TEST_ASSERT_EQUAL_PTR(instances[0], cfsm_fleet_at(&fleet, 0u));
+}
+
+void test_cfsm_fleet_remove_should_stop_processing(void)
+{
+    cfsm_fleet_remove(&fleet, instances[0]);
+    cfsm_fleet_process(&fleet, 0u);
+
+    TEST_ASSERT_EQUAL_INT(0, counters[0].processCalls);
+    TEST_ASSERT_EQUAL_INT(1, counters[1].processCalls);
+    TEST_ASSERT_EQUAL_UINT(0, cfsm_fleet_transitionAll(&fleet, NULL, State_Worker_onEnter));
+}
+
+void test_cfsm_fleet_indexOf_should_address_columns(void)
+{
+    static cfsm_Time onTime[FLEET_SIZE];    /* instance data column */
+
+    for (int i = 0; i < FLEET_SIZE; ++i)
+    {
+        TEST_ASSERT_EQUAL_UINT(i, cfsm_fleet_indexOf(&fleet, instances[i]));
+        CFSM_FLEET_COLUMN(&fleet, onTime, instances[i]) = (cfsm_Time)(i * 10);
+    }
+    TEST_ASSERT_EQUAL_UINT32(20u, onTime[2]);
+
+    cfsm_fleet_remove(&fleet, instances[1]);
+
+    TEST_ASSERT_EQUAL_PTR(instances[0], cfsm_fleet_at(&fleet, 0u));
+    TEST_ASSERT_EQUAL_PTR(NULL, cfsm_fleet_at(&fleet, 1u));
+    TEST_ASSERT_EQUAL_PTR(NULL, cfsm_fleet_at(&fleet, FLEET_SIZE));
+}
+
+void test_cfsm_fleet_expire_should_signal_expired_only(void)
+{
+    cfsm_fleet_attachDeadlines(&fleet, deadlines, armed);
+
+    TEST_ASSERT_EQUAL_UINT(0u, cfsm_fleet_expire(&fleet, 100u, EVENT_TIMEOUT));
+
+    cfsm_fleet_armTimeout(&fleet, instances[0], 10u);
+    cfsm_fleet_armTimeout(&fleet, instances[2], 30u);
+    cfsm_fleet_armTimeout(&fleet, instances[3], 5u);
+    cfsm_fleet_disarmTimeout(&fleet, instances[3]);
+
+    TEST_ASSERT_EQUAL_UINT(1u, cfsm_fleet_expire(&fleet, 20u, EVENT_TIMEOUT));
+    TEST_ASSERT_EQUAL_INT(EVENT_TIMEOUT, counters[0].lastEventId);
+    TEST_ASSERT_EQUAL_INT(0, counters[2].eventCalls);
+    TEST_ASSERT_EQUAL_INT(0, counters[3].eventCalls);
+
+    TEST_ASSERT_EQUAL_UINT(0u, cfsm_fleet_expire(&fleet, 20u, EVENT_TIMEOUT));
+    TEST_ASSERT_EQUAL_UINT(1u, cfsm_fleet_expire(&fleet, 30u, EVENT_TIMEOUT));
+    TEST_ASSERT_EQUAL_INT(EVENT_TIMEOUT, counters[2].lastEventId);
+}
+
+void test_cfsm_fleet_expire_should_handle_time_wrap_around(void)
+{
+    cfsm_fleet_attachDeadlines(&fleet, deadlines, armed);
+    cfsm_fleet_armTimeout(&fleet, instances[1], 0x10u);
+
+    TEST_ASSERT_EQUAL_UINT(0u, cfsm_fleet_expire(&fleet, 0xFFFFFFF0u, EVENT_TIMEOUT));
+    TEST_ASSERT_EQUAL_UINT(1u, cfsm_fleet_expire(&fleet, 0x10u, EVENT_TIMEOUT));
+}
+
+void test_cfsm_fleet_remove_should_disarm_timeout(void)
+{
+    cfsm_fleet_attachDeadlines(&fleet, deadlines, armed);
+    cfsm_fleet_armTimeout(&fleet, instances[1], 0u);
+
+    cfsm_fleet_remove(&fleet, instances[1]);
+    (void)cfsm_fleet_add(&fleet, &counters[1]);
+
+    TEST_ASSERT_EQUAL_UINT(0u, cfsm_fleet_expire(&fleet, 100u, EVENT_TIMEOUT));
+}
+
+void test_cfsm_fleet_expire_should_scan_full_blocks(void)
+{
+    static cfsm_FleetEntry bigEntries[BIG_FLEET_SIZE];
+    static InstanceCounter bigCounters[BIG_FLEET_SIZE];
+    static cfsm_Time bigDeadlines[BIG_FLEET_SIZE];
+    static uint32_t bigArmed[CFSM_FLEET_ARMED_WORDS(BIG_FLEET_SIZE)];
+    cfsm_Fleet bigFleet;
+    int expected = 0;
+
+    memset(bigCounters, 0, sizeof(bigCounters));
+    cfsm_fleet_init(&bigFleet, bigEntries, BIG_FLEET_SIZE);
+    cfsm_fleet_attachDeadlines(&bigFleet, bigDeadlines, bigArmed);
+
+    for (int i = 0; i < BIG_FLEET_SIZE; ++i)
+    {
+        cfsm_Ctx * fsm = cfsm_fleet_add(&bigFleet, &bigCounters[i]);
+
+        cfsm_transition(fsm, State_Worker_onEnter);
+        if (0 == (i % 3))
+        {
+            cfsm_fleet_armTimeout(&bigFleet, fsm, (cfsm_Time)i);
+            expected += (i <= 35) ? 1 : 0;
+        }
+    }
+
+    TEST_ASSERT_EQUAL_UINT(expected, cfsm_fleet_expire(&bigFleet, 35u, EVENT_TIMEOUT));
+
+    for (int i = 0; i < BIG_FLEET_SIZE; ++i)
+    {
+        int timedOut = (0 == (i % 3)) && (i <= 35);
+
+        TEST_ASSERT_EQUAL_INT(timedOut ? 1 : 0, bigCounters[i].eventCalls);
+    }
+}
+
+void test_cfsm_fleet_stats_should_count_lists(void)
+{
+    cfsm_FleetStats stats;
+
+    cfsm_sleepUntil(instances[0], 10u);
+    cfsm_sleepUntilEvent(instances[1]);
+    cfsm_fleet_process(&fleet, 0u);
+    cfsm_fleet_remove(&fleet, instances[3]);
+
+    cfsm_fleet_stats(&fleet, &stats);
+
+    TEST_ASSERT_EQUAL_UINT(FLEET_SIZE, stats.capacity);
+    TEST_ASSERT_EQUAL_UINT(FLEET_SIZE, stats.used);
+    TEST_ASSERT_EQUAL_UINT(3u, stats.live);
+    TEST_ASSERT_EQUAL_UINT(1u, stats.runnable);
+    TEST_ASSERT_EQUAL_UINT(1u, stats.sleeping);
+    TEST_ASSERT_EQUAL_UINT(1u, stats.waiting);
+    TEST_ASSERT_EQUAL_PTR(fleetEntries, stats.storage);
+    TEST_ASSERT_EQUAL_UINT(sizeof(fleetEntries), stats.storageBytes);
+
+    cfsm_fleet_process(&fleet, 10u);
+    cfsm_fleet_stats(&fleet, &stats);
+    TEST_ASSERT_EQUAL_UINT(2u, stats.runnable);
+    TEST_ASSERT_EQUAL_UINT(0u, stats.sleeping);
+}
+
+void test_cfsm_fleet_initShard_should_split_at_cache_lines(void)
+{
+    static cfsm_FleetEntry storage[100];
+    cfsm_PaddedFleet shards[3];
+    const unsigned char * end = (const unsigned char *)storage;
+
+    TEST_ASSERT_EQUAL_UINT(0u, sizeof(cfsm_PaddedFleet) % CFSM_CACHE_LINE);
+
+    for (size_t i = 0u; i < 3u; ++i)
+    {
+        cfsm_Fleet * shard = &shards[i].fleet;
+        const unsigned char * begin;
+
+        cfsm_fleet_initShard(shard, storage, sizeof(storage), i, 3u);
+        begin = (const unsigned char *)shard->entries;
+
+        TEST_ASSERT_TRUE(begin >= end);
+        TEST_ASSERT_EQUAL_UINT(0u, (size_t)(begin - (const unsigned char *)storage) % CFSM_CACHE_LINE);
+        TEST_ASSERT_TRUE(shard->capacity > 0u);
+
+        end = begin + (shard->capacity * sizeof(cfsm_FleetEntry));
+    }
+    TEST_ASSERT_TRUE(end <= (const unsigned char *)&storage[100]);
+}
+
+void test_cfsm_fleet_post_should_drop_stale_handle(void)
+{
+    cfsm_Handle handle = cfsm_fleet_handleOf(&fleet, instances[3]);
+
+    TEST_ASSERT_EQUAL_INT(1, cfsm_fleet_post(&fleet, handle, 5));
+    TEST_ASSERT_EQUAL_INT(1, counters[3].eventCalls);
+
+    cfsm_fleet_remove(&fleet, instances[3]);
+    (void)cfsm_fleet_add(&fleet, &counters[3]);
+
+    TEST_ASSERT_EQUAL_INT(0, cfsm_fleet_post(&fleet, handle, 6));
+    TEST_ASSERT_EQUAL_INT(1, counters[3].eventCalls);
+    TEST_ASSERT_EQUAL_INT(5, counters[3].lastEventId);
+}
+
+void test_cfsm_stateLocal_should_be_null_without_arena(void)
+{
+    TEST_ASSERT_EQUAL_PTR(NULL, cfsm_stateLocal(instances[0]));
+    TEST_ASSERT_EQUAL_PTR(NULL, cfsm_enterLocal(instances[0], 1u));
+}
+
+void test_cfsm_enterLocal_should_refuse_oversized_data(void)
+{
+    RetryLocal * neighbour;
+
+    cfsm_fleet_attachLocal(&fleet, localArena, sizeof(RetryLocal));
+    memset(localArena, -1, sizeof(localArena));
+
+    cfsm_transition(instances[1], State_Retry_onEnter);
+    neighbour = (RetryLocal *)cfsm_stateLocal(instances[1]);
+    TEST_ASSERT_NOT_NULL(neighbour);
+    neighbour->retries = 7;
+
+    TEST_ASSERT_EQUAL_PTR(NULL,
+        cfsm_enterLocal(instances[0], CFSM_FLEET_LOCAL_SLOT(sizeof(RetryLocal)) + 1u));
+    TEST_ASSERT_EQUAL_INT(7, neighbour->retries);
+
+    TEST_ASSERT_NOT_NULL(
+        cfsm_enterLocal(instances[0], CFSM_FLEET_LOCAL_SLOT(sizeof(RetryLocal))));
+    TEST_ASSERT_EQUAL_INT(7, neighbour->retries);
+    TEST_ASSERT_EQUAL_PTR(neighbour, cfsm_stateLocal(instances[1]));
+}
+
+void test_cfsm_stateLocal_should_be_null_unless_claimed_by_active_state(void)
+{
+    cfsm_fleet_attachLocal(&fleet, localArena, sizeof(RetryLocal));
+    memset(localArena, -1, sizeof(localArena));  /* corrupt content */
+
+    /* Worker never claimed its slot. */
+    TEST_ASSERT_EQUAL_PTR(NULL, cfsm_stateLocal(instances[0]));
+
+    cfsm_fleet_transition(&fleet, instances[0], State_Retry_onEnter);
+    TEST_ASSERT_NOT_NULL(cfsm_stateLocal(instances[0]));
+
+    /* The slot of Retry is no storage of the next state. */
+    cfsm_fleet_transition(&fleet, instances[0], State_Worker_onEnter);
+    TEST_ASSERT_EQUAL_PTR(NULL, cfsm_stateLocal(instances[0]));
+
+    /* A reused entry starts unclaimed. */
+    cfsm_fleet_transition(&fleet, instances[0], State_Retry_onEnter);
+    cfsm_fleet_remove(&fleet, instances[0]);
+    instances[0] = cfsm_fleet_add(&fleet, NULL);
+    TEST_ASSERT_EQUAL_PTR(NULL, cfsm_stateLocal(instances[0]));
+}
+
+void test_cfsm_stateLocal_should_live_while_state_is_active(void)
+{
+    cfsm_fleet_init(&fleet, fleetEntries, FLEET_SIZE);
+    cfsm_fleet_attachLocal(&fleet, localArena, sizeof(RetryLocal));
+    memset(localArena, -1, sizeof(localArena));  /* corrupt content */
+
+    for (int i = 0; i < FLEET_SIZE; ++i)
+    {
+        instances[i] = cfsm_fleet_add(&fleet, &counters[i]);
+        cfsm_transition(instances[i], State_Retry_onEnter);
+    }
+
+    cfsm_fleet_process(&fleet, 0u);
+    cfsm_fleet_process(&fleet, 1u);
+
+    RetryLocal * local0 = (RetryLocal *)cfsm_stateLocal(instances[0]);
+    RetryLocal * local1 = (RetryLocal *)cfsm_stateLocal(instances[1]);
+
+    TEST_ASSERT_NOT_NULL(local0);
+    TEST_ASSERT_TRUE((char *)local1 - (char *)local0 >= (int)sizeof(RetryLocal));
+    TEST_ASSERT_EQUAL_INT(2, local0->retries);
+    TEST_ASSERT_EQUAL_INT(2, local1->retries);
+
+    /* Reentering the state starts with fresh storage. */
+    cfsm_transition(instances[0], State_Retry_onEnter);
+    TEST_ASSERT_EQUAL_INT(0, local0->retries);
+    TEST_ASSERT_EQUAL_INT(2, local1->retries);
+}
+
+void test_cfsm_fleet_ingest_should_keep_per_instance_order(void)
+{
+    cfsm_Handle targets[6];
+    int events[6] = { 1, 2, 3, 4, 5, 6 };
+    cfsm_Handle scratchTargets[6];
+    int scratchIds[6];
+
+    targets[0] = cfsm_fleet_handleOf(&fleet, instances[3]);
+    targets[1] = cfsm_fleet_handleOf(&fleet, instances[0]);
+    targets[2] = cfsm_fleet_handleOf(&fleet, instances[3]);
+    targets[3] = CFSM_FLEET_INVALID_HANDLE;
+    targets[4] = cfsm_fleet_handleOf(&fleet, instances[0]);
+    targets[5] = 0xFFFFFFFFu;
+
+    TEST_ASSERT_EQUAL_UINT(4, cfsm_fleet_ingest(
+        &fleet, targets, events, 6u, scratchTargets, scratchIds));
+
+    TEST_ASSERT_EQUAL_INT(2, counters[0].eventCalls);
+    TEST_ASSERT_EQUAL_INT(5, counters[0].lastEventId);
+    TEST_ASSERT_EQUAL_INT(2, counters[3].eventCalls);
+    TEST_ASSERT_EQUAL_INT(3, counters[3].lastEventId);
+
+    TEST_ASSERT_EQUAL_UINT(4, cfsm_fleet_ingest(
+        &fleet, targets, events, 6u, NULL, NULL));
+    TEST_ASSERT_EQUAL_INT(4, counters[0].eventCalls);
+    TEST_ASSERT_EQUAL_INT(5, counters[0].lastEventId);
+}
+
+void test_cfsm_fleet_calls_on_removed_instance_should_keep_lists(void)
+{
+    cfsm_FleetStats stats;
+
+    cfsm_sleepUntil(instances[2], 10u);
+    cfsm_fleet_process(&fleet, 0u);
+    cfsm_fleet_remove(&fleet, instances[1]);
+    cfsm_fleet_remove(&fleet, instances[2]);
+
+    /* Stale pointers must not unlink the free entries again. */
+    cfsm_fleet_event(&fleet, instances[1], 5);
+    cfsm_fleet_transition(&fleet, instances[2], State_Worker_onEnter);
+    cfsm_sleepUntil(instances[1], 20u);
+    cfsm_sleepUntilEvent(instances[2]);
+
+    cfsm_fleet_stats(&fleet, &stats);
+    TEST_ASSERT_EQUAL_UINT32(FLEET_SIZE - 2u, stats.runnable);
+    TEST_ASSERT_EQUAL_UINT32(0u, stats.sleeping);
+    TEST_ASSERT_EQUAL_UINT32(0u, stats.waiting);
+
+    cfsm_fleet_process(&fleet, 1u);
+    TEST_ASSERT_EQUAL_INT(2, counters[0].processCalls);
+    TEST_ASSERT_EQUAL_INT(2, counters[3].processCalls);
+}
+
+void test_cfsm_fleet_nextProcess(void)
+{
+    cfsm_Time delay = 1234u;
+
+    cfsm_fleet_process(&fleet, 0u);
+    TEST_ASSERT_EQUAL_INT(1, cfsm_fleet_nextProcess(&fleet, 0u, &delay));
+    TEST_ASSERT_EQUAL_UINT32(0u, delay);
+
+    cfsm_sleepUntilEvent(instances[0]);
+    cfsm_sleepUntil(instances[1], 30u);
+    cfsm_sleepUntil(instances[2], 20u);
+    cfsm_sleepUntilEvent(instances[3]);
+    cfsm_fleet_process(&fleet, 0u);
+
+    TEST_ASSERT_EQUAL_INT(1, cfsm_fleet_nextProcess(&fleet, 5u, &delay));
+    TEST_ASSERT_EQUAL_UINT32(15u, delay);
+    TEST_ASSERT_EQUAL_INT(1, cfsm_fleet_nextProcess(&fleet, 25u, &delay));
+    TEST_ASSERT_EQUAL_UINT32(0u, delay);
+
+    cfsm_fleet_process(&fleet, 30u);
+    cfsm_sleepUntilEvent(instances[1]);
+    cfsm_sleepUntilEvent(instances[2]);
+    cfsm_fleet_process(&fleet, 31u);
+
+    TEST_ASSERT_EQUAL_INT(0, cfsm_fleet_nextProcess(&fleet, 31u, &delay));
+}
+
+void test_cfsm_fleet_nextProcess_should_include_armed_timeouts(void)
+{
+    cfsm_Time delay = 1234u;
+
+    cfsm_fleet_attachDeadlines(&fleet, deadlines, armed);
+    for (int i = 0; i < FLEET_SIZE; ++i)
+    {
+        cfsm_sleepUntilEvent(instances[i]);
+    }
+    cfsm_sleepUntil(instances[0], 50u);
+    cfsm_fleet_process(&fleet, 0u);
+
+    cfsm_fleet_armTimeout(&fleet, instances[3], 40u);
+    cfsm_fleet_armTimeout(&fleet, instances[2], 20u);
+
+    TEST_ASSERT_EQUAL_INT(1, cfsm_fleet_nextProcess(&fleet, 5u, &delay));
+    TEST_ASSERT_EQUAL_UINT32(15u, delay);
+
+    cfsm_fleet_disarmTimeout(&fleet, instances[2]);
+    TEST_ASSERT_EQUAL_INT(1, cfsm_fleet_nextProcess(&fleet, 5u, &delay));
+    TEST_ASSERT_EQUAL_UINT32(35u, delay);
+
+    /* Without sleepers, the armed timeout alone sets the delay. */
+    cfsm_sleepUntilEvent(instances[0]);
+    TEST_ASSERT_EQUAL_INT(1, cfsm_fleet_nextProcess(&fleet, 45u, &delay));
+    TEST_ASSERT_EQUAL_UINT32(0u, delay);
+
+    cfsm_fleet_disarmTimeout(&fleet, instances[3]);
+    TEST_ASSERT_EQUAL_INT(0, cfsm_fleet_nextProcess(&fleet, 45u, &delay));
+}
+
+int main(void)
+{
+    UNITY_BEGIN();
+
+    RUN_TEST(test_cfsm_fleet_add_should_fail_if_full);
+    RUN_TEST(test_cfsm_fleet_add_should_init_fsm);
+    RUN_TEST(test_cfsm_fleet_process_should_process_all_runnable);
+    RUN_TEST(test_cfsm_sleepUntilEvent_should_skip_process_until_event);
+    RUN_TEST(test_cfsm_sleepUntil_should_wake_on_deadline);
+    RUN_TEST(test_cfsm_sleepUntil_should_wake_on_event);
+    RUN_TEST(test_cfsm_fleet_eventData_should_wake_sleeper);
+    RUN_TEST(test_cfsm_fleet_eventBatch_should_deliver_all);
+    RUN_TEST(test_cfsm_sleepUntil_should_order_sleepers_by_deadline);
+    RUN_TEST(test_cfsm_fleet_process_should_wake_unordered_sleepers_in_time);
+    RUN_TEST(test_cfsm_sleepUntil_should_handle_time_wrap_around);
+    RUN_TEST(test_cfsm_sleepUntil_from_handler);
+    RUN_TEST(test_cfsm_fleet_transitionAll_should_move_matching_only);
+    RUN_TEST(test_cfsm_fleet_transitionAll_should_wake_sleepers);
+    RUN_TEST(test_cfsm_fleet_transitionAll_should_walk_state_list);
+    RUN_TEST(test_cfsm_fleet_handle_lookup);
+    RUN_TEST(test_cfsm_fleet_remove_should_reuse_entry_with_new_handle);
+    RUN_TEST(test_cfsm_fleet_remove_should_reuse_oldest_entry_first);
+    RUN_TEST(test_cfsm_fleet_remove_should_wrap_generation_and_skip_zero);
+    RUN_TEST(test_cfsm_fleet_remove_should_stop_processing);
+    RUN_TEST(test_cfsm_fleet_post_should_drop_stale_handle);
+    RUN_TEST(test_cfsm_fleet_indexOf_should_address_columns);
+    RUN_TEST(test_cfsm_fleet_expire_should_signal_expired_only);
+    RUN_TEST(test_cfsm_fleet_expire_should_handle_time_wrap_around);
+    RUN_TEST(test_cfsm_fleet_remove_should_disarm_timeout);
+    RUN_TEST(test_cfsm_fleet_expire_should_scan_full_blocks);
+    RUN_TEST(test_cfsm_fleet_stats_should_count_lists);
+    RUN_TEST(test_cfsm_fleet_initShard_should_split_at_cache_lines);
+    RUN_TEST(test_cfsm_fleet_ingest_should_keep_per_instance_order);
+    RUN_TEST(test_cfsm_fleet_calls_on_removed_instance_should_keep_lists);
+    RUN_TEST(test_cfsm_fleet_nextProcess);
+    RUN_TEST(test_cfsm_fleet_nextProcess_should_include_armed_timeouts);
+    RUN_TEST(test_cfsm_stateLocal_should_be_null_without_arena);
+    RUN_TEST(test_cfsm_enterLocal_should_refuse_oversized_data);
+    RUN_TEST(test_cfsm_stateLocal_should_be_null_unless_claimed_by_active_state);
+    RUN_TEST(test_cfsm_stateLocal_should_live_while_state_is_active);
+
+    return UNITY_END();
+}
+
+/******************************************************************************
+ * Local functions
+ *****************************************************************************/
+
+static void State_Worker_onEnter(cfsm_Ctx * fsm)
+{
+    fsm->onProcess = State_Worker_onProcess;
+    fsm->onEvent = State_Worker_onEvent;
+}
+
+static void State_Worker_onProcess(cfsm_Ctx * fsm)
+{
+    InstanceCounter * counter = (InstanceCounter *)fsm->ctxPtr;
+
+    counter->processCalls++;
+
+    /* Sleep after first process cycle if requested by event 1. */
+    if (1 == counter->lastEventId)
+    {
+        counter->lastEventId = 0;
+        cfsm_sleepUntil(fsm, 50u);
+    }
+}
+
+static void State_Worker_onEvent(cfsm_Ctx * fsm, int eventId)
+{
+    InstanceCounter * counter = (InstanceCounter *)fsm->ctxPtr;
+
+    counter->eventCalls++;
+    counter->lastEventId = eventId;
+}
+
+static void State_Recovery_onEnter(cfsm_Ctx * fsm)
+{
+    (void)fsm;
+}
+
+static void State_Retry_onEnter(cfsm_Ctx * fsm)
+{
+    RetryLocal * local = (RetryLocal *)cfsm_enterLocal(fsm, sizeof(RetryLocal));
+
+    TEST_ASSERT_NOT_NULL(local);
+    TEST_ASSERT_EQUAL_INT(0, local->retries);
+
+    fsm->onProcess = State_Retry_onProcess;
+}
+
+static void State_Retry_onProcess(cfsm_Ctx * fsm)
+{
+    RetryLocal * local = (RetryLocal *)cfsm_stateLocal(fsm);
+
+    local->retries++;
+}
+
+/** @} */
@@ -0,0 +1,218 @@
+/* MIT License
+ *
+ * Copyright (C) 2024  Haju Schulz <haju@schulznorbert.de>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+/*******************************************************************************
+    DESCRIPTION
+*******************************************************************************/
+/**
+ * @brief  CFSM PlantUML generator test suite
+ *
+ * Tests the states generated by tools/cfsm_puml2c.py from test_door.puml.
+ *
+ * @addtogroup tests
+ *
+ * @{
+ */
+
+/******************************************************************************
+ * Includes
+ *****************************************************************************/
+
+#include <string.h>
+#include <unity.h>
+
+#include "c_fsm.h"
+#include "door.h"
+#include "blink.h"
+
+/******************************************************************************
+ * Macros
+ *****************************************************************************/
+
+#define EVENT_FORCE 99  /**< Not in the table, handled by door_lockedEvent() */
+
+/******************************************************************************
+ * Types and Classes
+ *****************************************************************************/
+
+/******************************************************************************
+ * Prototypes
+ *****************************************************************************/
+
+/******************************************************************************
+ * Variables
+ *****************************************************************************/
+
+static cfsm_Ctx door;           /**< fsm instance used in tests */
+static int closedEntries;       /**< door_closedEntry() calls   */
+static int openedProcesses;     /**< door_openedProcess() calls */
+static int openedLeaves;        /**< door_openedLeave() calls   */
+static int lockedEvents;        /**< door_lockedEvent() calls   */
+
+/******************************************************************************
+ * External functions
+ *****************************************************************************/
+
+void setUp(void)
+{
+    closedEntries = 0;
+    openedProcesses = 0;
+    openedLeaves = 0;
+    lockedEvents = 0;
+
+    cfsm_init(&door, NULL);
+    door_start(&door);
+}
+
+void tearDown(void)
+{
+}
+
+void test_generated_start_should_enter_initial_state(void)
+{
+    TEST_ASSERT_EQUAL_PTR(door_Closed_onEnter, door.state);
+    TEST_ASSERT_EQUAL_INT(1, closedEntries);
+}
+
+void test_generated_table_should_transition(void)
+{
+    cfsm_event(&door, DOOR_EV_OPEN);
+    TEST_ASSERT_EQUAL_PTR(door_Opened_onEnter, door.state);
+
+    cfsm_process(&door);
+    cfsm_process(&door);
+    TEST_ASSERT_EQUAL_INT(2, openedProcesses);
+
+    cfsm_event(&door, DOOR_EV_LOCK);   /* not in Opened row */
+    TEST_ASSERT_EQUAL_PTR(door_Opened_onEnter, door.state);
+
+    cfsm_event(&door, DOOR_EV_CLOSE);
+    TEST_ASSERT_EQUAL_PTR(door_Closed_onEnter, door.state);
+    TEST_ASSERT_EQUAL_INT(1, openedLeaves);
+    TEST_ASSERT_EQUAL_INT(2, closedEntries);
+}
+
+void test_generated_should_ignore_unknown_events(void)
+{
+    cfsm_event(&door, -1);
+    cfsm_event(&door, DOOR_EV_COUNT);
+    cfsm_event(&door, EVENT_FORCE);
+
+    TEST_ASSERT_EQUAL_PTR(door_Closed_onEnter, door.state);
+}
+
+void test_generated_event_operation_runs_before_table(void)
+{
+    cfsm_event(&door, DOOR_EV_LOCK);
+    TEST_ASSERT_EQUAL_PTR(door_Locked_onEnter, door.state);
+
+    cfsm_event(&door, DOOR_EV_OPEN);
+    TEST_ASSERT_EQUAL_INT(1, lockedEvents);
+    TEST_ASSERT_EQUAL_PTR(door_Locked_onEnter, door.state);
+
+    /* The prose transition "with force" is done by the event operation. */
+    cfsm_event(&door, EVENT_FORCE);
+    TEST_ASSERT_EQUAL_PTR(door_Opened_onEnter, door.state);
+}
+
+void test_generated_final_state_should_stop(void)
+{
+    cfsm_event(&door, DOOR_EV_LOCK);
+    cfsm_event(&door, DOOR_EV_BREAK);
+
+    TEST_ASSERT_NULL(door.state);
+    TEST_ASSERT_EQUAL_PTR(CFSM_NO_EVENT, door.onEvent);
+    TEST_ASSERT_EQUAL_PTR(CFSM_NO_PROCESS, door.onProcess);
+}
+
+void test_generated_names(void)
+{
+    TEST_ASSERT_EQUAL_STRING("Opened", door_stateName(door_Opened_onEnter));
+    TEST_ASSERT_EQUAL_PTR(NULL, door_stateName(NULL));
+    TEST_ASSERT_EQUAL_STRING("UNLOCK", door_eventName(DOOR_EV_UNLOCK));
+    TEST_ASSERT_EQUAL_PTR(NULL, door_eventName(DOOR_EV_COUNT));
+}
+
+void test_generated_without_events_should_only_enter(void)
+{
+    cfsm_Ctx blink;
+
+    cfsm_init(&blink, NULL);
+    blink_start(&blink);
+
+    TEST_ASSERT_EQUAL_INT(0, BLINK_EV_COUNT);
+    TEST_ASSERT_EQUAL_PTR(blink_OnState_onEnter, blink.state);
+    TEST_ASSERT_EQUAL_PTR(CFSM_NO_EVENT, blink.onEvent);
+    TEST_ASSERT_EQUAL_STRING("OffState", blink_stateName(blink_OffState_onEnter));
+    TEST_ASSERT_EQUAL_PTR(NULL, blink_eventName(0));
+}
+
+int main(void)
+{
+    UNITY_BEGIN();
+
+    RUN_TEST(test_generated_start_should_enter_initial_state);
+    RUN_TEST(test_generated_table_should_transition);
+    RUN_TEST(test_generated_should_ignore_unknown_events);
+    RUN_TEST(test_generated_event_operation_runs_before_table);
+    RUN_TEST(test_generated_final_state_should_stop);
+    RUN_TEST(test_generated_names);
+    RUN_TEST(test_generated_without_events_should_only_enter);
+
+    return UNITY_END();
+}
+
+/******************************************************************************
+ * Local functions
+ *****************************************************************************/
+
+void door_closedEntry(cfsm_Ctx * fsm)
+{
+    (void)fsm;
+    closedEntries++;
+}
+
+void door_openedProcess(cfsm_Ctx * fsm)
+{
+    (void)fsm;
+    openedProcesses++;
+}
+
+void door_openedLeave(cfsm_Ctx * fsm)
+{
+    (void)fsm;
+    openedLeaves++;
+}
+
+void door_lockedEvent(cfsm_Ctx * fsm, int eventId)
+{
+    lockedEvents++;
+
+    if (EVENT_FORCE == eventId)
+    {
+        cfsm_transition(fsm, door_Opened_onEnter);
+    }
+}
+
+/** @} */
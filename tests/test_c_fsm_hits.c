@@ -0,0 +1,268 @@
+/* MIT License
+ *
+ * Copyright (C) 2024  Haju Schulz <haju@schulznorbert.de>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+/*******************************************************************************
+    DESCRIPTION
+*******************************************************************************/
+/**
+ * @brief  CFSM hit matrix test suite
+ *
+ * @addtogroup tests
+ *
+ * @{
+ */
+
+/******************************************************************************
+ * Includes
+ *****************************************************************************/
+
+#include <stdio.h>
+#include <string.h>
+#include <unity.h>
+
+#include "c_fsm_hits.h"
+
+/******************************************************************************
+ * Macros
+ *****************************************************************************/
+
+#define EVENT_START 1  /**< Moves Idle to Busy */
+#define EVENT_OTHER 2  /**< Ignored by Idle    */
+#define CELLS       8  /**< Test matrix size   */
+
+/******************************************************************************
+ * Types and Classes
+ *****************************************************************************/
+
+/******************************************************************************
+ * Prototypes
+ *****************************************************************************/
+
+static const char * Test_stateName(cfsm_TransitionFunction state);
+static const char * Test_eventName(int eventId);
+static void State_Idle_onEnter(cfsm_Ctx * fsm);
+static void State_Idle_onEvent(cfsm_Ctx * fsm, int eventId);
+static void State_Busy_onEnter(cfsm_Ctx * fsm);
+
+/******************************************************************************
+ * Variables
+ *****************************************************************************/
+
+static cfsm_Hits hits;             /**< hit matrix under test */
+static cfsm_HitCell cells[CELLS];  /**< hit matrix storage    */
+static cfsm_Ctx fsm;               /**< counted state machine */
+
+/******************************************************************************
+ * External functions
+ *****************************************************************************/
+
+void setUp(void)
+{
+    cfsm_hits_init(&hits, cells, CELLS);
+    cfsm_hits_attach(&hits);
+    cfsm_init(&fsm, NULL);
+    cfsm_transition(&fsm, State_Idle_onEnter);
+}
+
+void tearDown(void)
+{
+    cfsm_hits_attach(NULL);
+}
+
+void test_cfsm_hits_should_count_state_event_pairs(void)
+{
+    const cfsm_HitCell * cell;
+
+    cfsm_event(&fsm, EVENT_OTHER);
+    cfsm_event(&fsm, EVENT_OTHER);
+    cfsm_eventData(&fsm, EVENT_START, NULL, 0u);
+
+    cell = cfsm_hits_find(&hits, State_Idle_onEnter, EVENT_OTHER);
+    TEST_ASSERT_NOT_NULL(cell);
+    TEST_ASSERT_EQUAL_UINT64(2u, cell->hits);
+    TEST_ASSERT_EQUAL_UINT64(0u, cell->unhandled);
+
+    cell = cfsm_hits_find(&hits, State_Idle_onEnter, EVENT_START);
+    TEST_ASSERT_NOT_NULL(cell);
+    TEST_ASSERT_EQUAL_UINT64(1u, cell->hits);
+
+    TEST_ASSERT_NULL(cfsm_hits_find(&hits, State_Busy_onEnter, EVENT_START));
+    TEST_ASSERT_EQUAL_UINT(2u, hits.used);
+}
+
+void test_cfsm_hits_should_count_unhandled_events(void)
+{
+    const int batch[] = { EVENT_START, EVENT_OTHER, EVENT_OTHER };
+    const cfsm_HitCell * cell;
+
+    /* Busy has no event handler, the rest of the batch is dropped. */
+    cfsm_eventBatch(&fsm, batch, sizeof(batch) / sizeof(batch[0]));
+    cfsm_event(&fsm, EVENT_START);
+
+    cell = cfsm_hits_find(&hits, State_Busy_onEnter, EVENT_OTHER);
+    TEST_ASSERT_NOT_NULL(cell);
+    TEST_ASSERT_EQUAL_UINT64(2u, cell->hits);
+    TEST_ASSERT_EQUAL_UINT64(2u, cell->unhandled);
+
+    cell = cfsm_hits_find(&hits, State_Busy_onEnter, EVENT_START);
+    TEST_ASSERT_NOT_NULL(cell);
+    TEST_ASSERT_EQUAL_UINT64(1u, cell->unhandled);
+
+    cell = cfsm_hits_find(&hits, State_Idle_onEnter, EVENT_START);
+    TEST_ASSERT_NOT_NULL(cell);
+    TEST_ASSERT_EQUAL_UINT64(0u, cell->unhandled);
+}
+
+void test_cfsm_hits_should_drop_pairs_beyond_load_limit(void)
+{
+    int eventId;
+
+    /* 3/4 of 8 cells can be used. */
+    for (eventId = 10; eventId < 20; ++eventId)
+    {
+        cfsm_event(&fsm, eventId);
+    }
+
+    TEST_ASSERT_EQUAL_UINT(6u, hits.used);
+    TEST_ASSERT_EQUAL_UINT64(4u, hits.dropped);
+    TEST_ASSERT_NOT_NULL(cfsm_hits_find(&hits, State_Idle_onEnter, 15));
+    TEST_ASSERT_NULL(cfsm_hits_find(&hits, State_Idle_onEnter, 16));
+}
+
+void test_cfsm_hits_merge_should_add_shards(void)
+{
+    cfsm_Hits shard;
+    cfsm_HitCell shardCells[CELLS];
+    const cfsm_HitCell * cell;
+
+    cfsm_event(&fsm, EVENT_OTHER);
+
+    cfsm_hits_init(&shard, shardCells, CELLS);
+    cfsm_hits_attach(&shard);
+    cfsm_event(&fsm, EVENT_OTHER);
+    cfsm_event(&fsm, EVENT_START);
+    cfsm_event(&fsm, EVENT_OTHER);
+
+    cfsm_hits_merge(&hits, &shard);
+
+    cell = cfsm_hits_find(&hits, State_Idle_onEnter, EVENT_OTHER);
+    TEST_ASSERT_NOT_NULL(cell);
+    TEST_ASSERT_EQUAL_UINT64(2u, cell->hits);
+
+    cell = cfsm_hits_find(&hits, State_Busy_onEnter, EVENT_OTHER);
+    TEST_ASSERT_NOT_NULL(cell);
+    TEST_ASSERT_EQUAL_UINT64(1u, cell->unhandled);
+    TEST_ASSERT_EQUAL_UINT(3u, hits.used);
+}
+
+void test_cfsm_hits_csv_should_name_states_and_events(void)
+{
+    char text[512];
+    size_t length;
+    FILE * out = tmpfile();
+
+    TEST_ASSERT_NOT_NULL(out);
+
+    cfsm_event(&fsm, EVENT_START);
+    cfsm_event(&fsm, EVENT_OTHER);
+    cfsm_transition(&fsm, NULL);
+    cfsm_event(&fsm, 7);
+
+    cfsm_hits_writeCsv(&hits, out, Test_stateName, Test_eventName);
+
+    rewind(out);
+    length = fread(text, 1u, sizeof(text) - 1u, out);
+    text[length] = '\0';
+    fclose(out);
+
+    TEST_ASSERT_EQUAL_STRING_LEN("state,event,hits,unhandled\n", text, 27u);
+    TEST_ASSERT_NOT_NULL(strstr(text, "Idle,START,1,0\n"));
+    TEST_ASSERT_NOT_NULL(strstr(text, "Busy,OTHER,1,1\n"));
+    TEST_ASSERT_NOT_NULL(strstr(text, "[*],7,1,1\n"));
+}
+
+int main(void)
+{
+    UNITY_BEGIN();
+
+    RUN_TEST(test_cfsm_hits_should_count_state_event_pairs);
+    RUN_TEST(test_cfsm_hits_should_count_unhandled_events);
+    RUN_TEST(test_cfsm_hits_should_drop_pairs_beyond_load_limit);
+    RUN_TEST(test_cfsm_hits_merge_should_add_shards);
+    RUN_TEST(test_cfsm_hits_csv_should_name_states_and_events);
+
+    return UNITY_END();
+}
+
+/******************************************************************************
+ * Local functions
+ *****************************************************************************/
+
+static const char * Test_stateName(cfsm_TransitionFunction state)
+{
+    if (State_Idle_onEnter == state)
+    {
+        return "Idle";
+    }
+    if (State_Busy_onEnter == state)
+    {
+        return "Busy";
+    }
+
+    return NULL;
+}
+
+static const char * Test_eventName(int eventId)
+{
+    if (EVENT_START == eventId)
+    {
+        return "START";
+    }
+    if (EVENT_OTHER == eventId)
+    {
+        return "OTHER";
+    }
+
+    return NULL;
+}
+
+static void State_Idle_onEnter(cfsm_Ctx * fsm)
+{
+    fsm->onEvent = State_Idle_onEvent;
+}
+
+static void State_Idle_onEvent(cfsm_Ctx * fsm, int eventId)
+{
+    if (EVENT_START == eventId)
+    {
+        cfsm_transition(fsm, State_Busy_onEnter);
+    }
+}
+
+static void State_Busy_onEnter(cfsm_Ctx * fsm)
+{
+    (void)fsm;
+}
+
+/** @} */
@@ -0,0 +1,260 @@
+/* MIT License
+ *
+ * Copyright (C) 2024  Haju Schulz <haju@schulznorbert.de>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+/*******************************************************************************
+    DESCRIPTION
+*******************************************************************************/
+/**
+ * @brief  CFSM event latency test suite
+ *
+ * @addtogroup tests
+ *
+ * @{
+ */
+
+/******************************************************************************
+ * Includes
+ *****************************************************************************/
+
+#include <stdio.h>
+#include <string.h>
+#include <unity.h>
+
+#include "c_fsm_latency.h"
+
+/******************************************************************************
+ * Macros
+ *****************************************************************************/
+
+#define GROUPS        2  /**< FSM groups of test shards      */
+#define EVENTS        3  /**< Event IDs of test shards       */
+#define EVENT_WORK    1  /**< Event handled in HANDLE_TICKS  */
+#define HANDLE_TICKS  7  /**< Clock ticks of EVENT_WORK      */
+
+/******************************************************************************
+ * Types and Classes
+ *****************************************************************************/
+
+/******************************************************************************
+ * Prototypes
+ *****************************************************************************/
+
+static uint32_t Test_clock(void);
+static void State_Work_onEnter(cfsm_Ctx * fsm);
+static void State_Work_onEvent(cfsm_Ctx * fsm, int eventId);
+
+/******************************************************************************
+ * Variables
+ *****************************************************************************/
+
+static cfsm_Histogram histogram;    /**< histogram under test      */
+static cfsm_Latency shards[2];      /**< per thread latency shards */
+static cfsm_Histogram histograms[2][CFSM_LATENCY_HISTOGRAMS(GROUPS, EVENTS)];
+static uint32_t clockNow;           /**< fake clock time           */
+
+/******************************************************************************
+ * External functions
+ *****************************************************************************/
+
+void setUp(void)
+{
+    clockNow = 0u;
+
+    cfsm_histogram_reset(&histogram);
+    cfsm_latency_init(&shards[0], histograms[0], GROUPS, EVENTS, Test_clock);
+    cfsm_latency_init(&shards[1], histograms[1], GROUPS, EVENTS, Test_clock);
+}
+
+void tearDown(void)
+{
+}
+
+void test_cfsm_histogram_should_be_exact_for_small_values(void)
+{
+    for (uint32_t value = 0u; value < 64u; ++value)
+    {
+        cfsm_histogram_reset(&histogram);
+        cfsm_histogram_record(&histogram, value);
+
+        TEST_ASSERT_EQUAL_UINT32(value, cfsm_histogram_percentile(&histogram, 50.0));
+    }
+}
+
+void test_cfsm_histogram_should_bound_relative_error(void)
+{
+    static const uint32_t values[] = {
+        64u, 100u, 1000u, 12345u, 1000000u, 0x7FFFFFFFu, 0xFFFFFFFFu
+    };
+
+    for (size_t i = 0u; i < sizeof(values) / sizeof(values[0]); ++i)
+    {
+        uint32_t reported;
+
+        /* Add a larger value, so the result is not limited to max. */
+        cfsm_histogram_reset(&histogram);
+        cfsm_histogram_record(&histogram, values[i]);
+        cfsm_histogram_record(&histogram, 0xFFFFFFFFu);
+
+        reported = cfsm_histogram_percentile(&histogram, 50.0);
+
+        TEST_ASSERT_TRUE(reported >= values[i]);
+        TEST_ASSERT_TRUE((double)(reported - values[i]) <= (double)values[i] / 32.0);
+    }
+}
+
+void test_cfsm_histogram_should_report_percentiles(void)
+{
+    for (uint32_t value = 1u; value <= 1000u; ++value)
+    {
+        cfsm_histogram_record(&histogram, value);
+    }
+
+    TEST_ASSERT_UINT32_WITHIN(16u, 500u, cfsm_histogram_percentile(&histogram, 50.0));
+    TEST_ASSERT_UINT32_WITHIN(32u, 990u, cfsm_histogram_percentile(&histogram, 99.0));
+    TEST_ASSERT_UINT32_WITHIN(32u, 999u, cfsm_histogram_percentile(&histogram, 99.9));
+    TEST_ASSERT_EQUAL_UINT32(1000u, cfsm_histogram_percentile(&histogram, 100.0));
+    TEST_ASSERT_EQUAL_UINT32(1000u, histogram.max);
+    TEST_ASSERT_EQUAL_UINT64(500500u, histogram.sum);
+}
+
+void test_cfsm_latency_event_should_record_wait_and_handle(void)
+{
+    cfsm_Ctx fsm;
+    cfsm_Histogram * wait;
+    cfsm_Histogram * handle;
+
+    cfsm_init(&fsm, NULL);
+    cfsm_transition(&fsm, State_Work_onEnter);
+
+    clockNow = 100u;
+    cfsm_latency_event(&shards[0], 1u, &fsm, EVENT_WORK, 40u);
+
+    wait   = cfsm_latency_get(&shards[0], 1u, EVENT_WORK, CFSM_LATENCY_WAIT);
+    handle = cfsm_latency_get(&shards[0], 1u, EVENT_WORK, CFSM_LATENCY_HANDLE);
+
+    TEST_ASSERT_EQUAL_UINT32(1u, wait->count);
+    TEST_ASSERT_EQUAL_UINT32(60u, wait->max);
+    TEST_ASSERT_EQUAL_UINT32(1u, handle->count);
+    TEST_ASSERT_EQUAL_UINT32(HANDLE_TICKS, handle->max);
+    TEST_ASSERT_EQUAL_UINT32(0u,
+        cfsm_latency_get(&shards[0], 0u, EVENT_WORK, CFSM_LATENCY_WAIT)->count);
+}
+
+void test_cfsm_latency_should_drop_unknown_events(void)
+{
+    cfsm_latency_record(&shards[0], 0u, EVENTS, 0u, 1u, 2u);
+    cfsm_latency_record(&shards[0], GROUPS, 0, 0u, 1u, 2u);
+    cfsm_latency_record(&shards[0], 0u, -1, 0u, 1u, 2u);
+
+    TEST_ASSERT_EQUAL_UINT32(3u, shards[0].dropped);
+    TEST_ASSERT_NULL(cfsm_latency_get(&shards[0], 0u, EVENTS, CFSM_LATENCY_WAIT));
+}
+
+void test_cfsm_latency_should_handle_clock_wrap(void)
+{
+    cfsm_latency_record(&shards[0], 0u, 0, 0xFFFFFFF0u, 0x10u, 0x20u);
+
+    TEST_ASSERT_EQUAL_UINT32(0x20u,
+        cfsm_latency_get(&shards[0], 0u, 0, CFSM_LATENCY_WAIT)->max);
+}
+
+void test_cfsm_latency_merge_should_add_shards(void)
+{
+    cfsm_Histogram * wait;
+
+    cfsm_latency_record(&shards[0], 0u, 2, 0u, 10u, 11u);
+    cfsm_latency_record(&shards[1], 0u, 2, 0u, 30u, 31u);
+    cfsm_latency_record(&shards[1], 5u, 2, 0u, 30u, 31u);
+
+    cfsm_latency_merge(&shards[0], &shards[1]);
+
+    wait = cfsm_latency_get(&shards[0], 0u, 2, CFSM_LATENCY_WAIT);
+    TEST_ASSERT_EQUAL_UINT32(2u, wait->count);
+    TEST_ASSERT_EQUAL_UINT32(30u, wait->max);
+    TEST_ASSERT_EQUAL_UINT64(40u, wait->sum);
+    TEST_ASSERT_EQUAL_UINT32(1u, shards[0].dropped);
+}
+
+void test_cfsm_latency_report_should_list_used_histograms(void)
+{
+    char text[1024];
+    size_t length;
+    FILE * out = tmpfile();
+
+    TEST_ASSERT_NOT_NULL(out);
+
+    cfsm_latency_record(&shards[0], 1u, 2, 0u, 10u, 11u);
+    cfsm_latency_report(&shards[0], out);
+
+    rewind(out);
+    length = fread(text, 1u, sizeof(text) - 1u, out);
+    text[length] = '\0';
+    fclose(out);
+
+    TEST_ASSERT_NOT_NULL(strstr(text, "p99.9"));
+    TEST_ASSERT_NOT_NULL(strstr(text, "wait"));
+    TEST_ASSERT_NOT_NULL(strstr(text, "handle"));
+}
+
+int main(void)
+{
+    UNITY_BEGIN();
+
+    RUN_TEST(test_cfsm_histogram_should_be_exact_for_small_values);
+    RUN_TEST(test_cfsm_histogram_should_bound_relative_error);
+    RUN_TEST(test_cfsm_histogram_should_report_percentiles);
+    RUN_TEST(test_cfsm_latency_event_should_record_wait_and_handle);
+    RUN_TEST(test_cfsm_latency_should_drop_unknown_events);
+    RUN_TEST(test_cfsm_latency_should_handle_clock_wrap);
+    RUN_TEST(test_cfsm_latency_merge_should_add_shards);
+    RUN_TEST(test_cfsm_latency_report_should_list_used_histograms);
+
+    return UNITY_END();
+}
+
+/******************************************************************************
+ * Local functions
+ *****************************************************************************/
+
+static uint32_t Test_clock(void)
+{
+    return clockNow;
+}
+
+static void State_Work_onEnter(cfsm_Ctx * fsm)
+{
+    fsm->onEvent = State_Work_onEvent;
+}
+
+static void State_Work_onEvent(cfsm_Ctx * fsm, int eventId)
+{
+    (void)fsm;
+
+    if (EVENT_WORK == eventId)
+    {
+        clockNow += HANDLE_TICKS;
+    }
+}
+
+/** @} */
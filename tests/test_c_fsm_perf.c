@@ -0,0 +1,217 @@
+/* MIT License
+ *
+ * Copyright (C) 2024  Haju Schulz <haju@schulznorbert.de>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+/*******************************************************************************
+    DESCRIPTION
+*******************************************************************************/
+/**
+ * @brief  CFSM hardware performance counter test suite
+ *
+ * The counters are not available on every test host, so counter values
+ * are only checked if they could be opened.
+ *
+ * @addtogroup tests
+ *
+ * @{
+ */
+
+/******************************************************************************
+ * Includes
+ *****************************************************************************/
+
+#include <stdio.h>
+#include <string.h>
+#include <unity.h>
+
+#include "c_fsm_perf.h"
+
+/******************************************************************************
+ * Macros
+ *****************************************************************************/
+
+#define EVENT_START 1  /**< Moves Idle to Busy */
+
+/******************************************************************************
+ * Types and Classes
+ *****************************************************************************/
+
+/******************************************************************************
+ * Prototypes
+ *****************************************************************************/
+
+static void State_Idle_onEnter(cfsm_Ctx * fsm);
+static void State_Idle_onEvent(cfsm_Ctx * fsm, int eventId);
+static void State_Busy_onEnter(cfsm_Ctx * fsm);
+static void State_Busy_onProcess(cfsm_Ctx * fsm);
+
+/******************************************************************************
+ * Variables
+ *****************************************************************************/
+
+static cfsm_Perf perf;                  /**< counters under test   */
+static cfsm_PerfState states[2];        /**< counter state table   */
+static cfsm_Ctx fsm;                    /**< measured state machine */
+static volatile unsigned long busyWork; /**< Busy process result   */
+
+/******************************************************************************
+ * External functions
+ *****************************************************************************/
+
+void setUp(void)
+{
+    (void)cfsm_perf_open(&perf, states, 2u);
+    cfsm_init(&fsm, NULL);
+}
+
+void tearDown(void)
+{
+    cfsm_perf_close(&perf);
+}
+
+void test_cfsm_perf_open_should_report_available_counters(void)
+{
+    uint64_t values[CFSM_PERF_COUNTERS];
+
+    TEST_ASSERT_EQUAL_UINT(0u, perf.available >> CFSM_PERF_COUNTERS);
+
+    cfsm_perf_read(&perf, values);
+
+    for (unsigned int i = 0u; i < (unsigned int)CFSM_PERF_COUNTERS; ++i)
+    {
+        if (0u == (perf.available & (1u << i)))
+        {
+            TEST_ASSERT_EQUAL_UINT64(0u, values[i]);
+        }
+    }
+}
+
+void test_cfsm_perf_should_attribute_calls_to_states(void)
+{
+    cfsm_transition(&fsm, State_Idle_onEnter);
+    cfsm_perf_event(&perf, &fsm, EVENT_START);
+    cfsm_perf_process(&perf, &fsm);
+    cfsm_perf_process(&perf, &fsm);
+
+    TEST_ASSERT_EQUAL_UINT(2u, perf.count);
+    TEST_ASSERT_EQUAL_PTR(State_Idle_onEnter, states[0].state);
+    TEST_ASSERT_EQUAL_UINT32(1u, states[0].calls);
+    TEST_ASSERT_EQUAL_PTR(State_Busy_onEnter, states[1].state);
+    TEST_ASSERT_EQUAL_UINT32(2u, states[1].calls);
+
+    if (0u != (perf.available & (1u << CFSM_PERF_INSTRUCTIONS)))
+    {
+        TEST_ASSERT_TRUE(states[1].counts[CFSM_PERF_INSTRUCTIONS] > 0u);
+    }
+}
+
+void test_cfsm_perf_should_ignore_stopped_fsm(void)
+{
+    cfsm_perf_process(&perf, &fsm);
+    cfsm_perf_event(&perf, &fsm, EVENT_START);
+
+    TEST_ASSERT_EQUAL_UINT(0u, perf.count);
+}
+
+void test_cfsm_perf_should_drop_states_beyond_capacity(void)
+{
+    cfsm_perf_close(&perf);
+    (void)cfsm_perf_open(&perf, states, 1u);
+
+    cfsm_transition(&fsm, State_Idle_onEnter);
+    cfsm_perf_event(&perf, &fsm, EVENT_START);
+    cfsm_perf_process(&perf, &fsm);
+
+    TEST_ASSERT_EQUAL_UINT(1u, perf.count);
+    TEST_ASSERT_EQUAL_UINT32(1u, perf.dropped);
+}
+
+void test_cfsm_perf_report_should_list_named_states(void)
+{
+    char text[1024];
+    size_t length;
+    FILE * out = tmpfile();
+
+    TEST_ASSERT_NOT_NULL(out);
+
+    cfsm_perf_name(&perf, State_Busy_onEnter, "Busy");
+    cfsm_transition(&fsm, State_Busy_onEnter);
+    cfsm_perf_process(&perf, &fsm);
+    cfsm_perf_close(&perf);
+
+    cfsm_perf_report(&perf, out);
+    rewind(out);
+    length = fread(text, 1u, sizeof(text) - 1u, out);
+    text[length] = '\0';
+    fclose(out);
+
+    TEST_ASSERT_NOT_NULL(strstr(text, "Busy"));
+    TEST_ASSERT_NOT_NULL(strstr(text, "cycles/call"));
+}
+
+int main(void)
+{
+    UNITY_BEGIN();
+
+    RUN_TEST(test_cfsm_perf_open_should_report_available_counters);
+    RUN_TEST(test_cfsm_perf_should_attribute_calls_to_states);
+    RUN_TEST(test_cfsm_perf_should_ignore_stopped_fsm);
+    RUN_TEST(test_cfsm_perf_should_drop_states_beyond_capacity);
+    RUN_TEST(test_cfsm_perf_report_should_list_named_states);
+
+    return UNITY_END();
+}
+
+/******************************************************************************
+ * Local functions
+ *****************************************************************************/
+
+static void State_Idle_onEnter(cfsm_Ctx * fsm)
+{
+    fsm->onEvent = State_Idle_onEvent;
+}
+
+static void State_Idle_onEvent(cfsm_Ctx * fsm, int eventId)
+{
+    if (EVENT_START == eventId)
+    {
+        cfsm_transition(fsm, State_Busy_onEnter);
+    }
+}
+
+static void State_Busy_onEnter(cfsm_Ctx * fsm)
+{
+    fsm->onProcess = State_Busy_onProcess;
+}
+
+static void State_Busy_onProcess(cfsm_Ctx * fsm)
+{
+    (void)fsm;
+
+    for (unsigned long i = 0u; i < 1000u; ++i)
+    {
+        busyWork += i;
+    }
+}
+
+/** @} */
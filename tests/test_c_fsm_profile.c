@@ -0,0 +1,245 @@
+/* MIT License
+ *
+ * Copyright (C) 2024  Haju Schulz <haju@schulznorbert.de>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+/*******************************************************************************
+    DESCRIPTION
+*******************************************************************************/
+/**
+ * @brief  CFSM profiler test suite
+ *
+ * @addtogroup tests
+ *
+ * @{
+ */
+
+/******************************************************************************
+ * Includes
+ *****************************************************************************/
+
+#include <stdio.h>
+#include <string.h>
+#include <unity.h>
+
+#include "c_fsm_profile.h"
+
+/******************************************************************************
+ * Macros
+ *****************************************************************************/
+
+#define EVENT_START  1  /**< Moves Idle to Busy          */
+#define ENTER_TICKS  3  /**< Clock ticks of Busy enter   */
+#define PROCESS_TICKS 5 /**< Clock ticks of Busy process */
+
+/******************************************************************************
+ * Types and Classes
+ *****************************************************************************/
+
+/******************************************************************************
+ * Prototypes
+ *****************************************************************************/
+
+static cfsm_ProfileTick Test_clock(void);
+static void State_Idle_onEnter(cfsm_Ctx * fsm);
+static void State_Idle_onEvent(cfsm_Ctx * fsm, int eventId);
+static void State_Busy_onEnter(cfsm_Ctx * fsm);
+static void State_Busy_onProcess(cfsm_Ctx * fsm);
+
+/******************************************************************************
+ * Variables
+ *****************************************************************************/
+
+static cfsm_Profile profile;            /**< profile under test    */
+static cfsm_ProfileState states[2];     /**< profile state table   */
+static cfsm_ProfileTick clockNow;       /**< fake clock time       */
+static cfsm_Ctx fsm;                    /**< profiled state machine */
+
+/******************************************************************************
+ * External functions
+ *****************************************************************************/
+
+void setUp(void)
+{
+    /* Start above 0, which marks stays without a start time. */
+    clockNow = 1000u;
+
+    cfsm_profile_init(&profile, states, 2u, Test_clock);
+    cfsm_profile_attach(&profile);
+    cfsm_init(&fsm, NULL);
+}
+
+void tearDown(void)
+{
+    cfsm_profile_attach(NULL);
+}
+
+void test_cfsm_profile_should_record_operation_ticks(void)
+{
+    cfsm_transition(&fsm, State_Busy_onEnter);
+    cfsm_process(&fsm);
+    cfsm_process(&fsm);
+
+    TEST_ASSERT_EQUAL_UINT(1u, profile.count);
+    TEST_ASSERT_EQUAL_PTR(State_Busy_onEnter, states[0].state);
+    TEST_ASSERT_EQUAL_UINT32(1u, states[0].calls[CFSM_PROFILE_ENTER]);
+    TEST_ASSERT_EQUAL_UINT64(ENTER_TICKS, states[0].ticks[CFSM_PROFILE_ENTER]);
+    TEST_ASSERT_EQUAL_UINT32(2u, states[0].calls[CFSM_PROFILE_PROCESS]);
+    TEST_ASSERT_EQUAL_UINT64(2 * PROCESS_TICKS, states[0].ticks[CFSM_PROFILE_PROCESS]);
+}
+
+void test_cfsm_profile_should_charge_event_to_handling_state(void)
+{
+    cfsm_transition(&fsm, State_Idle_onEnter);
+    cfsm_event(&fsm, EVENT_START);
+
+    /* The Idle event handler includes the nested Busy enter. */
+    TEST_ASSERT_EQUAL_PTR(State_Idle_onEnter, states[0].state);
+    TEST_ASSERT_EQUAL_UINT32(1u, states[0].calls[CFSM_PROFILE_EVENT]);
+    TEST_ASSERT_EQUAL_UINT64(ENTER_TICKS, states[0].ticks[CFSM_PROFILE_EVENT]);
+    TEST_ASSERT_EQUAL_PTR(State_Busy_onEnter, states[1].state);
+    TEST_ASSERT_EQUAL_UINT32(0u, states[1].calls[CFSM_PROFILE_EVENT]);
+}
+
+void test_cfsm_profile_should_record_dwell_time(void)
+{
+    cfsm_transition(&fsm, State_Idle_onEnter);
+    clockNow += 100u;
+    cfsm_transition(&fsm, State_Busy_onEnter);
+
+    TEST_ASSERT_EQUAL_UINT32(1u, states[0].dwellCount);
+    TEST_ASSERT_EQUAL_UINT64(100u, states[0].dwellTicks);
+    TEST_ASSERT_EQUAL_UINT32(1u, states[0].dwell[7]); /* 64 <= 100 < 128 */
+    TEST_ASSERT_EQUAL_UINT32(0u, states[1].dwellCount);
+}
+
+void test_cfsm_profile_should_not_record_when_detached(void)
+{
+    cfsm_profile_attach(NULL);
+
+    cfsm_transition(&fsm, State_Busy_onEnter);
+    cfsm_process(&fsm);
+
+    TEST_ASSERT_EQUAL_UINT(0u, profile.count);
+}
+
+void test_cfsm_profile_should_drop_states_beyond_capacity(void)
+{
+    cfsm_profile_init(&profile, states, 1u, Test_clock);
+
+    cfsm_transition(&fsm, State_Idle_onEnter);
+    cfsm_transition(&fsm, State_Busy_onEnter);
+
+    TEST_ASSERT_EQUAL_UINT(1u, profile.count);
+    TEST_ASSERT_NOT_EQUAL(0u, profile.dropped);
+}
+
+void test_cfsm_profile_should_cache_slot_on_enter(void)
+{
+    cfsm_transition(&fsm, State_Idle_onEnter);
+    cfsm_transition(&fsm, State_Busy_onEnter);
+
+    TEST_ASSERT_EQUAL_UINT32(1u, fsm.profileSlot);
+
+    /* A fresh profile has a different table, the slot is searched again. */
+    cfsm_profile_init(&profile, states, 2u, Test_clock);
+    cfsm_process(&fsm);
+
+    TEST_ASSERT_EQUAL_UINT(1u, profile.count);
+    TEST_ASSERT_EQUAL_PTR(State_Busy_onEnter, states[0].state);
+    TEST_ASSERT_EQUAL_UINT32(1u, states[0].calls[CFSM_PROFILE_PROCESS]);
+    TEST_ASSERT_EQUAL_UINT32(0u, profile.dropped);
+}
+
+void test_cfsm_profile_report_should_list_named_states(void)
+{
+    char text[1024];
+    size_t length;
+    FILE * out = tmpfile();
+
+    TEST_ASSERT_NOT_NULL(out);
+
+    cfsm_profile_name(&profile, State_Busy_onEnter, "Busy");
+    cfsm_transition(&fsm, State_Busy_onEnter);
+    cfsm_process(&fsm);
+    cfsm_transition(&fsm, State_Idle_onEnter);
+
+    cfsm_profile_report(&profile, out);
+    rewind(out);
+    length = fread(text, 1u, sizeof(text) - 1u, out);
+    text[length] = '\0';
+    fclose(out);
+
+    TEST_ASSERT_NOT_NULL(strstr(text, "Busy"));
+    TEST_ASSERT_NOT_NULL(strstr(text, "process"));
+}
+
+int main(void)
+{
+    UNITY_BEGIN();
+
+    RUN_TEST(test_cfsm_profile_should_record_operation_ticks);
+    RUN_TEST(test_cfsm_profile_should_charge_event_to_handling_state);
+    RUN_TEST(test_cfsm_profile_should_record_dwell_time);
+    RUN_TEST(test_cfsm_profile_should_not_record_when_detached);
+    RUN_TEST(test_cfsm_profile_should_drop_states_beyond_capacity);
+    RUN_TEST(test_cfsm_profile_should_cache_slot_on_enter);
+    RUN_TEST(test_cfsm_profile_report_should_list_named_states);
+
+    return UNITY_END();
+}
+
+/******************************************************************************
+ * Local functions
+ *****************************************************************************/
+
+static cfsm_ProfileTick Test_clock(void)
+{
+    return clockNow;
+}
+
+static void State_Idle_onEnter(cfsm_Ctx * fsm)
+{
+    fsm->onEvent = State_Idle_onEvent;
+}
+
+static void State_Idle_onEvent(cfsm_Ctx * fsm, int eventId)
+{
+    if (EVENT_START == eventId)
+    {
+        cfsm_transition(fsm, State_Busy_onEnter);
+    }
+}
+
+static void State_Busy_onEnter(cfsm_Ctx * fsm)
+{
+    clockNow += ENTER_TICKS;
+    fsm->onProcess = State_Busy_onProcess;
+}
+
+static void State_Busy_onProcess(cfsm_Ctx * fsm)
+{
+    (void)fsm;
+    clockNow += PROCESS_TICKS;
+}
+
+/** @} */
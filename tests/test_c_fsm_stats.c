@@ -0,0 +1,316 @@
+/* MIT License
+ *
+ * Copyright (C) 2024  Haju Schulz <haju@schulznorbert.de>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+/*******************************************************************************
+    DESCRIPTION
+*******************************************************************************/
+/**
+ * @brief  CFSM live statistics segment test suite
+ *
+ * @addtogroup tests
+ *
+ * @{
+ */
+
+/******************************************************************************
+ * Includes
+ *****************************************************************************/
+
+#include <stdio.h>
+#include <string.h>
+#include <unity.h>
+
+#include "c_fsm_stats.h"
+
+/******************************************************************************
+ * Macros
+ *****************************************************************************/
+
+#define EVENT_START 1  /**< Moves Idle to Busy      */
+#define INSTANCES   5  /**< Test fleet size         */
+#define ROWS        4  /**< Rows of each kind       */
+#define SHM_NAME    "/cfsm_test_stats"  /**< Shared memory test object */
+
+/******************************************************************************
+ * Types and Classes
+ *****************************************************************************/
+
+/******************************************************************************
+ * Prototypes
+ *****************************************************************************/
+
+static const char * Test_stateName(cfsm_TransitionFunction state);
+static void State_Idle_onEnter(cfsm_Ctx * fsm);
+static void State_Idle_onEvent(cfsm_Ctx * fsm, int eventId);
+static void State_Busy_onEnter(cfsm_Ctx * fsm);
+
+/******************************************************************************
+ * Variables
+ *****************************************************************************/
+
+static uint64_t memory[1024];                /**< segment storage     */
+static uint64_t copy[1024];                  /**< snapshot storage    */
+static cfsm_StatsSegment * segment;          /**< segment under test  */
+static cfsm_StatsSegment * snapshot;         /**< snapshot of segment */
+static cfsm_FleetEntry entries[INSTANCES];   /**< fleet storage       */
+static cfsm_Fleet fleet;                     /**< published fleet     */
+static cfsm_Hits hits;                       /**< published events    */
+static cfsm_HitCell cells[16];               /**< hit matrix storage  */
+
+/******************************************************************************
+ * External functions
+ *****************************************************************************/
+
+void setUp(void)
+{
+    size_t index;
+
+    TEST_ASSERT_TRUE(cfsm_stats_size(ROWS, ROWS, ROWS) <= sizeof(memory));
+
+    segment  = cfsm_stats_init(memory, ROWS, ROWS, ROWS);
+    snapshot = (cfsm_StatsSegment *)copy;
+
+    cfsm_hits_init(&hits, cells, 16u);
+    cfsm_hits_attach(&hits);
+
+    cfsm_fleet_init(&fleet, entries, INSTANCES);
+    for (index = 0u; index < INSTANCES; ++index)
+    {
+        cfsm_transition(cfsm_fleet_add(&fleet, NULL), State_Idle_onEnter);
+    }
+}
+
+void tearDown(void)
+{
+    cfsm_hits_attach(NULL);
+}
+
+void test_cfsm_stats_should_publish_states(void)
+{
+    const cfsm_StatsState * states;
+
+    /* The second event reaches Busy, which has no handler. */
+    cfsm_event(cfsm_fleet_at(&fleet, 3u), EVENT_START);
+    cfsm_event(cfsm_fleet_at(&fleet, 3u), EVENT_START);
+    cfsm_event(cfsm_fleet_at(&fleet, 4u), EVENT_START);
+
+    cfsm_stats_begin(segment);
+    cfsm_stats_fleet(segment, &fleet, Test_stateName);
+    cfsm_stats_hits(segment, &hits, Test_stateName);
+    cfsm_stats_end(segment);
+
+    TEST_ASSERT_EQUAL_INT(0, cfsm_stats_snapshot(segment, snapshot, sizeof(copy)));
+    TEST_ASSERT_EQUAL_UINT32(2u, snapshot->sequence);
+    TEST_ASSERT_EQUAL_UINT64(1u, snapshot->publishes);
+    TEST_ASSERT_EQUAL_UINT64(3u, snapshot->events);
+    TEST_ASSERT_EQUAL_UINT32(2u, snapshot->states);
+
+    states = cfsm_stats_states(snapshot);
+    TEST_ASSERT_EQUAL_STRING("Idle", states[0].name);
+    TEST_ASSERT_EQUAL_UINT32(3u, states[0].instances);
+    TEST_ASSERT_EQUAL_UINT64(2u, states[0].events);
+    TEST_ASSERT_EQUAL_STRING("Busy", states[1].name);
+    TEST_ASSERT_EQUAL_UINT32(2u, states[1].instances);
+    TEST_ASSERT_EQUAL_UINT64(1u, states[1].events);
+    TEST_ASSERT_EQUAL_UINT64(1u, states[1].unhandled);
+}
+
+void test_cfsm_stats_should_keep_rows_across_updates(void)
+{
+    cfsm_Histogram histogram;
+    uint32_t value;
+    const cfsm_StatsQueue * queues;
+    const cfsm_StatsLatency * latencies;
+
+    cfsm_histogram_reset(&histogram);
+    for (value = 1u; value <= 1000u; ++value)
+    {
+        cfsm_histogram_record(&histogram, value);
+    }
+
+    cfsm_stats_begin(segment);
+    cfsm_stats_queue(segment, "rx", 7u, 64u);
+    cfsm_stats_queue(segment, "tx", 1u, 0u);
+    cfsm_stats_latency(segment, "wait", &histogram);
+    cfsm_stats_end(segment);
+
+    cfsm_stats_begin(segment);
+    cfsm_stats_queue(segment, "tx", 3u, 0u);
+    cfsm_stats_end(segment);
+
+    TEST_ASSERT_EQUAL_INT(0, cfsm_stats_snapshot(segment, snapshot, sizeof(copy)));
+    queues = cfsm_stats_queues(snapshot);
+    latencies = cfsm_stats_latencies(snapshot);
+
+    TEST_ASSERT_EQUAL_UINT32(2u, snapshot->queues);
+    TEST_ASSERT_EQUAL_STRING("rx", queues[0].name);
+    TEST_ASSERT_EQUAL_UINT32(0u, queues[0].depth);
+    TEST_ASSERT_EQUAL_UINT32(3u, queues[1].depth);
+    TEST_ASSERT_EQUAL_STRING("wait", latencies[0].name);
+    TEST_ASSERT_EQUAL_UINT64(0u, latencies[0].count);
+
+    cfsm_stats_begin(segment);
+    cfsm_stats_latency(segment, "wait", &histogram);
+    cfsm_stats_end(segment);
+
+    TEST_ASSERT_EQUAL_INT(0, cfsm_stats_snapshot(segment, snapshot, sizeof(copy)));
+    TEST_ASSERT_EQUAL_UINT64(1000u, latencies[0].count);
+    TEST_ASSERT_EQUAL_UINT32(1000u, latencies[0].max);
+    TEST_ASSERT_UINT32_WITHIN(16u, 500u, latencies[0].p50);
+    TEST_ASSERT_UINT32_WITHIN(32u, 990u, latencies[0].p99);
+}
+
+void test_cfsm_stats_should_limit_rows_and_names(void)
+{
+    static const char * const names[] = { "a", "b", "c", "d", "e" };
+    size_t index;
+
+    cfsm_stats_begin(segment);
+    for (index = 0u; index < 5u; ++index)
+    {
+        cfsm_stats_queue(segment, names[index], 1u, 0u);
+    }
+    TEST_ASSERT_NOT_NULL(cfsm_stats_state(segment, "this name is longer than a row name buffer"));
+    cfsm_stats_end(segment);
+
+    TEST_ASSERT_EQUAL_UINT32(ROWS, segment->queues);
+    TEST_ASSERT_EQUAL_UINT32(1u, segment->states);
+    TEST_ASSERT_EQUAL_STRING("this name is longer than a row ",
+        cfsm_stats_states(segment)[0].name);
+}
+
+void test_cfsm_stats_snapshot_should_fail_during_update(void)
+{
+    /* Gives up after the backoff window, telling the busy case apart. */
+    cfsm_stats_begin(segment);
+    TEST_ASSERT_EQUAL_INT(-2, cfsm_stats_snapshot(segment, snapshot, sizeof(copy)));
+    cfsm_stats_end(segment);
+
+    TEST_ASSERT_EQUAL_INT(-1, cfsm_stats_snapshot(segment, snapshot, sizeof(cfsm_StatsSegment)));
+    TEST_ASSERT_EQUAL_INT(0, cfsm_stats_snapshot(segment, snapshot, sizeof(copy)));
+}
+
+void test_cfsm_stats_snapshot_should_clamp_corrupt_rows(void)
+{
+    cfsm_StatsState * states = (cfsm_StatsState *)(segment + 1);
+
+    cfsm_stats_begin(segment);
+    cfsm_stats_state(segment, "a");
+    cfsm_stats_end(segment);
+
+    /* A broken publisher overstates the rows and leaves a name open. */
+    segment->states    = ROWS + 100u;
+    segment->latencies = 0xFFFFFFFFu;
+    memset(states[0].name, 'x', CFSM_STATS_NAME);
+
+    TEST_ASSERT_EQUAL_INT(0, cfsm_stats_snapshot(segment, snapshot, sizeof(copy)));
+    TEST_ASSERT_EQUAL_UINT32(ROWS, snapshot->states);
+    TEST_ASSERT_EQUAL_UINT32(0u, snapshot->queues);
+    TEST_ASSERT_EQUAL_UINT32(ROWS, snapshot->latencies);
+    TEST_ASSERT_EQUAL_UINT(CFSM_STATS_NAME - 1u, strlen(cfsm_stats_states(snapshot)[0].name));
+}
+
+void test_cfsm_stats_should_share_segment(void)
+{
+#if defined(__unix__) || defined(__APPLE__)
+    cfsm_StatsSegment * shared = cfsm_stats_create(SHM_NAME, ROWS, ROWS, ROWS);
+    const cfsm_StatsSegment * reader;
+
+    if ((cfsm_StatsSegment *)0 == shared)
+    {
+        TEST_IGNORE_MESSAGE("no shared memory");
+    }
+
+    cfsm_stats_begin(shared);
+    cfsm_stats_queue(shared, "rx", 5u, 8u);
+    cfsm_stats_end(shared);
+
+    reader = cfsm_stats_open(SHM_NAME);
+    TEST_ASSERT_NOT_NULL(reader);
+    TEST_ASSERT_EQUAL_INT(0, cfsm_stats_snapshot(reader, snapshot, sizeof(copy)));
+    TEST_ASSERT_NOT_EQUAL(0u, snapshot->pid);
+    TEST_ASSERT_NOT_EQUAL(0u, snapshot->time);
+    TEST_ASSERT_EQUAL_UINT32(5u, cfsm_stats_queues(snapshot)[0].depth);
+
+    cfsm_stats_close(reader);
+    cfsm_stats_close(shared);
+    cfsm_stats_unlink(SHM_NAME);
+
+    TEST_ASSERT_NULL(cfsm_stats_open(SHM_NAME));
+#else
+    TEST_IGNORE_MESSAGE("no shared memory");
+#endif
+}
+
+int main(void)
+{
+    UNITY_BEGIN();
+
+    RUN_TEST(test_cfsm_stats_should_publish_states);
+    RUN_TEST(test_cfsm_stats_should_keep_rows_across_updates);
+    RUN_TEST(test_cfsm_stats_should_limit_rows_and_names);
+    RUN_TEST(test_cfsm_stats_snapshot_should_fail_during_update);
+    RUN_TEST(test_cfsm_stats_snapshot_should_clamp_corrupt_rows);
+    RUN_TEST(test_cfsm_stats_should_share_segment);
+
+    return UNITY_END();
+}
+
+/******************************************************************************
+ * Local functions
+ *****************************************************************************/
+
+static const char * Test_stateName(cfsm_TransitionFunction state)
+{
+    if (State_Idle_onEnter == state)
+    {
+        return "Idle";
+    }
+    if (State_Busy_onEnter == state)
+    {
+        return "Busy";
+    }
+
+    return NULL;
+}
+
+static void State_Idle_onEnter(cfsm_Ctx * fsm)
+{
+    fsm->onEvent = State_Idle_onEvent;
+}
+
+static void State_Idle_onEvent(cfsm_Ctx * fsm, int eventId)
+{
+    if (EVENT_START == eventId)
+    {
+        cfsm_transition(fsm, State_Busy_onEnter);
+    }
+}
+
+static void State_Busy_onEnter(cfsm_Ctx * fsm)
+{
+    (void)fsm;
+}
+
+/** @} */
@@ -0,0 +1,312 @@
+/* MIT License
+ *
+ * Copyright (C) 2024  Haju Schulz <haju@schulznorbert.de>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+/*******************************************************************************
+    DESCRIPTION
+*******************************************************************************/
+/**
+ * @brief  CFSM trace recorder test suite
+ *
+ * @addtogroup tests
+ *
+ * @{
+ */
+
+/******************************************************************************
+ * Includes
+ *****************************************************************************/
+
+#include <stdio.h>
+#include <string.h>
+#include <unity.h>
+
+#include "c_fsm_trace.h"
+
+/******************************************************************************
+ * Macros
+ *****************************************************************************/
+
+#define EVENT_START 1  /**< Moves Idle to Busy */
+#define RING_SIZE   4  /**< Test ring buffer   */
+
+/******************************************************************************
+ * Types and Classes
+ *****************************************************************************/
+
+/******************************************************************************
+ * Prototypes
+ *****************************************************************************/
+
+static uint64_t Test_clock(void);
+static void Test_countSink(void * sinkData, const cfsm_TraceRecord * records, size_t count);
+static const char * Test_stateName(cfsm_TransitionFunction state);
+static void Test_readBack(FILE * file, char * text, size_t size);
+static void State_Idle_onEnter(cfsm_Ctx * fsm);
+static void State_Idle_onEvent(cfsm_Ctx * fsm, int eventId);
+static void State_Busy_onEnter(cfsm_Ctx * fsm);
+
+/******************************************************************************
+ * Variables
+ *****************************************************************************/
+
+static cfsm_Trace trace;                    /**< trace under test      */
+static cfsm_TraceRecord records[RING_SIZE]; /**< trace ring buffer     */
+static uint64_t clockNow;                   /**< fake clock time       */
+static size_t sunk;                         /**< records seen by sink  */
+static cfsm_Ctx fsm;                        /**< traced state machine  */
+
+/******************************************************************************
+ * External functions
+ *****************************************************************************/
+
+void setUp(void)
+{
+    clockNow = 0u;
+    sunk = 0u;
+
+    cfsm_trace_init(&trace, records, RING_SIZE, Test_clock, NULL, NULL);
+    cfsm_trace_attach(&trace);
+    cfsm_init(&fsm, NULL);
+}
+
+void tearDown(void)
+{
+    cfsm_trace_attach(NULL);
+}
+
+void test_cfsm_trace_should_record_transitions_and_events(void)
+{
+    cfsm_transition(&fsm, State_Idle_onEnter);
+
+    TEST_ASSERT_EQUAL_UINT(2u, trace.count);
+    TEST_ASSERT_EQUAL_UINT32(CFSM_TRACE_LEAVE, records[0].kind);
+    TEST_ASSERT_NULL(records[0].state);
+    TEST_ASSERT_EQUAL_UINT32(CFSM_TRACE_ENTER, records[1].kind);
+    TEST_ASSERT_EQUAL_PTR(State_Idle_onEnter, records[1].state);
+    TEST_ASSERT_EQUAL_PTR(&fsm, records[1].fsm);
+    TEST_ASSERT_EQUAL_UINT64(2u, records[1].time);
+
+    cfsm_event(&fsm, EVENT_START);
+
+    TEST_ASSERT_EQUAL_UINT32(CFSM_TRACE_EVENT, records[2].kind);
+    TEST_ASSERT_EQUAL_PTR(State_Idle_onEnter, records[2].state);
+    TEST_ASSERT_EQUAL_INT32(EVENT_START, records[2].eventId);
+    TEST_ASSERT_EQUAL_UINT32(CFSM_TRACE_LEAVE, records[3].kind);
+    TEST_ASSERT_EQUAL_PTR(State_Idle_onEnter, records[3].state);
+}
+
+void test_cfsm_trace_should_record_dropped_batch_events(void)
+{
+    static const int batch[] = { 7, 8 };
+
+    /* Busy has no event handler, the whole batch is dropped. */
+    cfsm_transition(&fsm, State_Busy_onEnter);
+    TEST_ASSERT_EQUAL_UINT(0u, cfsm_eventBatch(&fsm, batch, 2u));
+
+    TEST_ASSERT_EQUAL_UINT(4u, trace.count);
+    TEST_ASSERT_EQUAL_UINT32(CFSM_TRACE_EVENT, records[2].kind);
+    TEST_ASSERT_EQUAL_PTR(State_Busy_onEnter, records[2].state);
+    TEST_ASSERT_EQUAL_INT32(7, records[2].eventId);
+    TEST_ASSERT_EQUAL_UINT32(CFSM_TRACE_EVENT, records[3].kind);
+    TEST_ASSERT_EQUAL_PTR(State_Busy_onEnter, records[3].state);
+    TEST_ASSERT_EQUAL_INT32(8, records[3].eventId);
+}
+
+void test_cfsm_trace_should_overwrite_oldest_without_sink(void)
+{
+    cfsm_transition(&fsm, State_Idle_onEnter);
+    cfsm_event(&fsm, EVENT_START);
+
+    /* leave, enter, event, leave, enter: the first leave is lost. */
+    TEST_ASSERT_EQUAL_UINT(RING_SIZE, trace.count);
+    TEST_ASSERT_EQUAL_UINT64(1u, trace.lost);
+    TEST_ASSERT_EQUAL_PTR(State_Busy_onEnter, records[0].state);
+    TEST_ASSERT_EQUAL_UINT32(CFSM_TRACE_ENTER, records[0].kind);
+}
+
+void test_cfsm_trace_should_drain_full_buffer_to_sink(void)
+{
+    cfsm_trace_init(&trace, records, RING_SIZE, Test_clock, Test_countSink, NULL);
+
+    cfsm_transition(&fsm, State_Idle_onEnter);
+    cfsm_event(&fsm, EVENT_START);
+
+    TEST_ASSERT_EQUAL_UINT(RING_SIZE, sunk);
+    TEST_ASSERT_EQUAL_UINT(1u, trace.count);
+    TEST_ASSERT_EQUAL_UINT64(0u, trace.lost);
+
+    cfsm_trace_drain(&trace, Test_countSink, NULL);
+
+    TEST_ASSERT_EQUAL_UINT(RING_SIZE + 1u, sunk);
+    TEST_ASSERT_EQUAL_UINT(0u, trace.count);
+}
+
+void test_cfsm_trace_init_should_reject_empty_buffer(void)
+{
+    TEST_ASSERT_EQUAL_INT(-1, cfsm_trace_init(&trace, records, 0u, Test_clock, NULL, NULL));
+    TEST_ASSERT_EQUAL_INT(-1, cfsm_trace_init(&trace, NULL, RING_SIZE, Test_clock, NULL, NULL));
+
+    /* The inert trace neither records nor drains. */
+    cfsm_transition(&fsm, State_Idle_onEnter);
+    cfsm_trace_drain(&trace, Test_countSink, NULL);
+
+    TEST_ASSERT_EQUAL_UINT(0u, trace.count);
+    TEST_ASSERT_EQUAL_UINT(0u, sunk);
+    TEST_ASSERT_EQUAL_UINT64(0u, clockNow);
+}
+
+void test_cfsm_trace_export_should_write_slices_and_instants(void)
+{
+    char text[2048];
+    cfsm_TraceExport exporter;
+    FILE * out = tmpfile();
+
+    TEST_ASSERT_NOT_NULL(out);
+
+    cfsm_transition(&fsm, State_Idle_onEnter);
+    cfsm_event(&fsm, EVENT_START);
+
+    cfsm_trace_exportBegin(&exporter, out, Test_stateName, NULL, 1000.0);
+    cfsm_trace_drain(&trace, cfsm_trace_exportSink, &exporter);
+    cfsm_trace_exportEnd(&exporter);
+
+    Test_readBack(out, text, sizeof(text));
+
+    /* Idle begin, event, Idle end, Busy begin. The stateless first leave
+     * was overwritten.
+     */
+    TEST_ASSERT_EQUAL_UINT64(4u, exporter.written);
+    TEST_ASSERT_NOT_NULL(strstr(text, "\"traceEvents\":["));
+    TEST_ASSERT_NOT_NULL(strstr(text, "\"ph\":\"B\""));
+    TEST_ASSERT_NOT_NULL(strstr(text, "\"name\":\"Busy\""));
+    TEST_ASSERT_NOT_NULL(strstr(text, "]}"));
+}
+
+void test_cfsm_trace_export_file_should_match_records(void)
+{
+    char text[4096];
+    cfsm_TraceExport exporter;
+    FILE * binary = tmpfile();
+    FILE * out = tmpfile();
+
+    TEST_ASSERT_NOT_NULL(binary);
+    TEST_ASSERT_NOT_NULL(out);
+
+    cfsm_trace_init(&trace, records, RING_SIZE, Test_clock, cfsm_trace_fileSink, binary);
+    cfsm_transition(&fsm, State_Idle_onEnter);
+    cfsm_event(&fsm, EVENT_START);
+    cfsm_event(&fsm, 7);
+    cfsm_trace_drain(&trace, trace.sink, trace.sinkData);
+
+    rewind(binary);
+    cfsm_trace_exportBegin(&exporter, out, Test_stateName, NULL, 1000.0);
+    TEST_ASSERT_EQUAL_UINT64(6u, cfsm_trace_exportFile(&exporter, binary));
+    cfsm_trace_exportEnd(&exporter);
+    fclose(binary);
+
+    Test_readBack(out, text, sizeof(text));
+
+    /* Idle begin, event, Idle end, Busy begin, event 7. */
+    TEST_ASSERT_EQUAL_UINT64(5u, exporter.written);
+    TEST_ASSERT_NOT_NULL(strstr(text, "\"ph\":\"E\""));
+    TEST_ASSERT_NOT_NULL(strstr(text, "\"name\":\"event 7\""));
+    TEST_ASSERT_NOT_NULL(strstr(text, "\"state\":\"Idle\""));
+    TEST_ASSERT_NOT_NULL(strstr(text, "\"ts\":0.006"));
+}
+
+int main(void)
+{
+    UNITY_BEGIN();
+
+    RUN_TEST(test_cfsm_trace_should_record_transitions_and_events);
+    RUN_TEST(test_cfsm_trace_should_record_dropped_batch_events);
+    RUN_TEST(test_cfsm_trace_should_overwrite_oldest_without_sink);
+    RUN_TEST(test_cfsm_trace_should_drain_full_buffer_to_sink);
+    RUN_TEST(test_cfsm_trace_init_should_reject_empty_buffer);
+    RUN_TEST(test_cfsm_trace_export_should_write_slices_and_instants);
+    RUN_TEST(test_cfsm_trace_export_file_should_match_records);
+
+    return UNITY_END();
+}
+
+/******************************************************************************
+ * Local functions
+ *****************************************************************************/
+
+static uint64_t Test_clock(void)
+{
+    return ++clockNow;
+}
+
+static void Test_countSink(void * sinkData, const cfsm_TraceRecord * records, size_t count)
+{
+    (void)sinkData;
+    (void)records;
+
+    sunk += count;
+}
+
+static const char * Test_stateName(cfsm_TransitionFunction state)
+{
+    if (State_Idle_onEnter == state)
+    {
+        return "Idle";
+    }
+    if (State_Busy_onEnter == state)
+    {
+        return "Busy";
+    }
+
+    return NULL;
+}
+
+static void Test_readBack(FILE * file, char * text, size_t size)
+{
+    size_t length;
+
+    rewind(file);
+    length = fread(text, 1u, size - 1u, file);
+    text[length] = '\0';
+    fclose(file);
+}
+
+static void State_Idle_onEnter(cfsm_Ctx * fsm)
+{
+    fsm->onEvent = State_Idle_onEvent;
+}
+
+static void State_Idle_onEvent(cfsm_Ctx * fsm, int eventId)
+{
+    if (EVENT_START == eventId)
+    {
+        cfsm_transition(fsm, State_Busy_onEnter);
+    }
+}
+
+static void State_Busy_onEnter(cfsm_Ctx * fsm)
+{
+    (void)fsm;
+}
+
+/** @} */
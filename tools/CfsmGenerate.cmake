@@ -0,0 +1,34 @@
+# ******************************************************************************
+# cfsm_generate(<target> <puml file> <prefix>)
+#
+# Generate table driven CFSM states from a PlantUML state diagram with
+# tools/cfsm_puml2c.py and add them to the sources of <target>. The
+# generated <prefix>.h is found through the target include path.
+# ******************************************************************************
+
+find_program(CFSM_PYTHON NAMES python3 python)
+
+set(CFSM_PUML2C "${CMAKE_CURRENT_LIST_DIR}/cfsm_puml2c.py")
+
+function(cfsm_generate TARGET PUML PREFIX)
+    if (NOT CFSM_PYTHON)
+        message(FATAL_ERROR "cfsm_generate() requires a Python 3 interpreter")
+    endif()
+
+    get_filename_component(input "${PUML}" ABSOLUTE)
+    set(output_dir "${CMAKE_CURRENT_BINARY_DIR}/cfsm_generated")
+
+    add_custom_command(
+        OUTPUT "${output_dir}/${PREFIX}.h" "${output_dir}/${PREFIX}.c"
+        COMMAND "${CFSM_PYTHON}" "${CFSM_PUML2C}" "${input}"
+                --prefix "${PREFIX}" --output-dir "${output_dir}"
+        DEPENDS "${input}" "${CFSM_PUML2C}"
+        COMMENT "Generating CFSM states ${PREFIX} from ${PUML}"
+    )
+
+    target_sources(${TARGET} PRIVATE
+        "${output_dir}/${PREFIX}.c"
+        "${output_dir}/${PREFIX}.h"
+    )
+    target_include_directories(${TARGET} PRIVATE "${output_dir}")
+endfunction()
@@ -0,0 +1,369 @@
+#!/usr/bin/env python3
+# MIT License
+#
+# Copyright (C) 2024  Haju Schulz <haju@schulznorbert.de>
+#
+# Permission is hereby granted, free of charge, to any person obtaining a copy
+# of this software and associated documentation files (the "Software"), to deal
+# in the Software without restriction, including without limitation the rights
+# to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+# copies of the Software, and to permit persons to whom the Software is
+# furnished to do so, subject to the following conditions:
+#
+# The above copyright notice and this permission notice shall be included in all
+# copies or substantial portions of the Software.
+#
+# THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+# IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+# FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+# AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+# LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+# OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+# SOFTWARE.
+
+"""Generate table driven CFSM states from a PlantUML state diagram.
+
+The diagram is the single source of truth for states and event driven
+transitions. Supported PlantUML elements:
+
+    state Name                      declares a state
+    [*] --> Name                    initial state
+    A --> B : EVENT                 transition on EVENT (a C identifier)
+    A --> [*] : EVENT               stop the FSM on EVENT
+    Name : entry/ function()        called after entering Name
+    Name : process/ function()      cyclic process operation of Name
+    Name : leave/ function()        leave operation of Name
+    Name : event/ function()        called for every event before the
+                                    transition table is consulted
+
+Arrows may have any length, direction hints and style segments (->,
+-->, -r->, -[#red]->, ...), need no surrounding spaces and may point
+backwards (B <-- A). Transitions without label or with labels that are
+no C identifier, like guards written as prose, are skipped with a note
+or warning on stderr. They are left to the event/ functions. Other
+arrow lines the generator does not understand are reported as well. Without any event transitions no transition table is
+generated and states only install their event/ function, if any.
+
+For prefix 'door' the generator writes door.h and door.c with
+door_<State>_onEnter() for each state, door_start(), door_stateName()
+and an enum of DOOR_EV_<EVENT> event IDs. The user provides the
+functions referenced by entry/, process/, leave/ and event/.
+"""
+
+import argparse
+import os
+import re
+import sys
+
+STATE_RE = re.compile(r'^state\s+(\w+)\s*$')
+# Arrow bodies may carry direction hints and [style] segments, like
+# -right->, -[#red]-> or <-[dashed]-, with or without surrounding spaces.
+ARROW_RE = re.compile(r'^(\[\*\]|\w+)\s*-+(?:(?:\[[^\]]*\]|[a-z]+)-*)*>\s*'
+                      r'(\[\*\]|\w+)\s*(?::\s*(.*))?$')
+REVERSE_RE = re.compile(r'^(\[\*\]|\w+)\s*<-+(?:(?:\[[^\]]*\]|[a-z]+)-+)*\s*'
+                        r'(\[\*\]|\w+)\s*(?::\s*(.*))?$')
+ANY_ARROW_RE = re.compile(r'[-.][^:]*>|<[-.]')
+ACTION_RE = re.compile(r'^(\w+)\s*:\s*(entry|process|leave|event)\s*/\s*(\w+)\s*\(\s*\)\s*$')
+IDENT_RE = re.compile(r'^[A-Za-z_]\w*$')
+
+
+def parse_arrow(line):
+    """Get (source, target, label) of an arrow line or None."""
+    match = ARROW_RE.match(line)
+    if match:
+        source, target, label = match.groups()
+    else:
+        match = REVERSE_RE.match(line)
+        if not match:
+            return None
+        target, source, label = match.groups()
+
+    return source, target, (label or '').strip()
+
+
+class Machine:
+    """Parsed state machine."""
+
+    def __init__(self):
+        self.states = []
+        self.events = []
+        self.initial = None
+        self.transitions = {}   # state -> {event: target or None}
+        self.actions = {}       # state -> {kind: function}
+
+    def add_state(self, name):
+        if name not in self.states:
+            self.states.append(name)
+            self.transitions[name] = {}
+            self.actions[name] = {}
+
+    def add_event(self, name):
+        if name not in self.events:
+            self.events.append(name)
+
+
+def parse(path):
+    machine = Machine()
+
+    with open(path, encoding='utf-8') as file:
+        lines = file.read().splitlines()
+
+    for number, line in enumerate(lines, 1):
+        line = line.strip()
+        if not line or line.startswith("'") or line.startswith('@'):
+            continue
+
+        match = STATE_RE.match(line)
+        if match:
+            machine.add_state(match.group(1))
+            continue
+
+        match = ACTION_RE.match(line)
+        if match:
+            state, kind, function = match.groups()
+            machine.add_state(state)
+            machine.actions[state][kind] = function
+            continue
+
+        arrow = parse_arrow(line)
+        if arrow:
+            source, target, label = arrow
+
+            if source == '[*]':
+                machine.add_state(target)
+                machine.initial = target
+                continue
+
+            machine.add_state(source)
+            if target != '[*]':
+                machine.add_state(target)
+
+            if not label:
+                sys.stderr.write('%s:%d: note: transition %s -> %s has no event '
+                                 'label, it is left to hand written code\n' %
+                                 (path, number, source, target))
+                continue
+
+            if not IDENT_RE.match(label):
+                sys.stderr.write('%s:%d: warning: skipping transition %s -> %s, '
+                                 'label "%s" is no C identifier\n' %
+                                 (path, number, source, target, label))
+                continue
+
+            machine.add_event(label)
+            known = machine.transitions[source].get(label, target)
+            if known != target:
+                sys.exit('%s:%d: conflicting transitions for %s on %s' %
+                         (path, number, source, label))
+            machine.transitions[source][label] = target
+            continue
+
+        if ANY_ARROW_RE.search(line.split(':', 1)[0]):
+            sys.stderr.write('%s:%d: warning: ignoring unsupported arrow "%s"\n' %
+                             (path, number, line))
+
+    if not machine.states:
+        sys.exit('%s: no states found' % path)
+    if machine.initial is None:
+        machine.initial = machine.states[0]
+
+    return machine
+
+
+def generate(machine, prefix, source_name):
+    upper = prefix.upper()
+    enter = lambda state: '%s_%s_onEnter' % (prefix, state)
+    banner = ('/* Generated by cfsm_puml2c.py from %s. Do not edit. */\n' %
+              source_name)
+
+    h = [banner]
+    h.append('#ifndef %s_H_INCLUDED\n#define %s_H_INCLUDED\n' % (upper, upper))
+    h.append('#include "c_fsm.h"\n')
+    h.append('#ifdef __cplusplus\nextern "C" {\n#endif\n')
+    h.append('/** Event IDs of the %s state machine */' % prefix)
+    h.append('typedef enum %s_Event {' % prefix)
+    for event in machine.events:
+        h.append('    %s_EV_%s,' % (upper, event))
+    h.append('    %s_EV_COUNT' % upper)
+    h.append('} %s_Event;\n' % prefix)
+
+    h.append('/* State enter operations. */')
+    for state in machine.states:
+        h.append('void %s(cfsm_Ctx * fsm);' % enter(state))
+
+    h.append('\n/* Application provided state operations. */')
+    for state in machine.states:
+        for kind, function in machine.actions[state].items():
+            if kind == 'event':
+                h.append('void %s(cfsm_Ctx * fsm, int eventId);' % function)
+            else:
+                h.append('void %s(cfsm_Ctx * fsm);' % function)
+
+    h.append('\n/** Transition fsm to the initial state %s. */' % machine.initial)
+    h.append('void %s_start(cfsm_Ctx * fsm);\n' % prefix)
+    h.append('/** Get the state name for a state identity or NULL if unknown. */')
+    h.append('const char * %s_stateName(cfsm_TransitionFunction state);\n' % prefix)
+    h.append('/** Get the event name for an event ID or NULL if unknown. */')
+    h.append('const char * %s_eventName(int eventId);\n' % prefix)
+    h.append('#ifdef __cplusplus\n}\n#endif\n')
+    h.append('#endif /* %s_H_INCLUDED */' % upper)
+
+    c = [banner]
+    c.append('#include <stddef.h>\n')
+    c.append('#include "%s.h"\n' % prefix)
+    # Without events there is nothing to dispatch, and the zero sized
+    # transition table and empty initializers would not be ISO C.
+    dispatch = bool(machine.events)
+    final = any(target == '[*]' for table in machine.transitions.values()
+                for target in table.values())
+    if final:
+        c.append('/** Marks transitions to [*], which stop the FSM. Never entered. */')
+        c.append('static void %s_final(cfsm_Ctx * fsm)\n{\n    (void)fsm;\n}\n' % prefix)
+
+    if dispatch:
+        for state in machine.states:
+            c.append('static void %s_%s_onEvent(cfsm_Ctx * fsm, int eventId);' %
+                     (prefix, state))
+        c.append('')
+
+        c.append('/** Dense transition table, NULL for "no transition" */')
+        c.append('static const cfsm_TransitionFunction %s_transitions[%d][%s_EV_COUNT] = {' %
+                 (prefix, len(machine.states), upper))
+        for state in machine.states:
+            c.append('    { /* %s */' % state)
+            for event in machine.events:
+                if event in machine.transitions[state]:
+                    target = machine.transitions[state][event]
+                    function = ('%s_final' % prefix) if target == '[*]' else enter(target)
+                else:
+                    function = 'NULL'
+                c.append('        %s, /* %s */' % (function, event))
+            c.append('    },')
+        c.append('};\n')
+
+    c.append('static const char * const %s_stateNames[%d] = {' %
+             (prefix, len(machine.states)))
+    c.extend('    "%s",' % state for state in machine.states)
+    c.append('};\n')
+
+    if dispatch:
+        c.append('static const char * const %s_eventNames[%s_EV_COUNT + 1] = {' %
+                 (prefix, upper))
+        c.extend('    "%s",' % event for event in machine.events)
+        c.append('    NULL')
+        c.append('};\n')
+
+    c.append('static const cfsm_TransitionFunction %s_states[%d] = {' %
+             (prefix, len(machine.states)))
+    c.extend('    %s,' % enter(state) for state in machine.states)
+    c.append('};\n')
+
+    if dispatch:
+        c.append('static void %s_dispatch(cfsm_Ctx * fsm, int row, int eventId)' % prefix)
+        c.append('{')
+        c.append('    if ((eventId >= 0) && (eventId < (int)%s_EV_COUNT))' % upper)
+        c.append('    {')
+        c.append('        cfsm_TransitionFunction next = %s_transitions[row][eventId];\n' % prefix)
+        if final:
+            c.append('        if (%s_final == next)' % prefix)
+            c.append('        {')
+            c.append('            cfsm_transition(fsm, (cfsm_TransitionFunction)0);')
+            c.append('        }')
+            c.append('        else if ((cfsm_TransitionFunction)0 != next)')
+        else:
+            c.append('        if ((cfsm_TransitionFunction)0 != next)')
+        c.append('        {')
+        c.append('            cfsm_transition(fsm, next);')
+        c.append('        }')
+        c.append('    }')
+        c.append('}\n')
+
+    for row, state in enumerate(machine.states):
+        actions = machine.actions[state]
+        if dispatch:
+            c.append('static void %s_%s_onEvent(cfsm_Ctx * fsm, int eventId)' % (prefix, state))
+            c.append('{')
+            if 'event' in actions:
+                c.append('    %s(fsm, eventId);\n' % actions['event'])
+                c.append('    /* The event operation may have transitioned already. */')
+                c.append('    if (%s != fsm->state)' % enter(state))
+                c.append('    {')
+                c.append('        return;')
+                c.append('    }')
+            c.append('    %s_dispatch(fsm, %d, eventId);' % (prefix, row))
+            c.append('}\n')
+
+        c.append('void %s(cfsm_Ctx * fsm)' % enter(state))
+        c.append('{')
+        if dispatch:
+            c.append('    fsm->onEvent = %s_%s_onEvent;' % (prefix, state))
+        elif 'event' in actions:
+            c.append('    fsm->onEvent = %s;' % actions['event'])
+        elif not actions:
+            c.append('    (void)fsm;')
+        if 'process' in actions:
+            c.append('    fsm->onProcess = %s;' % actions['process'])
+        if 'leave' in actions:
+            c.append('    fsm->onLeave = %s;' % actions['leave'])
+        if 'entry' in actions:
+            separator = '\n' if (dispatch or len(actions) > 1) else ''
+            c.append('%s    %s(fsm);' % (separator, actions['entry']))
+        c.append('}\n')
+
+    c.append('void %s_start(cfsm_Ctx * fsm)' % prefix)
+    c.append('{')
+    c.append('    cfsm_transition(fsm, %s);' % enter(machine.initial))
+    c.append('}\n')
+
+    c.append('const char * %s_stateName(cfsm_TransitionFunction state)' % prefix)
+    c.append('{')
+    c.append('    for (size_t i = 0u; i < %d; ++i)' % len(machine.states))
+    c.append('    {')
+    c.append('        if (%s_states[i] == state)' % prefix)
+    c.append('        {')
+    c.append('            return %s_stateNames[i];' % prefix)
+    c.append('        }')
+    c.append('    }')
+    c.append('\n    return NULL;')
+    c.append('}\n')
+
+    c.append('const char * %s_eventName(int eventId)' % prefix)
+    c.append('{')
+    if dispatch:
+        c.append('    if ((eventId < 0) || (eventId >= (int)%s_EV_COUNT))' % upper)
+        c.append('    {')
+        c.append('        return NULL;')
+        c.append('    }')
+        c.append('\n    return %s_eventNames[eventId];' % prefix)
+    else:
+        c.append('    (void)eventId;\n')
+        c.append('    return NULL;')
+    c.append('}')
+
+    return '\n'.join(h) + '\n', '\n'.join(c) + '\n'
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument('input', help='PlantUML state diagram')
+    parser.add_argument('--prefix', required=True,
+                        help='C identifier prefix and output file base name')
+    parser.add_argument('--output-dir', default='.',
+                        help='directory for the generated .h and .c file')
+    args = parser.parse_args()
+
+    if not IDENT_RE.match(args.prefix):
+        sys.exit('prefix must be a C identifier')
+
+    machine = parse(args.input)
+    header, source = generate(machine, args.prefix, os.path.basename(args.input))
+
+    os.makedirs(args.output_dir, exist_ok=True)
+    for extension, text in (('.h', header), ('.c', source)):
+        with open(os.path.join(args.output_dir, args.prefix + extension), 'w',
+                  encoding='utf-8') as file:
+            file.write(text)
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,163 @@
+#!/usr/bin/env python3
+# MIT License
+#
+# Copyright (C) 2024  Haju Schulz <haju@schulznorbert.de>
+#
+# Permission is hereby granted, free of charge, to any person obtaining a copy
+# of this software and associated documentation files (the "Software"), to deal
+# in the Software without restriction, including without limitation the rights
+# to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+# copies of the Software, and to permit persons to whom the Software is
+# furnished to do so, subject to the following conditions:
+#
+# The above copyright notice and this permission notice shall be included in all
+# copies or substantial portions of the Software.
+#
+# THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+# IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+# FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+# AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+# LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+# OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+# SOFTWARE.
+
+"""Annotate a PlantUML state diagram with measured event hit counts.
+
+Reads the diagram and a CSV written by cfsm_hits_writeCsv() with the
+columns state, event, hits and unhandled. State and event names must
+match the diagram, as written with the <prefix>_stateName() and
+<prefix>_eventName() functions of cfsm_puml2c.py generated code.
+
+The output is the same diagram where
+
+    A --> B : EVENT                 gets the hit count as second label line,
+                                    or a red "never" if it was not taken
+    A : ...                         gets a note listing events that reached
+                                    A without a diagram transition, split
+                                    into handled in code and unhandled
+
+Pairs of unknown states, including the stopped FSM [*], are listed in a
+legend.
+"""
+
+import argparse
+import csv
+import os
+import sys
+
+sys.path.insert(0, os.path.dirname(os.path.abspath(__file__)))
+
+from cfsm_puml2c import IDENT_RE, parse, parse_arrow  # noqa: E402
+
+
+def read_hits(path):
+    hits = {}
+
+    with open(path, encoding='utf-8', newline='') as file:
+        for row in csv.DictReader(file):
+            key = (row['state'], row['event'])
+            total, unhandled = hits.get(key, (0, 0))
+            hits[key] = (total + int(row['hits']),
+                         unhandled + int(row['unhandled']))
+
+    return hits
+
+
+def annotate_label(label, total, unhandled):
+    if total == 0:
+        return '%s\\n<color:red>never</color>' % label
+    if unhandled:
+        return '%s\\n%d (%d unhandled)' % (label, total, unhandled)
+    return '%s\\n%d' % (label, total)
+
+
+def other_lines(pairs):
+    lines = []
+
+    for (event, (total, unhandled)) in sorted(pairs.items()):
+        if total > unhandled:
+            lines.append('  %s: %d in code' % (event, total - unhandled))
+        if unhandled:
+            lines.append('  %s: %d <color:red>unhandled</color>' %
+                         (event, unhandled))
+
+    return lines
+
+
+def annotate(path, hits):
+    machine = parse(path)
+    seen = set()
+    output = []
+
+    with open(path, encoding='utf-8') as file:
+        lines = file.read().splitlines()
+
+    for line in lines:
+        stripped = line.strip()
+        arrow = parse_arrow(stripped)
+
+        if arrow and arrow[0] != '[*]':
+            source, _, label = arrow
+
+            if IDENT_RE.match(label):
+                total, unhandled = hits.get((source, label), (0, 0))
+                seen.add((source, label))
+                head = line[:len(line) - len(line.lstrip())]
+                head += stripped[:stripped.rindex(':')].rstrip()
+                line = '%s : %s' % (head, annotate_label(label, total, unhandled))
+
+        if stripped.startswith('@enduml'):
+            output.extend(notes(machine, hits, seen))
+
+        output.append(line)
+
+    return output
+
+
+def notes(machine, hits, seen):
+    per_state = {}
+    legend = []
+
+    for (state, event), counts in hits.items():
+        if (state, event) not in seen:
+            per_state.setdefault(state, {})[event] = counts
+
+    result = []
+    for state in machine.states:
+        if state in per_state:
+            result.append('note right of %s' % state)
+            result.extend(other_lines(per_state.pop(state)))
+            result.append('end note')
+
+    for state in sorted(per_state):
+        legend.extend('  %s %s' % (state, line.strip())
+                      for line in other_lines(per_state[state]))
+
+    if legend:
+        result.append('legend')
+        result.append('  Events of states without diagram node')
+        result.extend(legend)
+        result.append('endlegend')
+
+    return result
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument('input', help='PlantUML state diagram')
+    parser.add_argument('hits', help='CSV written by cfsm_hits_writeCsv()')
+    parser.add_argument('--output', '-o',
+                        help='annotated diagram, default is stdout')
+    args = parser.parse_args()
+
+    text = '\n'.join(annotate(args.input, read_hits(args.hits))) + '\n'
+
+    if args.output:
+        with open(args.output, 'w', encoding='utf-8') as file:
+            file.write(text)
+    else:
+        sys.stdout.write(text)
+
+
+if __name__ == '__main__':
+    main()
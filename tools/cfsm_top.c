@@ -0,0 +1,394 @@
+/* MIT License
+ *
+ * Copyright (C) 2024  Haju Schulz <haju@schulznorbert.de>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+
+/*******************************************************************************
+    DESCRIPTION
+*******************************************************************************/
+/**
+ * @brief  cfsm-top, a live viewer of CFSM statistics segments
+ *
+ * Maps a segment published with cfsm_stats_create() read only and
+ * redraws it periodically, like top:
+ *
+ *     cfsm-top [-d seconds] [-n updates] /name
+ *
+ * Event rates are the change of the event totals between two updates
+ * of the publisher, divided by the time between them. The viewer never
+ * writes to the segment, so it cannot disturb the application.
+ *
+ * @addtogroup CfsmTop
+ *
+ * @{
+ */
+
+/******************************************************************************
+ * Includes
+ *****************************************************************************/
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <errno.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "c_fsm_stats.h"
+
+/******************************************************************************
+ * Macros
+ *****************************************************************************/
+
+#define NS_PER_S 1000000000.0  /**< Nanoseconds per second */
+
+/******************************************************************************
+ * Types and Classes
+ *****************************************************************************/
+
+/******************************************************************************
+ * Prototypes
+ *****************************************************************************/
+
+static void render(
+    const char * name,
+    const cfsm_StatsSegment * now,
+    const cfsm_StatsSegment * before);
+static double rate(
+    uint64_t count,
+    uint64_t previous,
+    const cfsm_StatsSegment * now,
+    const cfsm_StatsSegment * before);
+static const cfsm_StatsState * previousState(
+    const cfsm_StatsSegment * before,
+    uint32_t index,
+    const char * name);
+static uint32_t usedRows(uint32_t used, uint32_t capacity);
+static int publisherAlive(uint32_t pid);
+
+/******************************************************************************
+ * Variables
+ *****************************************************************************/
+
+/******************************************************************************
+ * External functions
+ *****************************************************************************/
+
+int main(int argc, char ** argv)
+{
+    const cfsm_StatsSegment * segment;
+    cfsm_StatsSegment * snapshots[2];
+    struct timespec delay;
+    double seconds = 1.0;
+    long updates = -1;
+    size_t size;
+    int current = 0;
+    int valid = 0;
+    int result;
+    int option;
+
+    while (-1 != (option = getopt(argc, argv, "d:n:")))
+    {
+        switch (option)
+        {
+        case 'd':
+            seconds = atof(optarg);
+            break;
+        case 'n':
+            updates = atol(optarg);
+            break;
+        default:
+            optind = argc + 1;
+            break;
+        }
+    }
+
+    if ((optind + 1 != argc) || (0.0 >= seconds))
+    {
+        fprintf(stderr, "usage: %s [-d seconds] [-n updates] /name\n", argv[0]);
+        return 2;
+    }
+
+    segment = cfsm_stats_open(argv[optind]);
+    if (NULL == segment)
+    {
+        fprintf(stderr, "%s: no CFSM statistics segment %s\n", argv[0], argv[optind]);
+        return 1;
+    }
+
+    size = cfsm_stats_size(
+        segment->stateCapacity,
+        segment->queueCapacity,
+        segment->latencyCapacity);
+    snapshots[0] = malloc(size);
+    snapshots[1] = malloc(size);
+    if ((NULL == snapshots[0]) || (NULL == snapshots[1]))
+    {
+        fprintf(stderr, "%s: out of memory\n", argv[0]);
+        return 1;
+    }
+
+    delay.tv_sec  = (time_t)seconds;
+    delay.tv_nsec = (long)((seconds - (double)delay.tv_sec) * NS_PER_S);
+
+    while (0 != updates)
+    {
+        result = cfsm_stats_snapshot(segment, snapshots[current], size);
+        if (0 == result)
+        {
+            render(argv[optind], snapshots[current], valid ? snapshots[1 - current] : NULL);
+            current = 1 - current;
+            valid = 1;
+        }
+        else if (-1 == result)
+        {
+            printf("%s: segment layout changed\n", argv[optind]);
+        }
+        else if ((0u != (*(volatile const uint32_t *)&segment->sequence & 1u)) &&
+                 (0 == publisherAlive(segment->pid)))
+        {
+            /* Odd across the whole backoff window and nobody to finish it. */
+            printf("%s: publisher %lu died during an update\n",
+                argv[optind],
+                (unsigned long)segment->pid);
+        }
+        else
+        {
+            printf("%s: update in progress, retrying\n", argv[optind]);
+        }
+        fflush(stdout);
+
+        if (0 < updates)
+        {
+            --updates;
+        }
+        if (0 != updates)
+        {
+            (void)nanosleep(&delay, NULL);
+        }
+    }
+
+    free(snapshots[0]);
+    free(snapshots[1]);
+    cfsm_stats_close(segment);
+
+    return 0;
+}
+
+/******************************************************************************
+ * Local functions
+ *****************************************************************************/
+
+/**
+ * @brief Draw one snapshot.
+ *
+ * @param name The segment name.
+ * @param now The latest snapshot.
+ * @param before The previous snapshot or NULL for the first one.
+ */
+static void render(
+    const char * name,
+    const cfsm_StatsSegment * now,
+    const cfsm_StatsSegment * before)
+{
+    const cfsm_StatsState * states = cfsm_stats_states(now);
+    const cfsm_StatsQueue * queues = cfsm_stats_queues(now);
+    const cfsm_StatsLatency * latencies = cfsm_stats_latencies(now);
+    uint32_t stateRows = usedRows(now->states, now->stateCapacity);
+    uint32_t queueRows = usedRows(now->queues, now->queueCapacity);
+    uint32_t latencyRows = usedRows(now->latencies, now->latencyCapacity);
+    uint32_t index;
+
+    /* Redraw in place on terminals, append when redirected. */
+    if (isatty(STDOUT_FILENO))
+    {
+        printf("\033[H\033[2J");
+    }
+
+    printf("cfsm-top  %s  pid %lu%s  update %llu  events %llu",
+        name,
+        (unsigned long)now->pid,
+        publisherAlive(now->pid) ? "" : " (exited)",
+        (unsigned long long)now->publishes,
+        (unsigned long long)now->events);
+    if (NULL != before)
+    {
+        printf(" (%.1f/s)", rate(now->events, before->events, now, before));
+    }
+    printf("\n\n");
+
+    printf("%-31s %10s %14s %12s %12s\n",
+        "STATE", "INSTANCES", "EVENTS", "EVENTS/S", "UNHANDLED");
+    for (index = 0u; index < stateRows; ++index)
+    {
+        const cfsm_StatsState * previous = previousState(before, index, states[index].name);
+
+        printf("%-31s %10lu %14llu ",
+            states[index].name,
+            (unsigned long)states[index].instances,
+            (unsigned long long)states[index].events);
+        if (NULL != previous)
+        {
+            printf("%12.1f", rate(states[index].events, previous->events, now, before));
+        }
+        else
+        {
+            printf("%12s", "-");
+        }
+        printf(" %12llu\n", (unsigned long long)states[index].unhandled);
+    }
+
+    if (0u < queueRows)
+    {
+        printf("\n%-31s %10s %14s %12s\n", "QUEUE", "DEPTH", "CAPACITY", "FILL %");
+        for (index = 0u; index < queueRows; ++index)
+        {
+            printf("%-31s %10lu ", queues[index].name, (unsigned long)queues[index].depth);
+            if (0u != queues[index].capacity)
+            {
+                printf("%14lu %12.1f\n",
+                    (unsigned long)queues[index].capacity,
+                    (100.0 * queues[index].depth) / queues[index].capacity);
+            }
+            else
+            {
+                printf("%14s %12s\n", "-", "-");
+            }
+        }
+    }
+
+    if (0u < latencyRows)
+    {
+        printf("\n%-31s %10s %14s %12s %12s %12s\n",
+            "LATENCY (ticks)", "COUNT", "P50", "P99", "P99.9", "MAX");
+        for (index = 0u; index < latencyRows; ++index)
+        {
+            printf("%-31s %10llu %14lu %12lu %12lu %12lu\n",
+                latencies[index].name,
+                (unsigned long long)latencies[index].count,
+                (unsigned long)latencies[index].p50,
+                (unsigned long)latencies[index].p99,
+                (unsigned long)latencies[index].p999,
+                (unsigned long)latencies[index].max);
+        }
+    }
+}
+
+/**
+ * @brief Get the rate of a counter between two updates.
+ *
+ * @param count Counter of the latest update.
+ * @param previous Counter of the previous update.
+ * @param now The latest snapshot.
+ * @param before The previous snapshot.
+ * @return Counts per second or 0 without time difference.
+ */
+static double rate(
+    uint64_t count,
+    uint64_t previous,
+    const cfsm_StatsSegment * now,
+    const cfsm_StatsSegment * before)
+{
+    double elapsed = (double)(now->time - before->time) / NS_PER_S;
+
+    /* Totals drop when the publisher restarts counting. */
+    if ((0.0 >= elapsed) || (count < previous))
+    {
+        return 0.0;
+    }
+
+    return (double)(count - previous) / elapsed;
+}
+
+/**
+ * @brief Find a state row of the previous snapshot.
+ *
+ * Rows keep their index across updates, so the same index is tried
+ * first.
+ *
+ * @param before The previous snapshot or NULL.
+ * @param index Row index in the latest snapshot.
+ * @param name The state name.
+ * @return The row or NULL if the state is new.
+ */
+static const cfsm_StatsState * previousState(
+    const cfsm_StatsSegment * before,
+    uint32_t index,
+    const char * name)
+{
+    const cfsm_StatsState * states;
+    uint32_t rows;
+    uint32_t row;
+
+    if (NULL == before)
+    {
+        return NULL;
+    }
+
+    states = cfsm_stats_states(before);
+    rows = usedRows(before->states, before->stateCapacity);
+    if ((index < rows) && (0 == strcmp(states[index].name, name)))
+    {
+        return &states[index];
+    }
+    for (row = 0u; row < rows; ++row)
+    {
+        if (0 == strcmp(states[row].name, name))
+        {
+            return &states[row];
+        }
+    }
+
+    return NULL;
+}
+
+/**
+ * @brief Limit the rows in use to the rows of a snapshot.
+ *
+ * The counts come from another process. cfsm_stats_snapshot() only copies
+ * snapshots whose capacities fit the allocated size, so walking up to
+ * the capacity stays within the copy.
+ *
+ * @param used Rows in use as published.
+ * @param capacity Rows in the snapshot.
+ * @return The number of rows that can be read.
+ */
+static uint32_t usedRows(uint32_t used, uint32_t capacity)
+{
+    return (used < capacity) ? used : capacity;
+}
+
+/**
+ * @brief Check if the publishing process still runs.
+ *
+ * @param pid The publisher process ID or 0 if unknown.
+ * @return Non zero if the process exists or is unknown.
+ */
+static int publisherAlive(uint32_t pid)
+{
+    return (0u == pid) || (0 == kill((pid_t)pid, 0)) || (ESRCH != errno);
+}
+
+/** @} */